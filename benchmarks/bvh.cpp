@@ -0,0 +1,216 @@
+// Times the culling BVH on random boxes: build, then frustum culling, refit
+// after some items moved, and ray queries, each next to what it replaces
+// (testing every sphere, rebuilding, testing every box). Ray hits are checked
+// against the brute-force result.
+//
+// usage: bvhBenchmark [item count] [moved items] [runs]
+
+#include "geometry/bounds.hpp"
+#include "geometry/bvh.hpp"
+#include "geometry/frustum.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    const float WORLD_SIZE = 1000.0f;
+    const std::size_t RAY_COUNT = 1000;
+
+    template <typename Run>
+    double bestOf(int runs, Run run) {
+        double best = std::numeric_limits<double>::infinity();
+
+        for (int i = 0; i < runs; i++) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+
+        return best;
+    }
+
+    AABB randomBox(std::mt19937& random) {
+        std::uniform_real_distribution<float> position(-0.5f * WORLD_SIZE, 0.5f * WORLD_SIZE);
+        std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extents(size(random), size(random), size(random));
+
+        AABB box;
+        box.min = center - extents;
+        box.max = center + extents;
+        return box;
+    }
+
+    glm::vec4 getSphere(const AABB& box) {
+        const auto& sphere = Bounds::fromBox(box).sphere;
+        return glm::vec4(sphere.center, sphere.radius);
+    }
+
+    // Same slab test as the BVH, over every box
+    BVH::Hit raycastAll(const std::vector<AABB>& boxes, const glm::vec3& origin, const glm::vec3& direction) {
+        glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        BVH::Hit hit;
+
+        for (std::size_t i = 0; i < boxes.size(); i++) {
+            glm::vec3 t0 = (boxes[i].min - origin) * inverseDirection;
+            glm::vec3 t1 = (boxes[i].max - origin) * inverseDirection;
+
+            glm::vec3 near = glm::min(t0, t1);
+            glm::vec3 far = glm::max(t0, t1);
+
+            float enter = std::max({ near.x, near.y, near.z, 0.0f });
+            float exit = std::min({ far.x, far.y, far.z, hit.distance });
+
+            if (enter <= exit) {
+                hit.item = static_cast<uint32_t>(i);
+                hit.distance = enter;
+            }
+        }
+
+        return hit;
+    }
+
+    void printRow(const char* name, double bvhTime, double baselineTime) {
+        std::cout << std::left << std::setw(10) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(3) << bvhTime
+            << std::setw(13) << baselineTime
+            << std::setw(9) << std::setprecision(1) << baselineTime / bvhTime << "x\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    std::size_t moved = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : count / 10;
+    int runs = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    if (count == 0 || moved > count || runs <= 0) {
+        std::cout << "usage: " << argv[0] << " [item count] [moved items] [runs]\n";
+        return 1;
+    }
+
+    // fixed seed so every run measures the same scene
+    std::mt19937 random(1234);
+
+    std::vector<AABB> boxes(count);
+    std::vector<glm::vec4> spheres(count);
+    for (std::size_t i = 0; i < count; i++) {
+        boxes[i] = randomBox(random);
+        spheres[i] = getSphere(boxes[i]);
+    }
+
+    BVH bvh;
+    double buildTime = bestOf(runs, [&] {
+        bvh.build(boxes, spheres);
+    });
+
+    std::cout << count << " items, " << bvh.getNodeCount() << " nodes, SAH cost " << std::setprecision(4) << bvh.getCost()
+        << ", best of " << runs << " runs\n";
+    std::cout << "build " << std::fixed << std::setprecision(3) << buildTime << " ms\n\n";
+    std::cout << "query      BVH ms  baseline ms  speedup\n";
+
+    // camera in the middle of the scene, seeing a slice of it
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 0.3f * WORLD_SIZE);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::vector<uint8_t> visible(count);
+    double cullTime = bestOf(runs, [&] {
+        std::fill(visible.begin(), visible.end(), uint8_t(0));
+        bvh.cull(frustum, visible.data());
+    });
+    std::size_t bvhVisible = std::count(visible.begin(), visible.end(), uint8_t(1));
+
+    double bruteCullTime = bestOf(runs, [&] {
+        frustum.intersects(spheres.data(), visible.data(), count);
+    });
+    std::size_t bruteVisible = std::count(visible.begin(), visible.end(), uint8_t(1));
+
+    printRow("cull", cullTime, bruteCullTime);
+
+    // refit after moving some items a little, against rebuilding the tree
+    std::vector<uint32_t> changed(count);
+    for (std::size_t i = 0; i < count; i++) {
+        changed[i] = static_cast<uint32_t>(i);
+    }
+    std::shuffle(changed.begin(), changed.end(), random);
+    changed.resize(moved);
+
+    std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+    for (auto item : changed) {
+        glm::vec3 move(offset(random), offset(random), offset(random));
+        boxes[item].min += move;
+        boxes[item].max += move;
+        spheres[item] = getSphere(boxes[item]);
+    }
+
+    // each run refits a fresh copy of the built tree; only the refit is timed
+    BVH refitted;
+    double refitTime = std::numeric_limits<double>::infinity();
+    for (int run = 0; run < runs; run++) {
+        refitted = bvh;
+        refitTime = std::min(refitTime, bestOf(1, [&] {
+            refitted.refit(boxes, spheres, changed);
+        }));
+    }
+
+    BVH rebuilt;
+    double rebuildTime = bestOf(runs, [&] {
+        rebuilt.build(boxes, spheres);
+    });
+
+    printRow("refit", refitTime, rebuildTime);
+
+    // rays from inside the scene in random directions
+    std::uniform_real_distribution<float> position(-0.5f * WORLD_SIZE, 0.5f * WORLD_SIZE);
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    std::vector<glm::vec3> origins(RAY_COUNT);
+    std::vector<glm::vec3> directions(RAY_COUNT);
+    for (std::size_t i = 0; i < RAY_COUNT; i++) {
+        origins[i] = glm::vec3(position(random), position(random), position(random));
+        directions[i] = glm::vec3(direction(random), direction(random), direction(random));
+    }
+
+    std::vector<BVH::Hit> hits(RAY_COUNT);
+    std::vector<BVH::Hit> bruteHits(RAY_COUNT);
+    double rayTime = bestOf(runs, [&] {
+        for (std::size_t i = 0; i < RAY_COUNT; i++) {
+            hits[i] = refitted.raycast(origins[i], directions[i]);
+        }
+    });
+    double bruteRayTime = bestOf(runs, [&] {
+        for (std::size_t i = 0; i < RAY_COUNT; i++) {
+            bruteHits[i] = raycastAll(boxes, origins[i], directions[i]);
+        }
+    });
+
+    printRow("1k rays", rayTime, bruteRayTime);
+
+    // boxes can tie on distance, so compare the distances rather than the items
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < RAY_COUNT; i++) {
+        bool hit = hits[i].item != BVH::INVALID;
+        bool bruteHit = bruteHits[i].item != BVH::INVALID;
+        if (hit != bruteHit || (hit && hits[i].distance != bruteHits[i].distance)) {
+            mismatches++;
+        }
+    }
+
+    std::cout << "\n" << bvhVisible << " items visible through the BVH, " << bruteVisible << " by testing every sphere\n";
+    std::cout << moved << " items moved before refit, SAH cost " << std::setprecision(4) << refitted.getCost()
+        << (refitted.needsRebuild() ? " (asks for a rebuild)" : "") << "\n";
+    std::cout << mismatches << " of " << RAY_COUNT << " rays differ from the brute-force hit\n";
+
+    return mismatches == 0 ? 0 : 1;
+}
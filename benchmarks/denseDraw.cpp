@@ -0,0 +1,302 @@
+// Draws one dense mesh (an OBJ tiled into a grid until it reaches the given
+// vertex count) with the material vertex shader as it was before the
+// model-view and normal matrices moved to the CPU, which computed
+// transpose(inverse(viewMatrix * modelMatrix)) per vertex, and as it is now,
+// with modelViewMatrix and normalMatrix uniforms (from MatrixBatch). Reports
+// the GPU time of the draw (GL_TIME_ELAPSED) and the frame time up to
+// glFinish, best of the given frames. A small viewport leaves the frame
+// bound by vertex shading rather than rasterization.
+//
+// Unlike the other benchmarks this one needs a GL 3.3 context.
+//
+// usage: denseDrawBenchmark <file.obj> [vertices] [frames] [width height]
+
+#include "geometry/indexedGeometry.hpp"
+#include "gl/shaderUtils.hpp"
+#include "io/mappedFile.hpp"
+#include "io/objParser.hpp"
+#include "util/matrixBatch.hpp"
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+    // The material vertex shader before the matrices moved to the CPU
+    const std::string PER_VERTEX_SHADER = R"(
+        #version 330
+        layout(location = 0) in vec3 position;
+        layout(location = 1) in vec3 normal;
+
+        uniform mat4 projectionMatrix;
+        uniform mat4 viewMatrix;
+        uniform mat4 modelMatrix;
+
+        out vec3 vNormalEyespace;
+
+        void main() {
+            vNormalEyespace = (transpose(inverse(viewMatrix * modelMatrix)) * vec4(normal, 0.0)).xyz;
+            gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0);
+        }
+    )";
+
+    // ... and after
+    const std::string UNIFORM_SHADER = R"(
+        #version 330
+        layout(location = 0) in vec3 position;
+        layout(location = 1) in vec3 normal;
+
+        uniform mat4 projectionMatrix;
+        uniform mat4 modelViewMatrix;
+        uniform mat3 normalMatrix;
+
+        out vec3 vNormalEyespace;
+
+        void main() {
+            vNormalEyespace = normalMatrix * normal;
+            gl_Position = projectionMatrix * modelViewMatrix * vec4(position, 1.0);
+        }
+    )";
+
+    // Uses the normal so the compiler keeps its transform
+    const std::string FRAGMENT_SHADER = R"(
+        #version 330
+        in vec3 vNormalEyespace;
+        out vec4 fragColor;
+
+        void main() {
+            float diffuse = max(dot(normalize(vNormalEyespace), vec3(0.0, 0.0, 1.0)), 0.0);
+            fragColor = vec4(vec3(diffuse), 1.0);
+        }
+    )";
+
+    struct Timing {
+        double gpu = std::numeric_limits<double>::infinity();
+        double frame = std::numeric_limits<double>::infinity();
+    };
+
+    // Copies of the mesh on a cube grid, enough of them to reach
+    // vertexCount. Returns the half size of the grid
+    float tile(const IndexedGeometry& mesh, std::size_t vertexCount, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(std::numeric_limits<float>::lowest());
+        for (std::size_t i = 0; i < mesh.getVertexCount(); i++) {
+            glm::vec3 p(mesh.positions[3 * i], mesh.positions[3 * i + 1], mesh.positions[3 * i + 2]);
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+
+        std::size_t copies = (vertexCount + mesh.getVertexCount() - 1) / mesh.getVertexCount();
+        auto side = static_cast<std::size_t>(std::ceil(std::cbrt(static_cast<double>(copies))));
+        float spacing = 1.1f * glm::length(max - min);
+        glm::vec3 center = 0.5f * (min + max);
+
+        vertices.clear();
+        indices.clear();
+        vertices.reserve(copies * mesh.getVertexCount() * 6);
+        indices.reserve(copies * mesh.indices.size());
+
+        for (std::size_t copy = 0; copy < copies; copy++) {
+            glm::vec3 cell(copy % side, (copy / side) % side, copy / (side * side));
+            glm::vec3 offset = (cell - 0.5f * static_cast<float>(side - 1)) * spacing - center;
+
+            auto base = static_cast<uint32_t>(vertices.size() / 6);
+            for (std::size_t i = 0; i < mesh.getVertexCount(); i++) {
+                for (int c = 0; c < 3; c++) {
+                    vertices.push_back(mesh.positions[3 * i + c] + offset[c]);
+                }
+                for (int c = 0; c < 3; c++) {
+                    vertices.push_back(mesh.normals[3 * i + c]);
+                }
+            }
+            for (auto index : mesh.indices) {
+                indices.push_back(base + index);
+            }
+        }
+
+        return 0.5f * static_cast<float>(side) * spacing;
+    }
+
+    Timing timeDraws(GLuint program, GLuint vertexArray, GLsizei indexCount, GLuint query, int frames, SDL_Window* window) {
+        Timing best;
+
+        glUseProgram(program);
+        glBindVertexArray(vertexArray);
+
+        for (int frame = 0; frame < frames; frame++) {
+            auto start = std::chrono::steady_clock::now();
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+            glEndQuery(GL_TIME_ELAPSED);
+            glFinish();
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+
+            // the first frame pays for the upload and shader compilation
+            if (frame > 0) {
+                best.gpu = std::min(best.gpu, static_cast<double>(nanoseconds) * 1e-6);
+                best.frame = std::min(best.frame, elapsed.count());
+            }
+
+            SDL_GL_SwapWindow(window);
+        }
+
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t vertexCount = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    int frames = argc > 3 ? std::atoi(argv[3]) : 20;
+    int width = argc > 5 ? std::atoi(argv[4]) : 1280;
+    int height = argc > 5 ? std::atoi(argv[5]) : 720;
+
+    if (argc < 2 || vertexCount == 0 || frames <= 1 || width <= 0 || height <= 0) {
+        std::cout << "usage: " << argv[0] << " <file.obj> [vertices] [frames] [width height]\n";
+        return 1;
+    }
+
+    MappedFile file;
+    if (!file.open(argv[1])) {
+        std::cout << "File Not Found: " << argv[1] << "\n";
+        return 1;
+    }
+
+    OBJParser::Data data;
+    const char* error = nullptr;
+    if (!OBJParser::parse(file.begin(), file.end(), data, &error)) {
+        std::cout << "Error reading " << argv[1] << ": " << error << "\n";
+        return 1;
+    }
+
+    auto mesh = MeshIndexing::deduplicate(std::move(data.positions), std::move(data.normals), std::move(data.uvs));
+    if (mesh.getVertexCount() == 0) {
+        std::cout << argv[1] << " has no triangles\n";
+        return 1;
+    }
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    float halfSize = tile(mesh, vertexCount, vertices, indices);
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cout << "SDL could not be initialized\n";
+        return 1;
+    }
+
+    SDL_Window* window = SDL_CreateWindow("Dense draw benchmark", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+    if (window == nullptr) {
+        std::cout << "Window could not be created!\n";
+        return 1;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+    SDL_GLContext context = SDL_GL_CreateContext(window);
+    if (context == nullptr) {
+        std::cout << "Error creating openGL context: " << SDL_GetError() << "\n";
+        return 1;
+    }
+
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::cout << "Error initializing GLEW\n";
+        return 1;
+    }
+
+    // no vsync, the frame time is what is measured
+    SDL_GL_SetSwapInterval(0);
+
+    GLuint perVertexProgram = ShaderUtils::compile(PER_VERTEX_SHADER, FRAGMENT_SHADER);
+    GLuint uniformProgram = ShaderUtils::compile(UNIFORM_SHADER, FRAGMENT_SHADER);
+    if (perVertexProgram == 0 || uniformProgram == 0) {
+        return 1;
+    }
+
+    GLuint vertexArray = 0;
+    GLuint buffers[2] = {};
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(2, buffers);
+
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(uint32_t)), indices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), reinterpret_cast<const void*>(3 * sizeof(float)));
+    glBindVertexArray(0);
+
+    // the whole grid in view, turned so the model matrix is not trivial
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(width) / height, 0.1f, 100.0f * halfSize);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 4.0f * halfSize), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f)));
+
+    glm::mat4 modelView;
+    glm::mat3 normal;
+    MatrixBatch::computeModelView(view, &model, &modelView, &normal, 1);
+
+    glUseProgram(perVertexProgram);
+    glUniformMatrix4fv(glGetUniformLocation(perVertexProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(glGetUniformLocation(perVertexProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(perVertexProgram, "modelMatrix"), 1, GL_FALSE, glm::value_ptr(model));
+
+    glUseProgram(uniformProgram);
+    glUniformMatrix4fv(glGetUniformLocation(uniformProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(glGetUniformLocation(uniformProgram, "modelViewMatrix"), 1, GL_FALSE, glm::value_ptr(modelView));
+    glUniformMatrix3fv(glGetUniformLocation(uniformProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normal));
+
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    GLuint query = 0;
+    glGenQueries(1, &query);
+
+    auto indexCount = static_cast<GLsizei>(indices.size());
+    Timing perVertex = timeDraws(perVertexProgram, vertexArray, indexCount, query, frames, window);
+    Timing uniform = timeDraws(uniformProgram, vertexArray, indexCount, query, frames, window);
+
+    std::cout << vertices.size() / 6 << " vertices, " << indices.size() / 3 << " triangles, " << width << "x" << height
+        << ", best of " << frames - 1 << " frames\n";
+    std::cout << glGetString(GL_RENDERER) << "\n";
+    std::cout << "normal matrix      GPU ms   frame ms\n";
+    std::cout << std::fixed << std::setprecision(3)
+        << "per vertex   " << std::setw(12) << perVertex.gpu << std::setw(11) << perVertex.frame << "\n"
+        << "uniform      " << std::setw(12) << uniform.gpu << std::setw(11) << uniform.frame << "\n";
+    std::cout << "speedup " << std::setprecision(2) << perVertex.gpu / uniform.gpu << "x (GPU), "
+        << perVertex.frame / uniform.frame << "x (frame)\n";
+
+    glDeleteQueries(1, &query);
+    glDeleteBuffers(2, buffers);
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteProgram(uniformProgram);
+    glDeleteProgram(perVertexProgram);
+
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    return 0;
+}
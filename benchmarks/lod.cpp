@@ -0,0 +1,131 @@
+// Builds the levels of detail of one mesh, then moves a camera away from it
+// and back, and prints the triangles drawn per frame with and without them,
+// picking levels the way the renderer does (MeshSimplification::selectLod,
+// with its hysteresis). The camera matches the viewer's: 45 degree vertical
+// field of view, the given viewport height.
+//
+// usage: lodBenchmark <file.obj> [frames each way] [viewport height]
+
+#include "geometry/bounds.hpp"
+#include "geometry/indexedGeometry.hpp"
+#include "geometry/meshSimplification.hpp"
+#include "io/mappedFile.hpp"
+#include "io/objParser.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const float FIELD_OF_VIEW = glm::radians(45.0f);
+    // camera distances swept, in bounding sphere radii
+    const float NEAREST = 1.5f;
+    const float FARTHEST = 500.0f;
+    // rows printed each way
+    const int PRINTED_ROWS = 12;
+
+    void printRow(const char* direction, float distance, float pixelRadius, std::size_t level, std::size_t triangles, std::size_t fullTriangles) {
+        std::cout << std::left << std::setw(5) << direction << std::right
+            << std::fixed << std::setprecision(1) << std::setw(9) << distance
+            << std::setw(11) << pixelRadius
+            << std::setw(7) << level
+            << std::setw(11) << triangles
+            << std::setw(9) << std::setprecision(1) << 100.0 * static_cast<double>(triangles) / static_cast<double>(fullTriangles) << "%\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 2 ? std::atoi(argv[2]) : 600;
+    int height = argc > 3 ? std::atoi(argv[3]) : 720;
+
+    if (argc < 2 || frames < 2 || height <= 0) {
+        std::cout << "usage: " << argv[0] << " <file.obj> [frames each way] [viewport height]\n";
+        return 1;
+    }
+
+    MappedFile file;
+    if (!file.open(argv[1])) {
+        std::cout << "File Not Found: " << argv[1] << "\n";
+        return 1;
+    }
+
+    OBJParser::Data data;
+    const char* error = nullptr;
+    if (!OBJParser::parse(file.begin(), file.end(), data, &error)) {
+        std::cout << "Error reading " << argv[1] << ": " << error << "\n";
+        return 1;
+    }
+
+    auto geometry = MeshIndexing::deduplicate(std::move(data.positions), std::move(data.normals), std::move(data.uvs));
+    auto bounds = Bounds::fromPositions(geometry.positions);
+
+    auto start = std::chrono::steady_clock::now();
+    auto lods = MeshSimplification::buildLods(geometry, bounds.sphere.radius);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::size_t fullTriangles = lods.front().indexCount / 3;
+
+    std::cout << argv[1] << ": " << fullTriangles << " triangles, " << lods.size() << " levels in "
+        << std::fixed << std::setprecision(1) << elapsed.count() << " ms\n";
+    for (std::size_t level = 0; level < lods.size(); level++) {
+        std::cout << "  level " << level << ": " << std::setw(8) << lods[level].indexCount / 3 << " triangles, error "
+            << std::scientific << std::setprecision(2) << lods[level].error << std::fixed << " radii\n";
+    }
+
+    if (lods.size() < 2) {
+        std::cout << "no levels of detail: under " << MeshSimplification::MIN_TRIANGLES
+            << " triangles, or no edge collapses off the borders and seams\n";
+        return 0;
+    }
+
+    // pixels covered by a unit of size at unit distance, as in Renderer::selectLods
+    float pixelScale = 0.5f * static_cast<float>(height) / std::tan(0.5f * FIELD_OF_VIEW);
+
+    std::cout << "\n" << height << " px viewport, " << frames << " frames out to " << FARTHEST << " radii and back\n";
+    std::cout << "     distance  radius px  level  triangles  of full\n";
+
+    std::size_t current = 0;
+    std::size_t withLods = 0;
+    std::size_t switches = 0;
+    int printEvery = std::max(frames / PRINTED_ROWS, 1);
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int frame = 0; frame < frames; frame++) {
+            // geometric steps, evenly spread over the range of sizes on screen
+            float t = static_cast<float>(frame) / static_cast<float>(frames - 1);
+            if (pass == 1) {
+                t = 1.0f - t;
+            }
+            float distance = NEAREST * std::pow(FARTHEST / NEAREST, t);
+            float pixelRadius = pixelScale / distance;
+
+            std::size_t level = MeshSimplification::selectLod(lods, current, pixelRadius);
+            if (level != current) {
+                switches++;
+            }
+            current = level;
+
+            std::size_t triangles = lods[level].indexCount / 3;
+            withLods += triangles;
+
+            if (frame % printEvery == 0 || frame == frames - 1) {
+                printRow(pass == 0 ? "out" : "in", distance, pixelRadius, level, triangles, fullTriangles);
+            }
+        }
+    }
+
+    std::size_t totalFrames = 2 * static_cast<std::size_t>(frames);
+    std::size_t withoutLods = totalFrames * fullTriangles;
+
+    std::cout << "\nper frame: " << withLods / totalFrames << " triangles with levels of detail, " << fullTriangles
+        << " without (" << std::setprecision(1) << 100.0 * static_cast<double>(withLods) / static_cast<double>(withoutLods)
+        << "%), " << switches << " level switches\n";
+
+    return 0;
+}
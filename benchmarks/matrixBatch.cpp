@@ -0,0 +1,120 @@
+// Times MatrixBatch::computeModelView against the straightforward glm
+// version (view * model and transpose(inverse(mat3(modelView)))) on a dense
+// set of random affine model matrices, and reports how far the two differ.
+//
+// usage: matrixBatchBenchmark [matrix count] [runs]
+
+#include "util/matrixBatch.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+    void computeWithGLM(
+        const glm::mat4& view,
+        const glm::mat4* models,
+        glm::mat4* modelViews,
+        glm::mat3* normals,
+        std::size_t count
+    ) {
+        for (std::size_t i = 0; i < count; i++) {
+            modelViews[i] = view * models[i];
+            normals[i] = glm::transpose(glm::inverse(glm::mat3(modelViews[i])));
+        }
+    }
+
+    template <typename Compute>
+    double bestOf(int runs, Compute compute) {
+        double best = std::numeric_limits<double>::infinity();
+
+        for (int run = 0; run < runs; run++) {
+            auto start = std::chrono::steady_clock::now();
+            compute();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+
+        return best;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    int runs = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    if (count == 0 || runs <= 0) {
+        std::cout << "usage: " << argv[0] << " [matrix count] [runs]\n";
+        return 1;
+    }
+
+    // fixed seed so every run times the same matrices
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+
+    std::vector<glm::mat4> models(count);
+    for (auto& model : models) {
+        model = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+        model = glm::rotate(model, angle(random), glm::normalize(glm::vec3(position(random), position(random), position(random)) + glm::vec3(0.0f, 0.0f, 1e-3f)));
+        model = glm::scale(model, glm::vec3(scale(random), scale(random), scale(random)));
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(3.0f, 4.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<glm::mat4> batchModelViews(count), glmModelViews(count);
+    std::vector<glm::mat3> batchNormals(count), glmNormals(count);
+
+    double glmTime = bestOf(runs, [&] {
+        computeWithGLM(view, models.data(), glmModelViews.data(), glmNormals.data(), count);
+    });
+    double batchTime = bestOf(runs, [&] {
+        MatrixBatch::computeModelView(view, models.data(), batchModelViews.data(), batchNormals.data(), count);
+    });
+
+    // largest element-wise difference relative to the largest element of the
+    // same matrix
+    float maxError = 0.0f;
+    for (std::size_t i = 0; i < count; i++) {
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                float magnitude = std::max(std::abs(glmModelViews[i][c][r]), 1.0f);
+                maxError = std::max(maxError, std::abs(batchModelViews[i][c][r] - glmModelViews[i][c][r]) / magnitude);
+            }
+        }
+
+        float magnitude = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            for (int r = 0; r < 3; r++) {
+                magnitude = std::max(magnitude, std::abs(glmNormals[i][c][r]));
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            for (int r = 0; r < 3; r++) {
+                maxError = std::max(maxError, std::abs(batchNormals[i][c][r] - glmNormals[i][c][r]) / magnitude);
+            }
+        }
+    }
+
+    std::cout << count << " matrices, best of " << runs << " runs\n";
+    std::cout << "path            ms   ns/matrix\n";
+    std::cout << std::fixed
+        << "glm      " << std::setw(10) << std::setprecision(3) << glmTime
+        << std::setw(12) << std::setprecision(1) << glmTime * 1e6 / count << "\n"
+        << "batch    " << std::setw(10) << std::setprecision(3) << batchTime
+        << std::setw(12) << std::setprecision(1) << batchTime * 1e6 / count << "\n";
+    std::cout << "speedup " << std::setprecision(2) << glmTime / batchTime << "x, max relative error "
+        << std::scientific << std::setprecision(2) << maxError << "\n";
+
+    return 0;
+}
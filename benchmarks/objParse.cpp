@@ -0,0 +1,74 @@
+// Times OBJParser::parse on one file with 1..N threads, to check how the
+// chunked parse scales. The mesh cache is not involved.
+//
+// usage: objParseBenchmark <file.obj> [max threads] [runs per count]
+
+#include "io/mappedFile.hpp"
+#include "io/objParser.hpp"
+#include "util/threadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <file.obj> [max threads] [runs per count]\n";
+        return 1;
+    }
+
+    MappedFile file;
+    if (!file.open(argv[1])) {
+        std::cout << "File Not Found: " << argv[1] << "\n";
+        return 1;
+    }
+
+    std::size_t maxThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency());
+    int runs = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    auto megabytes = static_cast<double>(file.size()) / (1024.0 * 1024.0);
+    std::cout << argv[1] << ": " << megabytes << " MB, best of " << runs << " runs\n";
+    std::cout << "threads        ms      MB/s   speedup\n";
+
+    double single = 0.0;
+
+    for (std::size_t threads = 1; threads <= maxThreads; threads++) {
+        ThreadPool pool(threads);
+
+        double best = std::numeric_limits<double>::infinity();
+        std::size_t triangles = 0;
+
+        for (int run = 0; run < runs; run++) {
+            OBJParser::Data data;
+            const char* error = nullptr;
+
+            auto start = std::chrono::steady_clock::now();
+            bool parsed = OBJParser::parse(file.begin(), file.end(), data, &error, pool);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+            if (!parsed) {
+                std::cout << "Error reading " << argv[1] << ": " << error << "\n";
+                return 1;
+            }
+
+            best = std::min(best, elapsed.count());
+            triangles = data.positions.size() / 9;
+        }
+
+        if (threads == 1) {
+            single = best;
+            std::cout << "(" << triangles << " triangles)\n";
+        }
+
+        std::cout << std::setw(7) << threads
+            << std::setw(10) << std::fixed << std::setprecision(1) << best
+            << std::setw(10) << megabytes / (best / 1000.0)
+            << std::setw(9) << std::setprecision(2) << single / best << "x\n";
+    }
+
+    return 0;
+}
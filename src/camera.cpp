@@ -45,3 +45,7 @@ void Camera::addRotation(glm::vec3 r) {
 
     dirty = true;
 }
+
+Frustum Camera::getFrustum() const {
+    return Frustum::fromMatrix(getProjectionMatrix() * getViewMatrix());
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "geometry/frustum.hpp"
+
 #include <glm/glm.hpp>
 
 const float DEFAULT_NEAR = 0.01f;
@@ -49,6 +51,9 @@ class Camera {
 
         glm::mat4 getProjectionMatrix() const;
         glm::mat4 getViewMatrix() const;
+
+        // World space frustum planes
+        Frustum getFrustum() const;
     private:
         float aspect;
         float fov;
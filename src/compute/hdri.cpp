@@ -1,11 +1,11 @@
 #include "hdri.hpp"
 
-#include "gl/shaderUtils.hpp"
+#include "gl/shaderProgram.hpp"
+#include "resourceCache.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-#include <fstream>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
@@ -20,7 +20,7 @@ void HDRI::initialize(std::string f) {
     createCubemap();
     createProgram();
 
-    cubeMesh.fromOBJ("assets/unit_cube.obj");
+    cubeMesh = ResourceCache::shared().getMesh("assets/unit_cube.obj");
 
     renderToCubemap();
 }
@@ -33,7 +33,6 @@ HDRI::~HDRI() {
 
     glDeleteFramebuffers(1, &fbo);
 
-    glDeleteProgram(cubemapProgram);
 }
 
 void HDRI::loadTexture() {
@@ -92,49 +91,12 @@ void HDRI::createCubemap() {
 }
 
 void HDRI::createProgram() {
-    std::string vShader;
-    std::string fShader;
-
-    std::ifstream ifs;
-    ifs.open("assets/shaders/equirectangularToCube.vert");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open vShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    vShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    vShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
-    );
-
-    ifs.close();
-
-    ifs.open("assets/shaders/equirectangularToCube.frag");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open fShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    fShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    fShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
+    cubemapProgram = ResourceCache::shared().getProgramFromFiles(
+        "assets/shaders/equirectangularToCube.vert",
+        "assets/shaders/equirectangularToCube.frag"
     );
 
-    ifs.close();
-
-    cubemapProgram = ShaderUtils::compile(vShader, fShader);
-
-    if (cubemapProgram == 0) {
+    if (!cubemapProgram) {
         std::cout << "Failed to compile program\n";
         return;
     }
@@ -142,29 +104,39 @@ void HDRI::createProgram() {
 
 // render to each of the six faces of the cubemap
 void HDRI::renderToCubemap() {
+    if (!cubemapProgram) {
+        return;
+    }
+
     glCullFace(GL_FRONT);
-    glUseProgram(cubemapProgram);
+    glUseProgram(cubemapProgram->get());
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture);
 
-    glUniform1i(glGetUniformLocation(cubemapProgram, "equirectangularMap"), 0);
+    glUniform1i(glGetUniformLocation(cubemapProgram->get(), "equirectangularMap"), 0);
 
-    glUniformMatrix4fv(glGetUniformLocation(cubemapProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(cubemapProgram->get(), "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
 
     glViewport(0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT);
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
     for (unsigned int i = 0; i < CUBE_FACES; i++) {
-        glUniformMatrix4fv(glGetUniformLocation(cubemapProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(VIEW_MATRICES.at(i)));
+        glUniformMatrix4fv(glGetUniformLocation(cubemapProgram->get(), "viewMatrix"), 1, GL_FALSE, glm::value_ptr(VIEW_MATRICES.at(i)));
 
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
             GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, cubemapTexture, 0);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glBindVertexArray(cubeMesh.getVertexArrayObject());
-        glDrawArrays(GL_TRIANGLES, 0, cubeMesh.getVertexCount());
+        glBindVertexArray(cubeMesh->getVertexArrayObject());
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES,
+            cubeMesh->getIndexCount(),
+            cubeMesh->getIndexType(),
+            reinterpret_cast<const void*>(cubeMesh->getLodOffset(0)),
+            cubeMesh->getBaseVertex()
+        );
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -173,25 +145,39 @@ void HDRI::renderToCubemap() {
 }
 
 void HDRI::setProjectionAndViewMatrices(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix) const {
-    glUseProgram(cubemapProgram);
-    auto projectionMatrixLocation = glGetUniformLocation(cubemapProgram, "projectionMatrix");
-    auto viewMatrixLocation = glGetUniformLocation(cubemapProgram, "viewMatrix");
+    if (!cubemapProgram) {
+        return;
+    }
+
+    glUseProgram(cubemapProgram->get());
+    auto projectionMatrixLocation = glGetUniformLocation(cubemapProgram->get(), "projectionMatrix");
+    auto viewMatrixLocation = glGetUniformLocation(cubemapProgram->get(), "viewMatrix");
     glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
     glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
     glUseProgram(0);
 }
 
 void HDRI::renderCube() const {
-    glUseProgram(cubemapProgram);
+    if (!cubemapProgram) {
+        return;
+    }
+
+    glUseProgram(cubemapProgram->get());
     glCullFace(GL_FRONT);
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture);
 
-    glUniform1i(glGetUniformLocation(cubemapProgram, "equirectangularMap"), 0);
+    glUniform1i(glGetUniformLocation(cubemapProgram->get(), "equirectangularMap"), 0);
 
-    glBindVertexArray(cubeMesh.getVertexArrayObject());
-    glDrawArrays(GL_TRIANGLES, 0, cubeMesh.getVertexCount());
+    glBindVertexArray(cubeMesh->getVertexArrayObject());
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES,
+        cubeMesh->getIndexCount(),
+        cubeMesh->getIndexType(),
+        reinterpret_cast<const void*>(cubeMesh->getLodOffset(0)),
+        cubeMesh->getBaseVertex()
+    );
 
     glCullFace(GL_BACK);
     glUseProgram(0);
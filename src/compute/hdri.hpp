@@ -6,9 +6,12 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
+class ShaderProgram;
+
 class HDRI {
     public:
         HDRI();
@@ -54,7 +57,7 @@ class HDRI {
         GLuint texture = 0;
 
         GLuint cubemapTexture = 0;
-        GLuint cubemapProgram = 0;
+        std::shared_ptr<ShaderProgram> cubemapProgram;
 
         // fbo used in the process of creating the cubemap
         GLuint fbo = 0;
@@ -62,7 +65,8 @@ class HDRI {
 
         glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
 
-        Mesh cubeMesh;
+        // shared with every other user of the unit cube
+        std::shared_ptr<Mesh> cubeMesh;
 
         void loadTexture();
         void createCubemap();
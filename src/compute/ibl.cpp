@@ -1,8 +1,8 @@
 #include "ibl.hpp"
 
-#include "gl/shaderUtils.hpp"
+#include "gl/shaderProgram.hpp"
+#include "resourceCache.hpp"
 
-#include <fstream>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
@@ -24,7 +24,7 @@ void IBL::initialize(GLuint em, GLuint vao) {
     loadPrefilteredEnvironmentProgram();
     loadIntegrateBRDFProgram();
 
-    cubeMesh.fromOBJ("assets/unit_cube.obj");
+    cubeMesh = ResourceCache::shared().getMesh("assets/unit_cube.obj");
 
     setEnvironmentMap(em);
 }
@@ -38,9 +38,6 @@ IBL::~IBL() {
 
     glDeleteFramebuffers(1, &fbo);
 
-    glDeleteProgram(diffuseIrradianceProgram);
-    glDeleteProgram(prefilterProgram);
-    glDeleteProgram(integrateBRDFProgram);
 }
 
 void IBL::createFramebuffer() {
@@ -114,147 +111,36 @@ void IBL::createIntegratedBRDFMap() {
 }
 
 void IBL::loadDiffuseIrradianceProgram() {
-    std::string vShader;
-    std::string fShader;
-
-    std::ifstream ifs;
-    ifs.open("assets/shaders/diffuseIrradiance.vert");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open vShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    vShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    vShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
+    diffuseIrradianceProgram = ResourceCache::shared().getProgramFromFiles(
+        "assets/shaders/diffuseIrradiance.vert",
+        "assets/shaders/diffuseIrradiance.frag"
     );
 
-    ifs.close();
-
-    ifs.open("assets/shaders/diffuseIrradiance.frag");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open fShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    fShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    fShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
-    );
-
-    ifs.close();
-
-    diffuseIrradianceProgram = ShaderUtils::compile(vShader, fShader);
-
-    if (diffuseIrradianceProgram == 0) {
+    if (!diffuseIrradianceProgram) {
         std::cout << "Failed to compile program\n";
         return;
     }
 }
 
 void IBL::loadPrefilteredEnvironmentProgram() {
-    std::string vShader;
-    std::string fShader;
-
-    std::ifstream ifs;
-    ifs.open("assets/shaders/prefilter.vert");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open vShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    vShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    vShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
-    );
-
-    ifs.close();
-
-    ifs.open("assets/shaders/prefilter.frag");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open fShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    fShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    fShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
+    prefilterProgram = ResourceCache::shared().getProgramFromFiles(
+        "assets/shaders/prefilter.vert",
+        "assets/shaders/prefilter.frag"
     );
 
-    ifs.close();
-
-    prefilterProgram = ShaderUtils::compile(vShader, fShader);
-
-    if (prefilterProgram == 0) {
+    if (!prefilterProgram) {
         std::cout << "Failed to compile program\n";
         return;
     }
 }
 
 void IBL::loadIntegrateBRDFProgram() {
-    std::string vShader;
-    std::string fShader;
-
-    std::ifstream ifs;
-    ifs.open("assets/shaders/integratedBRDF.vert");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open vShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    vShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    vShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
+    integrateBRDFProgram = ResourceCache::shared().getProgramFromFiles(
+        "assets/shaders/integratedBRDF.vert",
+        "assets/shaders/integratedBRDF.frag"
     );
 
-    ifs.close();
-
-    ifs.open("assets/shaders/integratedBRDF.frag");
-
-    if (ifs.fail()) {
-        std::cout << "Could not open fShader file\n";
-        return;
-    }
-
-    ifs.seekg(0, std::ios::end);
-    fShader.reserve(ifs.tellg());
-    ifs.seekg(0, std::ios::beg);
-
-    fShader.assign(
-        std::istreambuf_iterator<char>(ifs),
-        std::istreambuf_iterator<char>()
-    );
-
-    ifs.close();
-
-    integrateBRDFProgram = ShaderUtils::compile(vShader, fShader);
-
-    if (integrateBRDFProgram == 0) {
+    if (!integrateBRDFProgram) {
         std::cout << "Failed to compile program\n";
         return;
     }
@@ -262,6 +148,10 @@ void IBL::loadIntegrateBRDFProgram() {
 
 // render to each of the six faces of the diffuseIrradiance
 void IBL::renderToDiffuseIrradiance() {
+    if (!diffuseIrradianceProgram) {
+        return;
+    }
+
     // ensure we set the depthbuffer to the proper size
     glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, DIFFUSE_IRRADIANCE_TEXTURE_WIDTH, DIFFUSE_IRRADIANCE_TEXTURE_HEIGHT);
@@ -269,27 +159,33 @@ void IBL::renderToDiffuseIrradiance() {
     glViewport(0, 0, DIFFUSE_IRRADIANCE_TEXTURE_WIDTH, DIFFUSE_IRRADIANCE_TEXTURE_HEIGHT);
 
     glCullFace(GL_FRONT);
-    glUseProgram(diffuseIrradianceProgram);
+    glUseProgram(diffuseIrradianceProgram->get());
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
 
-    glUniform1i(glGetUniformLocation(diffuseIrradianceProgram, "environmentMap"), 0);
+    glUniform1i(glGetUniformLocation(diffuseIrradianceProgram->get(), "environmentMap"), 0);
 
-    glUniformMatrix4fv(glGetUniformLocation(diffuseIrradianceProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(diffuseIrradianceProgram->get(), "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
 
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
     for (unsigned int i = 0; i < CUBE_FACES; i++) {
-        glUniformMatrix4fv(glGetUniformLocation(diffuseIrradianceProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(VIEW_MATRICES.at(i)));
+        glUniformMatrix4fv(glGetUniformLocation(diffuseIrradianceProgram->get(), "viewMatrix"), 1, GL_FALSE, glm::value_ptr(VIEW_MATRICES.at(i)));
 
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
             GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, diffuseIrradianceMap, 0);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glBindVertexArray(cubeMesh.getVertexArrayObject());
-        glDrawArrays(GL_TRIANGLES, 0, cubeMesh.getVertexCount());
+        glBindVertexArray(cubeMesh->getVertexArrayObject());
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES,
+            cubeMesh->getIndexCount(),
+            cubeMesh->getIndexType(),
+            reinterpret_cast<const void*>(cubeMesh->getLodOffset(0)),
+            cubeMesh->getBaseVertex()
+        );
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -298,16 +194,20 @@ void IBL::renderToDiffuseIrradiance() {
 }
 
 void IBL::renderToPrefilterMap() {
+    if (!prefilterProgram) {
+        return;
+    }
+
     // ensure we set the depthbuffer to the proper size
     glCullFace(GL_FRONT);
-    glUseProgram(prefilterProgram);
+    glUseProgram(prefilterProgram->get());
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, environmentMap);
 
-    glUniform1i(glGetUniformLocation(prefilterProgram, "environmentMap"), 0);
+    glUniform1i(glGetUniformLocation(prefilterProgram->get(), "environmentMap"), 0);
 
-    glUniformMatrix4fv(glGetUniformLocation(prefilterProgram, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+    glUniformMatrix4fv(glGetUniformLocation(prefilterProgram->get(), "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(projectionMatrix));
 
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
@@ -324,18 +224,24 @@ void IBL::renderToPrefilterMap() {
 
         float roughness = static_cast<float>(mipmapLevel) / (static_cast<float>(PREFILTERED_TEXTURE_MIPMAP_LEVELS) - 1.0f);
 
-        glUniform1f(glGetUniformLocation(prefilterProgram, "roughness"), roughness);
+        glUniform1f(glGetUniformLocation(prefilterProgram->get(), "roughness"), roughness);
 
         for (unsigned int i = 0; i < CUBE_FACES; i++) {
-            glUniformMatrix4fv(glGetUniformLocation(prefilterProgram, "viewMatrix"), 1, GL_FALSE, glm::value_ptr(VIEW_MATRICES.at(i)));
+            glUniformMatrix4fv(glGetUniformLocation(prefilterProgram->get(), "viewMatrix"), 1, GL_FALSE, glm::value_ptr(VIEW_MATRICES.at(i)));
 
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
                 GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mipmapLevel);
 
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            glBindVertexArray(cubeMesh.getVertexArrayObject());
-            glDrawArrays(GL_TRIANGLES, 0, cubeMesh.getVertexCount());
+            glBindVertexArray(cubeMesh->getVertexArrayObject());
+            glDrawElementsBaseVertex(
+                GL_TRIANGLES,
+                cubeMesh->getIndexCount(),
+                cubeMesh->getIndexType(),
+                reinterpret_cast<const void*>(cubeMesh->getLodOffset(0)),
+                cubeMesh->getBaseVertex()
+            );
         }
     }
 
@@ -345,6 +251,10 @@ void IBL::renderToPrefilterMap() {
 }
 
 void IBL::renderToIntegratedBRDFMap() {
+    if (!integrateBRDFProgram) {
+        return;
+    }
+
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, INTEGRATED_BRDF_TEXTURE_WIDTH, INTEGRATED_BRDF_TEXTURE_HEIGHT);
@@ -352,7 +262,7 @@ void IBL::renderToIntegratedBRDFMap() {
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, integratedBRDFMap, 0);
 
     glViewport(0, 0, INTEGRATED_BRDF_TEXTURE_WIDTH, INTEGRATED_BRDF_TEXTURE_HEIGHT);
-    glUseProgram(integrateBRDFProgram);
+    glUseProgram(integrateBRDFProgram->get());
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -6,9 +6,11 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
+class ShaderProgram;
 
 class IBL {
     public:
@@ -61,15 +63,15 @@ class IBL {
 
         GLuint environmentMap = 0;
         GLuint diffuseIrradianceMap = 0;
-        GLuint diffuseIrradianceProgram = 0;
+        std::shared_ptr<ShaderProgram> diffuseIrradianceProgram;
 
         // Prefiltered environment map for the specular term
         GLuint prefilterMap = 0;
-        GLuint prefilterProgram = 0;
+        std::shared_ptr<ShaderProgram> prefilterProgram;
 
         // IntegratedBRDF Map
         GLuint integratedBRDFMap = 0;
-        GLuint integrateBRDFProgram = 0;
+        std::shared_ptr<ShaderProgram> integrateBRDFProgram;
 
         // fbo used in the process of creating the cubemap
         GLuint fbo = 0;
@@ -77,7 +79,8 @@ class IBL {
 
         glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
 
-        Mesh cubeMesh;
+        // shared with every other user of the unit cube
+        std::shared_ptr<Mesh> cubeMesh;
 
         void createFramebuffer();
 
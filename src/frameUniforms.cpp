@@ -0,0 +1,51 @@
+#include "frameUniforms.hpp"
+
+#include "camera.hpp"
+
+FrameUniforms::~FrameUniforms() {
+    glDeleteBuffers(1, &buffer);
+}
+
+void FrameUniforms::initialize() {
+    glGenBuffers(1, &buffer);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+}
+
+bool FrameUniforms::update(Camera& camera, int width, int height, float time) const {
+    bool cameraChanged = camera.isDirty();
+
+    if (cameraChanged) {
+        block.projectionMatrix = camera.getProjectionMatrix();
+        block.viewMatrix = camera.getViewMatrix();
+        block.inverseProjectionMatrix = glm::inverse(block.projectionMatrix);
+        block.inverseViewMatrix = glm::inverse(block.viewMatrix);
+        frustum = Frustum::fromMatrix(block.projectionMatrix * block.viewMatrix);
+
+        camera.setDirty(false);
+    }
+
+    // against the previous frame's camera, whether or not it moved since
+    glm::mat4 viewProjectionMatrix = block.projectionMatrix * block.viewMatrix;
+    if (block.frameIndex == 0) {
+        previousViewProjectionMatrix = viewProjectionMatrix;
+    }
+
+    block.reprojectionMatrix = previousViewProjectionMatrix * block.inverseViewMatrix;
+    previousViewProjectionMatrix = viewProjectionMatrix;
+
+    block.viewportSize = glm::vec2(width, height);
+    block.time = time;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    block.frameIndex++;
+
+    return cameraChanged;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "geometry/frustum.hpp"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+class Camera;
+
+/**
+ * std140 uniform buffer with the per-frame values every shader shares:
+ * camera matrices (and their inverses), the reprojection to the previous
+ * frame's camera, viewport size, time, a frame counter and the G-buffer
+ * layout.
+ * Bound to a fixed binding point that all programs declaring the Frame
+ * block (ShaderUtils::FRAME_BLOCK) are attached to.
+ *
+ * Camera matrices are only recomputed when the camera is dirty; the block
+ * is uploaded with a single buffer update per frame, independent of the
+ * number of programs using it.
+ **/
+class FrameUniforms {
+    public:
+        static constexpr GLuint BINDING = 1;
+
+        FrameUniforms() = default;
+
+        FrameUniforms(FrameUniforms&& other) = delete;
+        FrameUniforms& operator=(FrameUniforms&& other) = delete;
+
+        FrameUniforms(const FrameUniforms& other) = delete;
+        FrameUniforms& operator=(const FrameUniforms& other) = delete;
+
+        ~FrameUniforms();
+
+        void initialize();
+
+        // Picks up camera changes (clearing the camera's dirty flag) and
+        // uploads the block; call once per frame. Returns true if the camera
+        // changed
+        bool update(Camera& camera, int width, int height, float time) const;
+
+        // Which G-buffer layout writeGBuffer and readGBuffer use (see
+        // ShaderUtils::GBUFFER_OUTPUTS); uploaded with the next update
+        void setCompactGBuffer(bool value) const {
+            block.compactGBuffer = value ? 1.0f : 0.0f;
+        }
+
+        const glm::mat4& getProjectionMatrix() const {
+            return block.projectionMatrix;
+        }
+
+        const glm::mat4& getViewMatrix() const {
+            return block.viewMatrix;
+        }
+
+        // World space camera position
+        glm::vec3 getViewPosition() const {
+            return glm::vec3(block.inverseViewMatrix[3]);
+        }
+
+        // World space, updated with the matrices
+        const Frustum& getFrustum() const {
+            return frustum;
+        }
+
+        GLuint getBuffer() const {
+            return buffer;
+        }
+    private:
+        // std140 layout of the Frame block
+        struct Block {
+            glm::mat4 projectionMatrix;
+            glm::mat4 viewMatrix;
+            glm::mat4 inverseProjectionMatrix;
+            glm::mat4 inverseViewMatrix;
+            glm::mat4 reprojectionMatrix;
+            glm::vec2 viewportSize;
+            float time;
+            float compactGBuffer;
+            uint32_t frameIndex;
+            float padding[3];
+        };
+
+        static_assert(sizeof(Block) == 5 * 64 + 32, "Block must match the std140 layout of Frame");
+
+        GLuint buffer = 0;
+
+        // of the last update
+        mutable glm::mat4 previousViewProjectionMatrix = glm::mat4(1.0f);
+
+        mutable Block block = {};
+        mutable Frustum frustum;
+};
@@ -0,0 +1,76 @@
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+AABB AABB::transform(const glm::mat4& matrix) const {
+    // Arvo: the new extents are the old ones through the absolute rotation/scale
+    glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+    glm::vec3 extents = getExtents();
+
+    glm::vec3 transformed =
+        glm::abs(glm::vec3(matrix[0])) * extents.x +
+        glm::abs(glm::vec3(matrix[1])) * extents.y +
+        glm::abs(glm::vec3(matrix[2])) * extents.z;
+
+    AABB result;
+    result.min = center - transformed;
+    result.max = center + transformed;
+    return result;
+}
+
+BoundingSphere BoundingSphere::transform(const glm::mat4& matrix) const {
+    float scale = std::max({
+        glm::length(glm::vec3(matrix[0])),
+        glm::length(glm::vec3(matrix[1])),
+        glm::length(glm::vec3(matrix[2]))
+    });
+
+    BoundingSphere result;
+    result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    result.radius = radius * scale;
+    return result;
+}
+
+Bounds Bounds::transform(const glm::mat4& matrix) const {
+    Bounds result;
+    result.box = box.transform(matrix);
+    result.sphere = sphere.transform(matrix);
+    return result;
+}
+
+Bounds Bounds::fromPositions(const std::vector<float>& positions) {
+    Bounds bounds;
+
+    if (positions.size() < 3) {
+        return bounds;
+    }
+
+    bounds.box.min = glm::vec3(positions[0], positions[1], positions[2]);
+    bounds.box.max = bounds.box.min;
+
+    for (std::size_t i = 3; i + 2 < positions.size(); i += 3) {
+        bounds.box.expand(glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+    }
+
+    // farthest vertex from the box center, tighter than the box corners
+    bounds.sphere.center = bounds.box.getCenter();
+
+    float radiusSquared = 0.0f;
+    for (std::size_t i = 0; i + 2 < positions.size(); i += 3) {
+        glm::vec3 d = glm::vec3(positions[i], positions[i + 1], positions[i + 2]) - bounds.sphere.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+    }
+
+    bounds.sphere.radius = std::sqrt(radiusSquared);
+
+    return bounds;
+}
+
+Bounds Bounds::fromBox(const AABB& box) {
+    Bounds bounds;
+    bounds.box = box;
+    bounds.sphere.center = box.getCenter();
+    bounds.sphere.radius = glm::length(box.getExtents());
+    return bounds;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/**
+ * Axis aligned box. Transforming one gives the box around the transformed
+ * box, which can be larger than the box around the transformed geometry.
+ **/
+struct AABB {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    glm::vec3 getCenter() const {
+        return 0.5f * (min + max);
+    }
+
+    // half the size along each axis
+    glm::vec3 getExtents() const {
+        return 0.5f * (max - min);
+    }
+
+    float getSurfaceArea() const {
+        glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    void expand(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void expand(const AABB& box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    AABB transform(const glm::mat4& matrix) const;
+
+    // Contains nothing; expanding it by anything gives that thing's box
+    static AABB empty() {
+        AABB box;
+        box.min = glm::vec3(std::numeric_limits<float>::max());
+        box.max = glm::vec3(-std::numeric_limits<float>::max());
+        return box;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Scales the radius by the largest axis scale, so it stays conservative
+    // under non-uniform scale
+    BoundingSphere transform(const glm::mat4& matrix) const;
+};
+
+/**
+ * Box + sphere around a mesh: the sphere is the cheap test, the box the
+ * tighter one for elongated meshes. The sphere is centered on the box.
+ **/
+struct Bounds {
+    AABB box;
+    BoundingSphere sphere;
+
+    Bounds transform(const glm::mat4& matrix) const;
+
+    // positions are tightly packed xyz triples
+    static Bounds fromPositions(const std::vector<float>& positions);
+    // Sphere around the box, for when only the box is known
+    static Bounds fromBox(const AABB& box);
+};
@@ -0,0 +1,403 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace {
+    // one SSE batch of Frustum::intersects
+    const uint32_t LEAF_SIZE = 4;
+    // leaves are only forced to split above this, smaller ones split when SAH says so
+    const uint32_t MAX_LEAF_SIZE = 16;
+    const int BINS = 16;
+
+    // rebuild once refitting made queries this much more expensive
+    const float REBUILD_RATIO = 1.5f;
+
+    struct Bin {
+        AABB bounds = AABB::empty();
+        uint32_t count = 0;
+    };
+
+    bool sameBounds(const AABB& a, const AABB& b) {
+        return a.min == b.min && a.max == b.max;
+    }
+
+    int binOf(const glm::vec3& centroid, int axis, float start, float scale) {
+        int bin = static_cast<int>((centroid[axis] - start) * scale);
+        return std::min(std::max(bin, 0), BINS - 1);
+    }
+
+    // Entry/exit distances of a ray through a box, as multiples of its direction
+    bool intersectRay(
+        const AABB& box,
+        const glm::vec3& origin,
+        const glm::vec3& inverseDirection,
+        float maxDistance,
+        float& distance
+    ) {
+        glm::vec3 t0 = (box.min - origin) * inverseDirection;
+        glm::vec3 t1 = (box.max - origin) * inverseDirection;
+
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far = glm::max(t0, t1);
+
+        float enter = std::max({ near.x, near.y, near.z, 0.0f });
+        float exit = std::min({ far.x, far.y, far.z, maxDistance });
+
+        distance = enter;
+        return enter <= exit;
+    }
+}
+
+void BVH::build(const std::vector<AABB>& boxes, const std::vector<glm::vec4>& spheres) {
+    auto count = static_cast<uint32_t>(boxes.size());
+
+    nodes.clear();
+    items.resize(count);
+    std::iota(items.begin(), items.end(), 0);
+
+    refittedItems = 0;
+    degraded = false;
+
+    if (count > 0) {
+        std::vector<glm::vec3> centroids(count);
+        for (uint32_t i = 0; i < count; i++) {
+            centroids[i] = boxes[i].getCenter();
+        }
+
+        nodes.reserve(2 * count);
+
+        Node root;
+        root.first = 0;
+        root.count = count;
+        nodes.push_back(root);
+
+        subdivide(0, boxes, centroids);
+    }
+
+    itemBoxes.resize(count);
+    itemSpheres.resize(count);
+    itemSlots.resize(count);
+    itemLeaves.resize(count);
+
+    for (uint32_t slot = 0; slot < count; slot++) {
+        itemBoxes[slot] = boxes[items[slot]];
+        itemSpheres[slot] = spheres[items[slot]];
+        itemSlots[items[slot]] = slot;
+    }
+
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].left != INVALID) {
+            continue;
+        }
+        for (uint32_t slot = nodes[i].first; slot < nodes[i].first + nodes[i].count; slot++) {
+            itemLeaves[items[slot]] = i;
+        }
+    }
+
+    builtCost = getCost();
+}
+
+void BVH::subdivide(uint32_t index, const std::vector<AABB>& boxes, const std::vector<glm::vec3>& centroids) {
+    // copies, nodes may reallocate below
+    uint32_t first = nodes[index].first;
+    uint32_t count = nodes[index].count;
+
+    AABB bounds = AABB::empty();
+    AABB centroidBounds = AABB::empty();
+
+    for (uint32_t slot = first; slot < first + count; slot++) {
+        bounds.expand(boxes[items[slot]]);
+        centroidBounds.expand(centroids[items[slot]]);
+    }
+
+    nodes[index].bounds = bounds;
+
+    if (count <= LEAF_SIZE) {
+        return;
+    }
+
+    // binned SAH over all three axes
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = std::numeric_limits<float>::max();
+
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0.0f) {
+            continue;
+        }
+
+        float scale = BINS / extent;
+        std::array<Bin, BINS> bins;
+
+        for (uint32_t slot = first; slot < first + count; slot++) {
+            auto& bin = bins[binOf(centroids[items[slot]], axis, centroidBounds.min[axis], scale)];
+            bin.bounds.expand(boxes[items[slot]]);
+            bin.count++;
+        }
+
+        // area * count of everything left of each split
+        std::array<float, BINS - 1> leftCosts;
+        AABB left = AABB::empty();
+        uint32_t leftCount = 0;
+
+        for (int split = 1; split < BINS; split++) {
+            left.expand(bins[split - 1].bounds);
+            leftCount += bins[split - 1].count;
+            leftCosts[split - 1] = leftCount > 0 ? left.getSurfaceArea() * leftCount : 0.0f;
+        }
+
+        AABB right = AABB::empty();
+        uint32_t rightCount = 0;
+
+        for (int split = BINS - 1; split > 0; split--) {
+            right.expand(bins[split].bounds);
+            rightCount += bins[split].count;
+
+            float cost = leftCosts[split - 1] + (rightCount > 0 ? right.getSurfaceArea() * rightCount : 0.0f);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    float leafCost = bounds.getSurfaceArea() * count;
+
+    if (count <= MAX_LEAF_SIZE && (bestAxis < 0 || bestCost >= leafCost)) {
+        return;
+    }
+
+    auto begin = items.begin() + first;
+    auto end = begin + count;
+    auto middle = begin;
+
+    if (bestAxis >= 0) {
+        float scale = BINS / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+        middle = std::partition(begin, end, [&](uint32_t item) {
+            return binOf(centroids[item], bestAxis, centroidBounds.min[bestAxis], scale) < bestSplit;
+        });
+    }
+
+    if (middle == begin || middle == end) {
+        // all centroids in one bin: split the range in half
+        middle = begin + count / 2;
+        int axis = bestAxis >= 0 ? bestAxis : 0;
+        std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+            return centroids[a][axis] < centroids[b][axis];
+        });
+    }
+
+    auto leftCount = static_cast<uint32_t>(middle - begin);
+
+    auto left = static_cast<uint32_t>(nodes.size());
+    nodes[index].left = left;
+
+    Node child;
+    child.parent = index;
+
+    child.first = first;
+    child.count = leftCount;
+    nodes.push_back(child);
+
+    child.first = first + leftCount;
+    child.count = count - leftCount;
+    nodes.push_back(child);
+
+    subdivide(left, boxes, centroids);
+    subdivide(left + 1, boxes, centroids);
+}
+
+void BVH::refit(
+    const std::vector<AABB>& boxes,
+    const std::vector<glm::vec4>& spheres,
+    const std::vector<uint32_t>& changed
+) {
+    for (auto item : changed) {
+        auto slot = itemSlots[item];
+        itemBoxes[slot] = boxes[item];
+        itemSpheres[slot] = spheres[item];
+    }
+
+    for (auto item : changed) {
+        Node& leaf = nodes[itemLeaves[item]];
+
+        AABB bounds = AABB::empty();
+        for (uint32_t slot = leaf.first; slot < leaf.first + leaf.count; slot++) {
+            bounds.expand(itemBoxes[slot]);
+        }
+        leaf.bounds = bounds;
+
+        // stop as soon as a node doesn't change, its ancestors won't either
+        for (auto parent = leaf.parent; parent != INVALID; parent = nodes[parent].parent) {
+            AABB merged = nodes[nodes[parent].left].bounds;
+            merged.expand(nodes[nodes[parent].left + 1].bounds);
+
+            if (sameBounds(merged, nodes[parent].bounds)) {
+                break;
+            }
+            nodes[parent].bounds = merged;
+        }
+    }
+
+    // measuring the cost walks the whole tree, so only do it every so often
+    refittedItems += changed.size();
+    if (refittedItems >= std::max<std::size_t>(items.size() / 16, 1)) {
+        refittedItems = 0;
+        degraded = getCost() > REBUILD_RATIO * builtCost;
+    }
+}
+
+float BVH::getCost() const {
+    if (nodes.empty()) {
+        return 0.0f;
+    }
+
+    // SAH: nodes are visited with probability area / root area
+    float rootArea = std::max(nodes.front().bounds.getSurfaceArea(), std::numeric_limits<float>::min());
+    float cost = 0.0f;
+
+    for (const auto& node : nodes) {
+        float probability = node.bounds.getSurfaceArea() / rootArea;
+        cost += probability * (node.left == INVALID ? node.count : 1.0f);
+    }
+
+    return cost / static_cast<float>(items.size());
+}
+
+void BVH::cull(const Frustum& frustum, uint8_t* visible) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    const uint32_t ALL_PLANES = (1u << Frustum::COUNT) - 1;
+
+    // node + the planes it still has to be tested against
+    std::array<std::pair<uint32_t, uint32_t>, 64> stack;
+    std::size_t size = 0;
+    stack[size++] = { 0, ALL_PLANES };
+
+    std::array<uint8_t, MAX_LEAF_SIZE> leafVisible;
+
+    while (size > 0) {
+        auto entry = stack[--size];
+        const Node& node = nodes[entry.first];
+        uint32_t planes = entry.second;
+
+        bool outside = false;
+
+        for (int p = 0; p < Frustum::COUNT && !outside; p++) {
+            if ((planes & (1u << p)) == 0) {
+                continue;
+            }
+
+            const glm::vec4& plane = frustum.planes[p];
+            glm::vec3 normal(plane);
+
+            // corners farthest along and against the plane normal
+            glm::vec3 positive(
+                normal.x >= 0.0f ? node.bounds.max.x : node.bounds.min.x,
+                normal.y >= 0.0f ? node.bounds.max.y : node.bounds.min.y,
+                normal.z >= 0.0f ? node.bounds.max.z : node.bounds.min.z
+            );
+            glm::vec3 negative(
+                normal.x >= 0.0f ? node.bounds.min.x : node.bounds.max.x,
+                normal.y >= 0.0f ? node.bounds.min.y : node.bounds.max.y,
+                normal.z >= 0.0f ? node.bounds.min.z : node.bounds.max.z
+            );
+
+            if (glm::dot(normal, positive) + plane.w < 0.0f) {
+                outside = true;
+            } else if (glm::dot(normal, negative) + plane.w >= 0.0f) {
+                planes &= ~(1u << p);
+            }
+        }
+
+        if (outside) {
+            continue;
+        }
+
+        if (planes == 0) {
+            // fully inside: accept the whole subtree
+            for (uint32_t slot = node.first; slot < node.first + node.count; slot++) {
+                visible[items[slot]] = 1;
+            }
+            continue;
+        }
+
+        if (node.left == INVALID) {
+            frustum.intersects(&itemSpheres[node.first], leafVisible.data(), node.count);
+            for (uint32_t i = 0; i < node.count; i++) {
+                if (leafVisible[i]) {
+                    visible[items[node.first + i]] = 1;
+                }
+            }
+            continue;
+        }
+
+        if (size + 2 > stack.size()) {
+            // deeper than any balanced tree over 32 bit ids; accept conservatively
+            for (uint32_t slot = node.first; slot < node.first + node.count; slot++) {
+                visible[items[slot]] = 1;
+            }
+            continue;
+        }
+
+        stack[size++] = { node.left, planes };
+        stack[size++] = { node.left + 1, planes };
+    }
+}
+
+BVH::Hit BVH::raycast(const glm::vec3& origin, const glm::vec3& direction) const {
+    Hit hit;
+
+    if (nodes.empty()) {
+        return hit;
+    }
+
+    // IEEE division gives +-inf for axis aligned rays, which the slab test handles
+    glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+    std::vector<uint32_t> stack = { 0 };
+
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+
+        float distance = 0.0f;
+        if (!intersectRay(node.bounds, origin, inverseDirection, hit.distance, distance)) {
+            continue;
+        }
+
+        if (node.left == INVALID) {
+            for (uint32_t slot = node.first; slot < node.first + node.count; slot++) {
+                if (intersectRay(itemBoxes[slot], origin, inverseDirection, hit.distance, distance)) {
+                    hit.item = items[slot];
+                    hit.distance = distance;
+                }
+            }
+            continue;
+        }
+
+        // visit the nearer child first so farther subtrees are pruned by hit.distance
+        float leftDistance = 0.0f;
+        float rightDistance = 0.0f;
+        bool leftHit = intersectRay(nodes[node.left].bounds, origin, inverseDirection, hit.distance, leftDistance);
+        bool rightHit = intersectRay(nodes[node.left + 1].bounds, origin, inverseDirection, hit.distance, rightDistance);
+
+        if (leftHit && rightHit) {
+            bool leftFirst = leftDistance <= rightDistance;
+            stack.push_back(leftFirst ? node.left + 1 : node.left);
+            stack.push_back(leftFirst ? node.left : node.left + 1);
+        } else if (leftHit) {
+            stack.push_back(node.left);
+        } else if (rightHit) {
+            stack.push_back(node.left + 1);
+        }
+    }
+
+    return hit;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "geometry/bounds.hpp"
+#include "geometry/frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * Bounding volume hierarchy over items given by world space boxes and
+ * spheres (packed as center, radius). Items are identified by their index in
+ * the arrays passed to build().
+ *
+ * Built top down with the binned surface area heuristic. Moving items only
+ * refits the boxes on their path to the root; once refitting has degraded
+ * the tree's SAH cost too far, needsRebuild() asks for a fresh build.
+ **/
+class BVH {
+    public:
+        static const uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+
+        struct Hit {
+            uint32_t item = INVALID;
+            float distance = std::numeric_limits<float>::max();
+        };
+
+        BVH() = default;
+        ~BVH() = default;
+
+        BVH(BVH&& other) = default;
+        BVH(const BVH& other) = default;
+
+        BVH& operator=(const BVH& other) = default;
+        BVH& operator=(BVH&& other) = default;
+
+        void build(const std::vector<AABB>& boxes, const std::vector<glm::vec4>& spheres);
+
+        // boxes and spheres hold every item, changed lists the items that moved
+        void refit(
+            const std::vector<AABB>& boxes,
+            const std::vector<glm::vec4>& spheres,
+            const std::vector<uint32_t>& changed
+        );
+
+        bool needsRebuild() const {
+            return degraded;
+        }
+
+        // Sets visible[item] to 1 for every item in the frustum; other entries
+        // are left alone. Subtrees fully inside are accepted without testing
+        // their items, leaves are tested with Frustum's batched sphere test
+        void cull(const Frustum& frustum, uint8_t* visible) const;
+
+        // Closest item whose box the ray hits (direction need not be normalized;
+        // distance is in units of it)
+        Hit raycast(const glm::vec3& origin, const glm::vec3& direction) const;
+
+        // Expected cost of a query, relative to testing every item
+        float getCost() const;
+
+        std::size_t getItemCount() const {
+            return items.size();
+        }
+
+        std::size_t getNodeCount() const {
+            return nodes.size();
+        }
+    private:
+        struct Node {
+            AABB bounds;
+            // children are left and left + 1; INVALID for leaves
+            uint32_t left = INVALID;
+            uint32_t parent = INVALID;
+            // range of items (and itemSpheres) under this node
+            uint32_t first = 0;
+            uint32_t count = 0;
+        };
+
+        std::vector<Node> nodes;
+        // item ids, grouped so every subtree is a contiguous range
+        std::vector<uint32_t> items;
+        // item data in the order of items
+        std::vector<AABB> itemBoxes;
+        std::vector<glm::vec4> itemSpheres;
+        // position of each item id in items, and its leaf
+        std::vector<uint32_t> itemSlots;
+        std::vector<uint32_t> itemLeaves;
+
+        float builtCost = 0.0f;
+        std::size_t refittedItems = 0;
+        bool degraded = false;
+
+        void subdivide(uint32_t node, const std::vector<AABB>& boxes, const std::vector<glm::vec3>& centroids);
+};
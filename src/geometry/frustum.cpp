@@ -0,0 +1,137 @@
+#include "frustum.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE 1
+#endif
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+    // Gribb/Hartmann: planes are sums/differences of the matrix rows
+    auto row = [&m](int i) {
+        return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    };
+
+    Frustum frustum;
+    frustum.planes[LEFT] = row(3) + row(0);
+    frustum.planes[RIGHT] = row(3) - row(0);
+    frustum.planes[BOTTOM] = row(3) + row(1);
+    frustum.planes[TOP] = row(3) - row(1);
+    frustum.planes[NEAR] = row(3) + row(2);
+    frustum.planes[FAR] = row(3) - row(2);
+
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    return frustum;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& m, glm::vec2 ndcMin, glm::vec2 ndcMax) {
+    auto row = [&m](int i) {
+        return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    };
+
+    // ndcMin.x <= clip.x / clip.w <= ndcMax.x, and the same for y
+    Frustum frustum = fromMatrix(m);
+    frustum.planes[LEFT] = row(0) - ndcMin.x * row(3);
+    frustum.planes[RIGHT] = ndcMax.x * row(3) - row(0);
+    frustum.planes[BOTTOM] = row(1) - ndcMin.y * row(3);
+    frustum.planes[TOP] = ndcMax.y * row(3) - row(1);
+
+    for (int p = LEFT; p <= TOP; p++) {
+        frustum.planes[p] /= glm::length(glm::vec3(frustum.planes[p]));
+    }
+
+    return frustum;
+}
+
+Frustum Frustum::transform(const glm::mat4& matrix) const {
+    // dot(plane, matrix * p) = dot(transpose(matrix) * plane, p)
+    glm::mat4 transposed = glm::transpose(matrix);
+
+    Frustum frustum;
+    for (int p = 0; p < COUNT; p++) {
+        frustum.planes[p] = transposed * planes[p];
+        frustum.planes[p] /= glm::length(glm::vec3(frustum.planes[p]));
+    }
+
+    return frustum;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Frustum::intersects(const AABB& box) const {
+    for (const auto& plane : planes) {
+        // the box corner farthest along the plane normal
+        glm::vec3 positive(
+            plane.x >= 0.0f ? box.max.x : box.min.x,
+            plane.y >= 0.0f ? box.max.y : box.min.y,
+            plane.z >= 0.0f ? box.max.z : box.min.z
+        );
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Frustum::intersects(const glm::vec4* spheres, uint8_t* visible, std::size_t count) const {
+    std::size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+    __m128 px[COUNT];
+    __m128 py[COUNT];
+    __m128 pz[COUNT];
+    __m128 pw[COUNT];
+
+    for (int p = 0; p < COUNT; p++) {
+        px[p] = _mm_set1_ps(planes[p].x);
+        py[p] = _mm_set1_ps(planes[p].y);
+        pz[p] = _mm_set1_ps(planes[p].z);
+        pw[p] = _mm_set1_ps(planes[p].w);
+    }
+
+    for (; i + 4 <= count; i += 4) {
+        // four (x, y, z, r) rows to x, y, z and r columns
+        __m128 x = _mm_loadu_ps(&spheres[i + 0][0]);
+        __m128 y = _mm_loadu_ps(&spheres[i + 1][0]);
+        __m128 z = _mm_loadu_ps(&spheres[i + 2][0]);
+        __m128 r = _mm_loadu_ps(&spheres[i + 3][0]);
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), r);
+        __m128 outside = _mm_setzero_ps();
+
+        for (int p = 0; p < COUNT; p++) {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+                _mm_add_ps(_mm_mul_ps(pz[p], z), pw[p])
+            );
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        visible[i + 0] = (mask & 1) == 0;
+        visible[i + 1] = (mask & 2) == 0;
+        visible[i + 2] = (mask & 4) == 0;
+        visible[i + 3] = (mask & 8) == 0;
+    }
+#endif
+
+    for (; i < count; i++) {
+        BoundingSphere sphere;
+        sphere.center = glm::vec3(spheres[i]);
+        sphere.radius = spheres[i].w;
+        visible[i] = intersects(sphere);
+    }
+}
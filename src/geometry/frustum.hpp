@@ -0,0 +1,40 @@
+#pragma once
+
+#include "geometry/bounds.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The six planes of a view frustum, in the space the matrix maps from
+ * (world space for projection * view). Planes are normalized and point
+ * inwards: a point p is inside a plane if dot(plane.xyz, p) + plane.w >= 0.
+ *
+ * Tests are conservative: objects near a frustum corner may be reported as
+ * visible even though they are not.
+ **/
+struct Frustum {
+    enum Plane { LEFT, RIGHT, BOTTOM, TOP, NEAR, FAR, COUNT };
+
+    std::array<glm::vec4, COUNT> planes = {};
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    // The part of the frustum that projects into [ndcMin, ndcMax] in x and y
+    // (e.g. one screen tile), with the same near and far planes
+    static Frustum fromMatrix(const glm::mat4& viewProjection, glm::vec2 ndcMin, glm::vec2 ndcMax);
+
+    // The same frustum in the space matrix maps from, e.g. in a model's
+    // object space for a world space frustum and the model matrix
+    Frustum transform(const glm::mat4& matrix) const;
+
+    bool intersects(const BoundingSphere& sphere) const;
+    bool intersects(const AABB& box) const;
+
+    // visible[i] = intersects(spheres[i]), with spheres packed as (center, radius).
+    // Tests four spheres at a time with SSE when available
+    void intersects(const glm::vec4* spheres, uint8_t* visible, std::size_t count) const;
+};
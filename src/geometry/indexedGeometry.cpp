@@ -0,0 +1,118 @@
+#include "indexedGeometry.hpp"
+
+#include <cstring>
+
+namespace {
+    // a position + normal + uv, compared and hashed bitwise (with signed
+    // zeros made positive)
+    constexpr std::size_t MAX_VERTEX_FLOATS = 8;
+
+    constexpr uint32_t NEGATIVE_ZERO = 0x80000000u;
+
+    inline uint32_t hashVertex(const uint32_t* words, std::size_t count) {
+        // murmur3-style mixing of the float bit patterns
+        uint32_t h = 0x9747b28cu;
+        for (std::size_t i = 0; i < count; i++) {
+            uint32_t k = words[i];
+            k *= 0xcc9e2d51u;
+            k = (k << 15) | (k >> 17);
+            k *= 0x1b873593u;
+            h ^= k;
+            h = (h << 13) | (h >> 19);
+            h = h * 5 + 0xe6546b64u;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+}
+
+IndexedGeometry MeshIndexing::deduplicate(
+    std::vector<float>&& positions,
+    std::vector<float>&& normals,
+    std::vector<float>&& uvs
+) {
+    IndexedGeometry geometry;
+
+    std::size_t corners = positions.size() / 3;
+    bool hasUvs = uvs.size() == corners * 2 && corners > 0;
+    std::size_t vertexFloats = hasUvs ? 8 : 6;
+
+    geometry.indices.resize(corners);
+    geometry.positions.reserve(positions.size());
+    geometry.normals.reserve(normals.size());
+    if (hasUvs) {
+        geometry.uvs.reserve(uvs.size());
+    }
+
+    // Open addressing (linear probing) table of unique vertex ids.
+    // Sized to a power of two at most half full.
+    std::size_t tableSize = 16;
+    while (tableSize < corners * 2) {
+        tableSize <<= 1;
+    }
+    const uint32_t EMPTY = 0xffffffffu;
+    std::vector<uint32_t> table(tableSize, EMPTY);
+    std::size_t mask = tableSize - 1;
+
+    // packed copy of the unique vertices, used for comparisons
+    std::vector<uint32_t> unique;
+    unique.reserve(corners * vertexFloats);
+
+    uint32_t key[MAX_VERTEX_FLOATS];
+
+    for (std::size_t i = 0; i < corners; i++) {
+        std::memcpy(key, &positions[i * 3], 3 * sizeof(float));
+        std::memcpy(key + 3, &normals[i * 3], 3 * sizeof(float));
+        if (hasUvs) {
+            std::memcpy(key + 6, &uvs[i * 2], 2 * sizeof(float));
+        }
+
+        // -0.0 and +0.0 are the same attribute value
+        for (std::size_t f = 0; f < vertexFloats; f++) {
+            if (key[f] == NEGATIVE_ZERO) {
+                key[f] = 0;
+            }
+        }
+
+        std::size_t slot = hashVertex(key, vertexFloats) & mask;
+        while (true) {
+            uint32_t id = table[slot];
+            if (id == EMPTY) {
+                id = static_cast<uint32_t>(geometry.positions.size() / 3);
+                table[slot] = id;
+
+                unique.insert(unique.end(), key, key + vertexFloats);
+                geometry.positions.insert(geometry.positions.end(), &positions[i * 3], &positions[i * 3] + 3);
+                geometry.normals.insert(geometry.normals.end(), &normals[i * 3], &normals[i * 3] + 3);
+                if (hasUvs) {
+                    geometry.uvs.insert(geometry.uvs.end(), &uvs[i * 2], &uvs[i * 2] + 2);
+                }
+
+                geometry.indices[i] = id;
+                break;
+            }
+
+            if (std::memcmp(&unique[id * vertexFloats], key, vertexFloats * sizeof(uint32_t)) == 0) {
+                geometry.indices[i] = id;
+                break;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    // release the soup now rather than when the caller's vectors go away
+    positions = {};
+    normals = {};
+    uvs = {};
+
+    geometry.positions.shrink_to_fit();
+    geometry.normals.shrink_to_fit();
+    geometry.uvs.shrink_to_fit();
+
+    return geometry;
+}
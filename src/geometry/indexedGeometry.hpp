@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Unique vertices + triangle list indices.
+ * Attribute arrays are tightly packed: 3 floats per position/normal,
+ * 2 floats per uv (uvs may be empty).
+ **/
+struct IndexedGeometry {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> uvs;
+
+    std::vector<uint32_t> indices;
+
+    std::size_t getVertexCount() const {
+        return positions.size() / 3;
+    }
+
+    std::size_t getTriangleCount() const {
+        return indices.size() / 3;
+    }
+};
+
+namespace MeshIndexing {
+    /**
+     * Welds a fully expanded triangle soup (one vertex per corner) into
+     * unique (position, normal, uv) vertices and an index buffer.
+     * Vertices are compared bitwise except that -0.0 equals +0.0, and keep
+     * the values of their first appearance.
+     **/
+    IndexedGeometry deduplicate(
+        std::vector<float>&& positions,
+        std::vector<float>&& normals,
+        std::vector<float>&& uvs
+    );
+} /* MeshIndexing */
@@ -0,0 +1,354 @@
+#include "meshOptimization.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace {
+    const uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+    const uint32_t CACHE_SIZE = static_cast<uint32_t>(MeshOptimization::CACHE_SIZE);
+
+    /**
+     * FIFO cache simulation: a vertex is cached while fewer than CACHE_SIZE
+     * vertices were loaded after it.
+     **/
+    class CacheSimulation {
+        public:
+            explicit CacheSimulation(std::size_t vertexCount) :
+                timestamps(vertexCount, 0)
+            {}
+
+            // whether the vertex had to be transformed
+            bool load(uint32_t vertex) {
+                if (time - timestamps[vertex] > CACHE_SIZE) {
+                    timestamps[vertex] = time++;
+                    return true;
+                }
+                return false;
+            }
+
+            // vertices loaded since this one (large if it never was)
+            uint32_t getAge(uint32_t vertex) const {
+                return time - timestamps[vertex];
+            }
+
+            void flush() {
+                time += CACHE_SIZE + 1;
+            }
+        private:
+            std::vector<uint32_t> timestamps;
+            uint32_t time = CACHE_SIZE + 1;
+    };
+
+    glm::vec3 getPosition(const std::vector<float>& positions, uint32_t vertex) {
+        return glm::vec3(positions[3 * vertex], positions[3 * vertex + 1], positions[3 * vertex + 2]);
+    }
+}
+
+MeshOptimization::CacheStatistics MeshOptimization::analyzeVertexCache(
+    const uint32_t* indices,
+    std::size_t indexCount,
+    std::size_t vertexCount
+) {
+    CacheStatistics statistics;
+
+    if (indexCount < 3) {
+        return statistics;
+    }
+
+    CacheSimulation cache(vertexCount);
+    std::vector<uint8_t> used(vertexCount, 0);
+
+    std::size_t misses = 0;
+    std::size_t usedCount = 0;
+
+    for (std::size_t i = 0; i < indexCount; i++) {
+        misses += cache.load(indices[i]) ? 1 : 0;
+
+        if (!used[indices[i]]) {
+            used[indices[i]] = 1;
+            usedCount++;
+        }
+    }
+
+    statistics.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    statistics.atvr = static_cast<float>(misses) / static_cast<float>(usedCount);
+
+    return statistics;
+}
+
+void MeshOptimization::optimizeVertexCache(
+    uint32_t* indices,
+    std::size_t indexCount,
+    std::size_t vertexCount,
+    std::vector<uint32_t>* clusters
+) {
+    if (clusters != nullptr) {
+        clusters->clear();
+    }
+
+    if (indexCount < 3) {
+        return;
+    }
+
+    // triangles around each vertex, and how many of them are left
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (std::size_t i = 0; i < indexCount; i++) {
+        offsets[indices[i] + 1]++;
+    }
+
+    std::vector<uint32_t> live(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; v++) {
+        live[v] = offsets[v + 1];
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < indexCount; i++) {
+            adjacency[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    CacheSimulation cache(vertexCount);
+    std::vector<uint8_t> emitted(indexCount / 3, 0);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+
+    std::vector<uint32_t> result;
+    result.reserve(indexCount);
+
+    uint32_t cursor = 0;
+    uint32_t fan = indices[0];
+
+    if (clusters != nullptr) {
+        clusters->push_back(0);
+    }
+
+    while (fan != INVALID) {
+        candidates.clear();
+
+        // emit every remaining triangle around the fanning vertex
+        for (uint32_t i = offsets[fan]; i < offsets[fan + 1]; i++) {
+            uint32_t triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[3 * triangle + corner];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                cache.load(v);
+            }
+
+            emitted[triangle] = 1;
+        }
+
+        // Next, the neighbor that stays cached while its remaining triangles
+        // are emitted, the oldest first; any neighbor with triangles left
+        // otherwise
+        uint32_t next = INVALID;
+        int64_t best = -1;
+
+        for (auto v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (cache.getAge(v) + 2 * live[v] <= CACHE_SIZE) {
+                priority = cache.getAge(v);
+            }
+
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+
+        if (next == INVALID) {
+            // dead end: the most recent vertex with triangles left, or the
+            // next one in input order
+            while (!deadEnds.empty() && next == INVALID) {
+                uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                }
+            }
+
+            while (next == INVALID && cursor < vertexCount) {
+                if (live[cursor] > 0) {
+                    next = cursor;
+                }
+                cursor++;
+            }
+
+            if (next != INVALID && clusters != nullptr) {
+                clusters->push_back(static_cast<uint32_t>(result.size() / 3));
+            }
+        }
+
+        fan = next;
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimization::optimizeOverdraw(
+    uint32_t* indices,
+    std::size_t indexCount,
+    const std::vector<float>& positions,
+    const std::vector<uint32_t>& clusters,
+    float threshold,
+    std::vector<uint32_t>* runs
+) {
+    std::size_t triangleCount = indexCount / 3;
+
+    if (triangleCount == 0 || clusters.empty()) {
+        if (runs != nullptr) {
+            *runs = clusters;
+        }
+        return;
+    }
+
+    float meshAcmr = analyzeVertexCache(indices, indexCount, positions.size() / 3).acmr;
+
+    // Split the clusters wherever the part so far, drawn on its own from a
+    // cold cache, is about as cache friendly as the whole mesh
+    std::vector<uint32_t> splits;
+    CacheSimulation cache(positions.size() / 3);
+
+    for (std::size_t c = 0; c < clusters.size(); c++) {
+        std::size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        std::size_t start = clusters[c];
+        std::size_t misses = 0;
+
+        cache.flush();
+        splits.push_back(static_cast<uint32_t>(start));
+
+        for (std::size_t t = start; t < end; t++) {
+            for (int corner = 0; corner < 3; corner++) {
+                misses += cache.load(indices[3 * t + corner]) ? 1 : 0;
+            }
+
+            auto triangles = static_cast<float>(t + 1 - start);
+
+            if (t + 1 < end && static_cast<float>(misses) <= threshold * meshAcmr * triangles) {
+                cache.flush();
+                splits.push_back(static_cast<uint32_t>(t + 1));
+                start = t + 1;
+                misses = 0;
+            }
+        }
+    }
+
+    // area weighted centroid and normal of every cluster, and of the mesh
+    std::vector<glm::vec3> centroids(splits.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(splits.size(), glm::vec3(0.0f));
+    std::vector<float> areas(splits.size(), 0.0f);
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (std::size_t c = 0; c < splits.size(); c++) {
+        std::size_t end = c + 1 < splits.size() ? splits[c + 1] : triangleCount;
+
+        for (std::size_t t = splits[c]; t < end; t++) {
+            glm::vec3 p0 = getPosition(positions, indices[3 * t]);
+            glm::vec3 p1 = getPosition(positions, indices[3 * t + 1]);
+            glm::vec3 p2 = getPosition(positions, indices[3 * t + 2]);
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    // clusters facing away from the center come first
+    std::vector<float> keys(splits.size(), 0.0f);
+
+    for (std::size_t c = 0; c < splits.size(); c++) {
+        float length = glm::length(normals[c]);
+        if (areas[c] > 0.0f && length > 0.0f) {
+            keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / length);
+        }
+    }
+
+    std::vector<uint32_t> order(splits.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indexCount);
+
+    if (runs != nullptr) {
+        runs->clear();
+    }
+
+    for (auto c : order) {
+        std::size_t end = c + 1 < splits.size() ? splits[c + 1] : triangleCount;
+
+        if (runs != nullptr) {
+            runs->push_back(static_cast<uint32_t>(result.size() / 3));
+        }
+
+        result.insert(result.end(), indices + 3 * splits[c], indices + 3 * end);
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimization::optimizeVertexFetch(IndexedGeometry& geometry) {
+    std::size_t vertexCount = geometry.getVertexCount();
+
+    std::vector<uint32_t> remap(vertexCount, INVALID);
+    uint32_t next = 0;
+
+    for (auto& index : geometry.indices) {
+        if (remap[index] == INVALID) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    auto permute = [&remap, next](std::vector<float>& values, std::size_t components) {
+        std::vector<float> result(static_cast<std::size_t>(next) * components);
+
+        for (std::size_t v = 0; v < remap.size(); v++) {
+            if (remap[v] != INVALID) {
+                std::copy_n(&values[v * components], components, &result[remap[v] * components]);
+            }
+        }
+
+        values.swap(result);
+    };
+
+    permute(geometry.positions, 3);
+
+    if (geometry.normals.size() == vertexCount * 3) {
+        permute(geometry.normals, 3);
+    }
+
+    if (geometry.uvs.size() == vertexCount * 2) {
+        permute(geometry.uvs, 2);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "geometry/indexedGeometry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Import time reordering of indexed triangle lists for the GPU:
+ * post-transform vertex cache locality (Tipsify), then overdraw (clusters of
+ * the cache ordered outside in), then vertex fetch locality.
+ *
+ * Index ranges are reordered in place; triangle winding is kept.
+ **/
+namespace MeshOptimization {
+    // FIFO post-transform cache size the orderings aim for, and analysis simulates
+    constexpr std::size_t CACHE_SIZE = 16;
+
+    struct CacheStatistics {
+        // average cache misses per triangle (0.5 at best on large meshes, 3 at worst)
+        float acmr = 0.0f;
+        // average transforms per vertex used (1 at best)
+        float atvr = 0.0f;
+    };
+
+    // Simulates a FIFO cache of CACHE_SIZE over the triangles
+    CacheStatistics analyzeVertexCache(const uint32_t* indices, std::size_t indexCount, std::size_t vertexCount);
+
+    /**
+     * Reorders triangles for the vertex cache (Sander et al. 2007, "Fast
+     * Triangle Reordering for Vertex Locality and Reduced Overdraw"): fans
+     * around a vertex, moving on to the neighbor that will still be cached.
+     *
+     * If clusters is given, it receives the offsets (in triangles) at which
+     * the ordering had to jump, i.e. where the cache starts over.
+     **/
+    void optimizeVertexCache(
+        uint32_t* indices,
+        std::size_t indexCount,
+        std::size_t vertexCount,
+        std::vector<uint32_t>* clusters = nullptr
+    );
+
+    /**
+     * Reorders runs of triangles from optimizeVertexCache so surfaces facing
+     * out of the mesh come first, which draws likely occluders first.
+     * clusters are split further wherever the split costs less than
+     * threshold times the mesh's ACMR; a threshold of 0 keeps them whole.
+     *
+     * If runs is given, it receives the offsets (in triangles) of the runs
+     * in their new order.
+     **/
+    void optimizeOverdraw(
+        uint32_t* indices,
+        std::size_t indexCount,
+        const std::vector<float>& positions,
+        const std::vector<uint32_t>& clusters,
+        float threshold = 1.05f,
+        std::vector<uint32_t>* runs = nullptr
+    );
+
+    // Renumbers vertices in order of first use by the indices (all of them,
+    // so every level of detail stays valid) and drops unused vertices
+    void optimizeVertexFetch(IndexedGeometry& geometry);
+} /* MeshOptimization */
@@ -0,0 +1,462 @@
+#include "meshSimplification.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace {
+    const uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+
+    // cos(60 degrees); collapses that turn triangles further leave slivers
+    // standing on edge, even if they don't flip them
+    const float MAX_ROTATION_COSINE = 0.5f;
+
+    /**
+     * Sum of the weighted squared distances to a set of planes, as a
+     * symmetric 4x4 matrix, along with the summed weight.
+     **/
+    struct Quadric {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+        double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+        double a22 = 0.0, a23 = 0.0;
+        double a33 = 0.0;
+        double weight = 0.0;
+
+        // plane ax + by + cz + d = 0, with a unit normal
+        void addPlane(double a, double b, double c, double d, double w) {
+            a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * d;
+            a11 += w * b * b; a12 += w * b * c; a13 += w * b * d;
+            a22 += w * c * c; a23 += w * c * d;
+            a33 += w * d * d;
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric& other) {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+            weight += other.weight;
+            return *this;
+        }
+
+        double evaluate(double x, double y, double z) const {
+            return
+                a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+                a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+                a22 * z * z + 2.0 * a23 * z +
+                a33;
+        }
+    };
+
+    /**
+     * Collapse state shared by the levels of one mesh: quadrics keep
+     * accumulating, so every level's error is measured against the original
+     * surface.
+     **/
+    class Simplifier {
+        public:
+            Simplifier(const std::vector<float>& positions, const std::vector<uint32_t>& indices);
+
+            // Collapses edges until indices holds at most targetIndexCount
+            // indices or nothing more can collapse. Returns the largest
+            // collapse error so far, as a distance
+            float simplify(std::vector<uint32_t>& indices, std::size_t targetIndexCount);
+        private:
+            const std::vector<float>& positions;
+
+            // vertices with bitwise equal positions share a group (and quadric)
+            std::vector<uint32_t> groups;
+            std::vector<Quadric> quadrics;
+            // on a border or an attribute seam
+            std::vector<uint8_t> locked;
+
+            double maxError = 0.0;
+
+            // per pass: triangles around each vertex, best collapse per vertex
+            std::vector<uint32_t> adjacencyOffsets;
+            std::vector<uint32_t> adjacency;
+            std::vector<uint32_t> targets;
+            std::vector<double> costs;
+            std::vector<uint32_t> order;
+            std::vector<uint8_t> touched;
+            std::vector<uint32_t> remap;
+            std::vector<uint32_t> fromNeighbors;
+            std::vector<uint32_t> toNeighbors;
+
+            glm::vec3 getPosition(uint32_t vertex) const {
+                return glm::vec3(positions[3 * vertex], positions[3 * vertex + 1], positions[3 * vertex + 2]);
+            }
+
+            // mean squared distance to the planes of both vertices, at to
+            double getCost(uint32_t from, uint32_t to) const;
+            // whether moving from onto to turns one of from's triangles by
+            // more than 60 degrees
+            bool flips(const std::vector<uint32_t>& indices, uint32_t from, uint32_t to) const;
+            // whether the edge's end points share neighbors other than the
+            // ones opposite the edge, which would fold the surface onto itself
+            bool pinches(const std::vector<uint32_t>& indices, uint32_t from, uint32_t to);
+            void gatherNeighbors(const std::vector<uint32_t>& indices, uint32_t vertex, std::vector<uint32_t>& result) const;
+            void buildAdjacency(const std::vector<uint32_t>& indices);
+    };
+
+    Simplifier::Simplifier(const std::vector<float>& positions, const std::vector<uint32_t>& indices) :
+        positions(positions)
+    {
+        auto vertexCount = static_cast<uint32_t>(positions.size() / 3);
+
+        // group vertices by position: sort by the bit patterns, then number the runs
+        std::vector<uint32_t> sorted(vertexCount);
+        std::iota(sorted.begin(), sorted.end(), 0);
+
+        auto compare = [&positions](uint32_t a, uint32_t b) {
+            return std::memcmp(&positions[3 * a], &positions[3 * b], 3 * sizeof(float)) < 0;
+        };
+        std::sort(sorted.begin(), sorted.end(), compare);
+
+        groups.resize(vertexCount);
+        std::vector<uint32_t> groupSizes;
+
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            if (i == 0 || compare(sorted[i - 1], sorted[i])) {
+                groupSizes.push_back(0);
+            }
+            groups[sorted[i]] = static_cast<uint32_t>(groupSizes.size() - 1);
+            groupSizes.back()++;
+        }
+
+        // area weighted triangle planes
+        quadrics.resize(groupSizes.size());
+
+        for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+            glm::vec3 p0 = getPosition(indices[t]);
+            glm::vec3 normal = glm::cross(getPosition(indices[t + 1]) - p0, getPosition(indices[t + 2]) - p0);
+            float length = glm::length(normal);
+
+            if (length == 0.0f) {
+                continue;
+            }
+
+            normal /= length;
+            double d = -static_cast<double>(glm::dot(normal, p0));
+
+            for (int corner = 0; corner < 3; corner++) {
+                quadrics[groups[indices[t + corner]]].addPlane(normal.x, normal.y, normal.z, d, 0.5 * length);
+            }
+        }
+
+        // edges used by one triangle are borders, by more than two non-manifold
+        std::vector<uint64_t> edges;
+        edges.reserve(indices.size());
+
+        for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint64_t a = groups[indices[t + corner]];
+                uint64_t b = groups[indices[t + (corner + 1) % 3]];
+                edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+
+        std::vector<uint8_t> lockedGroups(groupSizes.size(), 0);
+
+        for (std::size_t i = 0; i < edges.size();) {
+            std::size_t end = i;
+            while (end < edges.size() && edges[end] == edges[i]) {
+                end++;
+            }
+
+            if (end - i != 2) {
+                lockedGroups[edges[i] >> 32] = 1;
+                lockedGroups[edges[i] & 0xffffffffu] = 1;
+            }
+
+            i = end;
+        }
+
+        // several vertices at one position differ in normal or uv
+        locked.resize(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            locked[v] = lockedGroups[groups[v]] || groupSizes[groups[v]] > 1;
+        }
+    }
+
+    double Simplifier::getCost(uint32_t from, uint32_t to) const {
+        Quadric quadric = quadrics[groups[from]];
+        quadric += quadrics[groups[to]];
+
+        glm::vec3 p = getPosition(to);
+        double error = std::max(quadric.evaluate(p.x, p.y, p.z), 0.0);
+
+        return quadric.weight > 0.0 ? error / quadric.weight : 0.0;
+    }
+
+    bool Simplifier::flips(const std::vector<uint32_t>& indices, uint32_t from, uint32_t to) const {
+        glm::vec3 moved = getPosition(to);
+
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++) {
+            const uint32_t* triangle = &indices[3 * adjacency[i]];
+
+            // triangles on the edge disappear
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                continue;
+            }
+
+            glm::vec3 before[3];
+            glm::vec3 after[3];
+
+            for (int corner = 0; corner < 3; corner++) {
+                before[corner] = getPosition(triangle[corner]);
+                after[corner] = triangle[corner] == from ? moved : before[corner];
+            }
+
+            glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+            float limit = MAX_ROTATION_COSINE * glm::length(normalBefore) * glm::length(normalAfter);
+
+            if (glm::dot(normalBefore, normalAfter) <= limit) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Simplifier::gatherNeighbors(const std::vector<uint32_t>& indices, uint32_t vertex, std::vector<uint32_t>& result) const {
+        result.clear();
+
+        for (uint32_t i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++) {
+            const uint32_t* triangle = &indices[3 * adjacency[i]];
+            result.insert(result.end(), triangle, triangle + 3);
+        }
+
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+
+    bool Simplifier::pinches(const std::vector<uint32_t>& indices, uint32_t from, uint32_t to) {
+        std::size_t shared = 0;
+
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++) {
+            const uint32_t* triangle = &indices[3 * adjacency[i]];
+            shared += triangle[0] == to || triangle[1] == to || triangle[2] == to;
+        }
+
+        gatherNeighbors(indices, from, fromNeighbors);
+        gatherNeighbors(indices, to, toNeighbors);
+
+        // both lists hold from and to themselves
+        std::size_t common = 0;
+        auto a = fromNeighbors.begin();
+        auto b = toNeighbors.begin();
+
+        while (a != fromNeighbors.end() && b != toNeighbors.end()) {
+            if (*a < *b) {
+                a++;
+            } else if (*b < *a) {
+                b++;
+            } else {
+                common++;
+                a++;
+                b++;
+            }
+        }
+
+        return common - 2 > shared;
+    }
+
+    void Simplifier::buildAdjacency(const std::vector<uint32_t>& indices) {
+        std::size_t vertexCount = groups.size();
+
+        adjacencyOffsets.assign(vertexCount + 1, 0);
+        for (auto index : indices) {
+            adjacencyOffsets[index + 1]++;
+        }
+
+        for (std::size_t v = 0; v < vertexCount; v++) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+
+        adjacency.resize(indices.size());
+
+        for (std::size_t i = 0; i < indices.size(); i++) {
+            adjacency[adjacencyOffsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // every offset was advanced to the start of the next vertex
+        for (std::size_t v = vertexCount; v > 0; v--) {
+            adjacencyOffsets[v] = adjacencyOffsets[v - 1];
+        }
+        adjacencyOffsets[0] = 0;
+    }
+
+    float Simplifier::simplify(std::vector<uint32_t>& indices, std::size_t targetIndexCount) {
+        auto vertexCount = static_cast<uint32_t>(groups.size());
+
+        targets.resize(vertexCount);
+        costs.resize(vertexCount);
+
+        while (indices.size() > targetIndexCount) {
+            buildAdjacency(indices);
+
+            // cheapest collapse of every vertex that may move
+            order.clear();
+
+            for (uint32_t u = 0; u < vertexCount; u++) {
+                if (locked[u]) {
+                    continue;
+                }
+
+                uint32_t best = INVALID;
+                double bestCost = std::numeric_limits<double>::max();
+
+                for (uint32_t i = adjacencyOffsets[u]; i < adjacencyOffsets[u + 1]; i++) {
+                    for (int corner = 0; corner < 3; corner++) {
+                        uint32_t v = indices[3 * adjacency[i] + corner];
+                        if (v == u) {
+                            continue;
+                        }
+
+                        double cost = getCost(u, v);
+                        if (cost < bestCost) {
+                            best = v;
+                            bestCost = cost;
+                        }
+                    }
+                }
+
+                if (best != INVALID) {
+                    targets[u] = best;
+                    costs[u] = bestCost;
+                    order.push_back(u);
+                }
+            }
+
+            std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+                return costs[a] < costs[b];
+            });
+
+            // a collapse removes about two triangles
+            std::size_t goal = (indices.size() - targetIndexCount) / 6 + 1;
+            std::size_t collapses = 0;
+
+            touched.assign(vertexCount, 0);
+            remap.resize(vertexCount);
+            std::iota(remap.begin(), remap.end(), 0);
+
+            // Collapses in one pass must not share triangles, so each one's
+            // flip test still holds once they are all applied
+            for (auto u : order) {
+                if (collapses >= goal) {
+                    break;
+                }
+
+                uint32_t v = targets[u];
+
+                if (touched[u] || touched[v] || flips(indices, u, v) || pinches(indices, u, v)) {
+                    continue;
+                }
+
+                remap[u] = v;
+                quadrics[groups[v]] += quadrics[groups[u]];
+                maxError = std::max(maxError, costs[u]);
+
+                for (uint32_t i = adjacencyOffsets[u]; i < adjacencyOffsets[u + 1]; i++) {
+                    for (int corner = 0; corner < 3; corner++) {
+                        touched[indices[3 * adjacency[i] + corner]] = 1;
+                    }
+                }
+
+                collapses++;
+            }
+
+            if (collapses == 0) {
+                break;
+            }
+
+            // drop the triangles that lost an edge
+            std::size_t count = 0;
+
+            for (std::size_t t = 0; t + 2 < indices.size(); t += 3) {
+                uint32_t a = remap[indices[t]];
+                uint32_t b = remap[indices[t + 1]];
+                uint32_t c = remap[indices[t + 2]];
+
+                if (a == b || b == c || c == a) {
+                    continue;
+                }
+
+                indices[count++] = a;
+                indices[count++] = b;
+                indices[count++] = c;
+            }
+
+            indices.resize(count);
+        }
+
+        return static_cast<float>(std::sqrt(maxError));
+    }
+}
+
+std::vector<LodLevel> MeshSimplification::buildLods(IndexedGeometry& geometry, float radius) {
+    std::vector<LodLevel> levels(1);
+    levels[0].indexCount = static_cast<uint32_t>(geometry.indices.size());
+
+    if (geometry.getTriangleCount() < MIN_TRIANGLES || radius <= 0.0f) {
+        return levels;
+    }
+
+    Simplifier simplifier(geometry.positions, geometry.indices);
+    std::vector<uint32_t> indices = geometry.indices;
+
+    while (levels.size() < MAX_LEVELS) {
+        std::size_t previous = indices.size();
+
+        float error = simplifier.simplify(indices, previous / 6 * 3);
+
+        // simplification stalled (e.g. mostly borders and seams left)
+        if (indices.empty() || indices.size() > previous * 4 / 5) {
+            break;
+        }
+
+        LodLevel level;
+        level.firstIndex = static_cast<uint32_t>(geometry.indices.size());
+        level.indexCount = static_cast<uint32_t>(indices.size());
+        level.error = error / radius;
+        levels.push_back(level);
+
+        geometry.indices.insert(geometry.indices.end(), indices.begin(), indices.end());
+    }
+
+    return levels;
+}
+
+std::size_t MeshSimplification::selectLod(const std::vector<LodLevel>& lods, std::size_t current, float pixelRadius) {
+    // coarsest levels within the limit, and within it by the margin
+    std::size_t fits = 0;
+    std::size_t fitsWithMargin = 0;
+
+    for (std::size_t level = 1; level < lods.size(); level++) {
+        float error = lods[level].error * pixelRadius;
+
+        if (error <= LOD_PIXEL_ERROR) {
+            fits = level;
+        }
+        if (error <= LOD_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS)) {
+            fitsWithMargin = level;
+        }
+    }
+
+    // too coarse: refine right away, coarsen only past the margin
+    if (current > fits) {
+        return fits;
+    }
+
+    return std::max(current, fitsWithMargin);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "geometry/indexedGeometry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * One level of detail of a mesh: a range of its index buffer. Every level
+ * indexes the same vertices.
+ **/
+struct LodLevel {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    // how far simplification may have moved the surface, relative to the
+    // radius of the mesh's bounding sphere (0 at full detail)
+    float error = 0.0f;
+};
+
+namespace MeshSimplification {
+    // including the full detail level
+    constexpr std::size_t MAX_LEVELS = 5;
+    // smaller meshes are only ever drawn at full detail
+    constexpr std::size_t MIN_TRIANGLES = 512;
+    // screen space error, in pixels, a level of detail may have
+    constexpr float LOD_PIXEL_ERROR = 1.0f;
+    // a coarser level is only switched to once its error is this far below
+    // the limit, so models near a threshold don't flip between levels
+    constexpr float LOD_HYSTERESIS = 0.5f;
+
+    /**
+     * Builds a chain of levels of detail, each with about half the triangles
+     * of the one before, by collapsing edges in order of their quadric error
+     * (Garland & Heckbert). Vertices only collapse onto a neighbor, so the
+     * levels share the vertex buffer; vertices on borders and attribute
+     * (normal/uv) seams never move.
+     *
+     * Appends the new levels' indices to geometry.indices and returns every
+     * level, full detail first. radius is the mesh's bounding sphere radius.
+     **/
+    std::vector<LodLevel> buildLods(IndexedGeometry& geometry, float radius);
+
+    // The level to draw next, given the current one; pixelRadius is the size
+    // of the mesh's bounding sphere on screen
+    std::size_t selectLod(const std::vector<LodLevel>& lods, std::size_t current, float pixelRadius);
+} /* MeshSimplification */
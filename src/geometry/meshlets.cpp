@@ -0,0 +1,334 @@
+#include "meshlets.hpp"
+
+#include "geometry/bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    const uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+
+    // Cones wider than this (the triangle normals spread by almost 90 degrees
+    // from the axis) would hardly ever be culled
+    const float MIN_CONE_COSINE = 0.1f;
+
+    glm::vec3 getPosition(const std::vector<float>& positions, uint32_t vertex) {
+        return glm::vec3(positions[3 * vertex], positions[3 * vertex + 1], positions[3 * vertex + 2]);
+    }
+
+    // One id per distinct position, for every vertex; vertices split only by
+    // their normal or uv share it
+    std::vector<uint32_t> weldPositions(const std::vector<float>& positions) {
+        std::size_t vertexCount = positions.size() / 3;
+
+        std::vector<uint32_t> order(vertexCount);
+        for (std::size_t v = 0; v < vertexCount; v++) {
+            order[v] = static_cast<uint32_t>(v);
+        }
+
+        auto less = [&positions](uint32_t a, uint32_t b) {
+            return std::lexicographical_compare(&positions[3 * a], &positions[3 * a + 3], &positions[3 * b], &positions[3 * b + 3]);
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        std::vector<uint32_t> ids(vertexCount, 0);
+        uint32_t id = 0;
+
+        for (std::size_t i = 1; i < vertexCount; i++) {
+            if (less(order[i - 1], order[i])) {
+                id++;
+            }
+            ids[order[i]] = id;
+        }
+
+        return ids;
+    }
+
+    Meshlet makeMeshlet(
+        const uint32_t* indices,
+        std::size_t firstIndex,
+        std::size_t indexCount,
+        const std::vector<float>& positions
+    ) {
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(firstIndex);
+        meshlet.indexCount = static_cast<uint32_t>(indexCount);
+
+        const uint32_t* begin = indices + firstIndex;
+        const uint32_t* end = begin + indexCount;
+
+        // sphere around the box, like the mesh bounds
+        AABB box = AABB::empty();
+        for (const uint32_t* index = begin; index != end; index++) {
+            box.expand(getPosition(positions, *index));
+        }
+
+        meshlet.center = box.getCenter();
+
+        for (const uint32_t* index = begin; index != end; index++) {
+            meshlet.radius = std::max(meshlet.radius, glm::length(getPosition(positions, *index) - meshlet.center));
+        }
+
+        // cone axis: the average direction the triangles face
+        std::vector<glm::vec3> normals;
+        normals.reserve(indexCount / 3);
+
+        glm::vec3 axis(0.0f);
+
+        for (const uint32_t* triangle = begin; triangle != end; triangle += 3) {
+            glm::vec3 p0 = getPosition(positions, triangle[0]);
+            glm::vec3 normal = glm::cross(getPosition(positions, triangle[1]) - p0, getPosition(positions, triangle[2]) - p0);
+
+            float length = glm::length(normal);
+            if (length > 0.0f) {
+                normals.push_back(normal / length);
+                axis += normals.back();
+            }
+        }
+
+        float axisLength = glm::length(axis);
+        if (normals.empty() || axisLength <= 0.0f) {
+            return meshlet;
+        }
+
+        axis /= axisLength;
+
+        float minCosine = 1.0f;
+        for (const auto& normal : normals) {
+            minCosine = std::min(minCosine, glm::dot(normal, axis));
+        }
+
+        if (minCosine <= MIN_CONE_COSINE) {
+            return meshlet;
+        }
+
+        // The triangles face away once the view direction is within 90
+        // degrees minus the cone's half angle of the axis: sin of the half angle
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - minCosine * minCosine);
+
+        return meshlet;
+    }
+}
+
+std::vector<uint32_t> Meshlets::partition(uint32_t* indices, std::size_t indexCount, const std::vector<float>& positions) {
+    std::size_t triangleCount = indexCount / 3;
+    std::vector<uint32_t> offsets;
+
+    if (triangleCount == 0) {
+        return offsets;
+    }
+
+    auto vertexPositions = weldPositions(positions);
+    std::size_t positionCount = 0;
+    for (auto position : vertexPositions) {
+        positionCount = std::max(positionCount, static_cast<std::size_t>(position) + 1);
+    }
+
+    // triangles around each position; the first liveCounts[p] are not in a
+    // meshlet yet
+    std::vector<uint32_t> adjacencyOffsets(positionCount + 1, 0);
+    std::vector<uint32_t> liveCounts(positionCount, 0);
+
+    for (std::size_t i = 0; i < 3 * triangleCount; i++) {
+        liveCounts[vertexPositions[indices[i]]]++;
+    }
+    for (std::size_t p = 0; p < positionCount; p++) {
+        adjacencyOffsets[p + 1] = adjacencyOffsets[p] + liveCounts[p];
+        liveCounts[p] = 0;
+    }
+
+    std::vector<uint32_t> adjacency(3 * triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+
+    for (std::size_t t = 0; t < triangleCount; t++) {
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t position = vertexPositions[indices[3 * t + corner]];
+            adjacency[adjacencyOffsets[position] + liveCounts[position]++] = static_cast<uint32_t>(t);
+        }
+
+        centroids[t] = (
+            getPosition(positions, indices[3 * t]) +
+            getPosition(positions, indices[3 * t + 1]) +
+            getPosition(positions, indices[3 * t + 2])
+        ) / 3.0f;
+    }
+
+    auto takeTriangle = [&](uint32_t triangle) {
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t position = vertexPositions[indices[3 * triangle + corner]];
+            uint32_t* live = &adjacency[adjacencyOffsets[position]];
+            uint32_t* last = live + --liveCounts[position];
+            std::iter_swap(std::find(live, last + 1, triangle), last);
+        }
+    };
+
+    std::vector<uint8_t> taken(triangleCount, 0);
+    std::vector<uint32_t> result;
+    result.reserve(3 * triangleCount);
+
+    // meshlet each vertex / position was last added to
+    std::vector<uint32_t> vertexOwners(positions.size() / 3, INVALID);
+    std::vector<uint32_t> positionOwners(positionCount, INVALID);
+
+    // positions of the meshlet (before) with triangles left around them
+    std::vector<uint32_t> border;
+    std::vector<uint32_t> previousBorder;
+
+    std::size_t cursor = 0;
+
+    for (uint32_t meshlet = 0; result.size() < 3 * triangleCount; meshlet++) {
+        // the triangle left with the fewest others around it, so corners
+        // don't end up as meshlets of their own
+        uint32_t next = INVALID;
+        uint32_t fewest = std::numeric_limits<uint32_t>::max();
+
+        for (auto position : previousBorder) {
+            for (uint32_t i = 0; i < liveCounts[position]; i++) {
+                uint32_t triangle = adjacency[adjacencyOffsets[position] + i];
+                uint32_t neighbors = 0;
+
+                for (int corner = 0; corner < 3; corner++) {
+                    neighbors += liveCounts[vertexPositions[indices[3 * triangle + corner]]];
+                }
+
+                if (neighbors < fewest) {
+                    fewest = neighbors;
+                    next = triangle;
+                }
+            }
+        }
+
+        if (next == INVALID) {
+            while (taken[cursor]) {
+                cursor++;
+            }
+            next = static_cast<uint32_t>(cursor);
+        }
+
+        offsets.push_back(static_cast<uint32_t>(result.size() / 3));
+        border.clear();
+
+        std::size_t vertexCount = 0;
+        std::size_t meshletTriangles = 0;
+        glm::vec3 centroidSum(0.0f);
+
+        while (next != INVALID) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[3 * next + corner];
+                result.push_back(vertex);
+
+                if (vertexOwners[vertex] != meshlet) {
+                    vertexOwners[vertex] = meshlet;
+                    vertexCount++;
+                }
+
+                uint32_t position = vertexPositions[vertex];
+                if (positionOwners[position] != meshlet) {
+                    positionOwners[position] = meshlet;
+                    border.push_back(position);
+                }
+            }
+
+            taken[next] = 1;
+            takeTriangle(next);
+
+            centroidSum += centroids[next];
+            meshletTriangles++;
+
+            if (meshletTriangles == MAX_TRIANGLES) {
+                break;
+            }
+
+            glm::vec3 center = centroidSum / static_cast<float>(meshletTriangles);
+
+            next = INVALID;
+            std::size_t fewestAdded = 4;
+            float nearest = std::numeric_limits<float>::max();
+
+            for (std::size_t b = 0; b < border.size();) {
+                uint32_t position = border[b];
+
+                if (liveCounts[position] == 0) {
+                    border[b] = border.back();
+                    border.pop_back();
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < liveCounts[position]; i++) {
+                    uint32_t triangle = adjacency[adjacencyOffsets[position] + i];
+
+                    std::size_t added = 0;
+                    for (int corner = 0; corner < 3; corner++) {
+                        added += vertexOwners[indices[3 * triangle + corner]] != meshlet ? 1 : 0;
+                    }
+
+                    if (vertexCount + added > MAX_VERTICES || added > fewestAdded) {
+                        continue;
+                    }
+
+                    glm::vec3 offset = centroids[triangle] - center;
+                    float distance = glm::dot(offset, offset);
+
+                    if (added < fewestAdded || distance < nearest) {
+                        fewestAdded = added;
+                        nearest = distance;
+                        next = triangle;
+                    }
+                }
+
+                b++;
+            }
+        }
+
+        previousBorder.clear();
+        for (auto position : border) {
+            if (liveCounts[position] > 0) {
+                previousBorder.push_back(position);
+            }
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+
+    return offsets;
+}
+
+std::vector<Meshlet> Meshlets::build(
+    const uint32_t* indices,
+    std::size_t indexCount,
+    const std::vector<float>& positions,
+    const std::vector<uint32_t>& offsets
+) {
+    std::vector<Meshlet> meshlets;
+    meshlets.reserve(offsets.size());
+
+    std::size_t triangleCount = indexCount / 3;
+
+    for (std::size_t m = 0; m < offsets.size(); m++) {
+        std::size_t end = m + 1 < offsets.size() ? offsets[m + 1] : triangleCount;
+        meshlets.push_back(makeMeshlet(indices, 3 * offsets[m], 3 * (end - offsets[m]), positions));
+    }
+
+    return meshlets;
+}
+
+bool Meshlets::isVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& viewPosition, bool cullBackFaces) {
+    BoundingSphere sphere;
+    sphere.center = meshlet.center;
+    sphere.radius = meshlet.radius;
+
+    if (!frustum.intersects(sphere)) {
+        return false;
+    }
+
+    if (cullBackFaces) {
+        glm::vec3 direction = meshlet.center - viewPosition;
+        if (glm::dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(direction) + meshlet.radius) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "geometry/frustum.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A small cluster of a mesh's triangles: a range of its full detail indices,
+ * with a bounding sphere and normal cone to cull it by.
+ **/
+struct Meshlet {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // Every triangle faces away from a viewer at v if
+    // dot(center - v, coneAxis) >= coneCutoff * length(center - v) + radius.
+    // coneCutoff is 1 when the triangles face too many ways to ever be culled
+    glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float coneCutoff = 1.0f;
+};
+
+static_assert(sizeof(Meshlet) == 40, "Meshlet is stored as is in the mesh cache");
+
+namespace Meshlets {
+    constexpr std::size_t MAX_VERTICES = 64;
+    constexpr std::size_t MAX_TRIANGLES = 124;
+    // smaller meshes are cheaper to draw whole than to cull in pieces
+    constexpr std::size_t MIN_TRIANGLES = 4096;
+
+    /**
+     * Reorders the triangles into meshlets of at most MAX_VERTICES vertices
+     * and MAX_TRIANGLES triangles, and returns the offset (in triangles) at
+     * which each starts. A meshlet grows from a seed over the triangles
+     * sharing a position with it (so across normal and uv seams), taking
+     * those that add the fewest vertices first, then those nearest its
+     * center, so it stays compact. The next seed is the most enclosed
+     * triangle left next to the meshlet before, or the first one left in the
+     * given order.
+     **/
+    std::vector<uint32_t> partition(uint32_t* indices, std::size_t indexCount, const std::vector<float>& positions);
+
+    /**
+     * Bounds and normal cones of the meshlets starting at the given offsets
+     * (in triangles, see partition). firstIndex is relative to indices.
+     **/
+    std::vector<Meshlet> build(
+        const uint32_t* indices,
+        std::size_t indexCount,
+        const std::vector<float>& positions,
+        const std::vector<uint32_t>& offsets
+    );
+
+    // Whether part of the meshlet can be seen through frustum by a viewer at
+    // viewPosition, both in the mesh's object space. With cullBackFaces a
+    // meshlet facing away from the viewer is hidden too
+    bool isVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& viewPosition, bool cullBackFaces);
+} /* Meshlets */
@@ -0,0 +1,213 @@
+#include "geometryArena.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <ostream>
+
+namespace {
+    // Reallocates buffer to newBytes, keeping its name and first oldBytes
+    void growBuffer(GLuint buffer, std::size_t oldBytes, std::size_t newBytes) {
+        GLuint temporary = 0;
+        glGenBuffers(1, &temporary);
+
+        // the copy targets leave the array and element bindings alone
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, temporary);
+        glBufferData(GL_COPY_WRITE_BUFFER, oldBytes, nullptr, GL_STREAM_COPY);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, temporary);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+
+        glDeleteBuffers(1, &temporary);
+    }
+
+    // Allocates size units, growing the allocator (by doubling) and its
+    // buffer until they fit
+    std::size_t allocateGrowing(RangeAllocator& allocator, std::size_t size, GLuint buffer, std::size_t unitBytes) {
+        std::size_t offset = allocator.allocate(size);
+
+        while (offset == RangeAllocator::INVALID) {
+            std::size_t oldCapacity = allocator.getCapacity();
+            std::size_t newCapacity = std::max(2 * oldCapacity, oldCapacity + size);
+
+            growBuffer(buffer, oldCapacity * unitBytes, newCapacity * unitBytes);
+            allocator.grow(newCapacity);
+
+            offset = allocator.allocate(size);
+        }
+
+        return offset;
+    }
+
+    void upload(GLuint buffer, std::size_t offset, std::size_t bytes, const void* data) {
+        if (bytes == 0 || data == nullptr) {
+            return;
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, data);
+    }
+}
+
+const uint32_t GeometryArena::NO_FORMAT = std::numeric_limits<uint32_t>::max();
+const std::size_t GeometryArena::INITIAL_VERTEX_BYTES = 16 << 20;
+const std::size_t GeometryArena::INITIAL_INDEX_BYTES = 8 << 20;
+
+GeometryArena::~GeometryArena() {
+    for (auto& format : formats) {
+        glDeleteVertexArrays(1, &format.vertexArray);
+        glDeleteBuffers(1, &format.vertexBuffer);
+        glDeleteBuffers(1, &format.indexBuffer);
+    }
+}
+
+GeometryArena& GeometryArena::shared() {
+    static GeometryArena arena;
+    return arena;
+}
+
+uint32_t GeometryArena::getFormat(const VertexLayout& layout, bool hasUvs) {
+    for (std::size_t f = 0; f < formats.size(); f++) {
+        if (formats[f].layout == layout && formats[f].hasUvs == hasUvs) {
+            return static_cast<uint32_t>(f);
+        }
+    }
+
+    Format format;
+    format.layout = layout;
+    format.hasUvs = hasUvs;
+    format.stride = layout.getStride(hasUvs);
+    format.vertices.grow(INITIAL_VERTEX_BYTES / format.stride);
+    format.indices.grow(INITIAL_INDEX_BYTES / INDEX_ALIGNMENT);
+
+    glGenBuffers(1, &format.vertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, format.vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, format.vertices.getCapacity() * format.stride, nullptr, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &format.indexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, format.indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, format.indices.getCapacity() * INDEX_ALIGNMENT, nullptr, GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &format.vertexArray);
+    glBindVertexArray(format.vertexArray);
+    setVertexAttributes(format);
+    glBindVertexArray(0);
+
+    formats.push_back(std::move(format));
+
+    return static_cast<uint32_t>(formats.size() - 1);
+}
+
+GeometryArena::VertexRange GeometryArena::allocateVertices(uint32_t f, const void* data, uint32_t count) {
+    auto& format = formats[f];
+
+    VertexRange range;
+    range.format = f;
+    range.count = count;
+
+    if (count == 0) {
+        return range;
+    }
+
+    range.first = static_cast<uint32_t>(allocateGrowing(format.vertices, count, format.vertexBuffer, format.stride));
+    upload(format.vertexBuffer, range.first * format.stride, count * format.stride, data);
+    format.vertexRanges++;
+
+    return range;
+}
+
+GeometryArena::IndexRange GeometryArena::allocateIndices(uint32_t f, const void* data, std::size_t bytes) {
+    auto& format = formats[f];
+
+    IndexRange range;
+    range.format = f;
+    range.bytes = bytes;
+
+    if (bytes == 0) {
+        return range;
+    }
+
+    std::size_t words = (bytes + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT;
+
+    range.offset = allocateGrowing(format.indices, words, format.indexBuffer, INDEX_ALIGNMENT) * INDEX_ALIGNMENT;
+    upload(format.indexBuffer, range.offset, bytes, data);
+    format.indexRanges++;
+
+    return range;
+}
+
+void GeometryArena::free(VertexRange& range) {
+    if (range.format != NO_FORMAT && range.count > 0) {
+        auto& format = formats[range.format];
+        format.vertices.free(range.first, range.count);
+        format.vertexRanges--;
+    }
+
+    range = VertexRange();
+}
+
+void GeometryArena::free(IndexRange& range) {
+    if (range.format != NO_FORMAT && range.bytes > 0) {
+        auto& format = formats[range.format];
+        format.indices.free(range.offset / INDEX_ALIGNMENT, (range.bytes + INDEX_ALIGNMENT - 1) / INDEX_ALIGNMENT);
+        format.indexRanges--;
+    }
+
+    range = IndexRange();
+}
+
+GLuint GeometryArena::createVertexArray(uint32_t format) const {
+    GLuint vao = 0;
+    glGenVertexArrays(1, &vao);
+
+    glBindVertexArray(vao);
+    setVertexAttributes(formats[format]);
+
+    return vao;
+}
+
+void GeometryArena::setVertexAttributes(const Format& format) const {
+    glBindBuffer(GL_ARRAY_BUFFER, format.vertexBuffer);
+    format.layout.apply(format.hasUvs);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, format.indexBuffer);
+}
+
+GeometryArena::Statistics GeometryArena::getStatistics() const {
+    Statistics statistics;
+    statistics.formats = formats.size();
+
+    for (const auto& format : formats) {
+        statistics.vertexRanges += format.vertexRanges;
+        statistics.indexRanges += format.indexRanges;
+
+        statistics.vertexBytes += format.vertices.getCapacity() * format.stride;
+        statistics.vertexBytesUsed += format.vertices.getUsed() * format.stride;
+        statistics.indexBytes += format.indices.getCapacity() * INDEX_ALIGNMENT;
+        statistics.indexBytesUsed += format.indices.getUsed() * INDEX_ALIGNMENT;
+
+        statistics.freeBlocks += format.vertices.getFreeBlockCount() + format.indices.getFreeBlockCount();
+
+        statistics.vertexFragmentation = std::max(statistics.vertexFragmentation, format.vertices.getFragmentation());
+        statistics.indexFragmentation = std::max(statistics.indexFragmentation, format.indices.getFragmentation());
+    }
+
+    return statistics;
+}
+
+std::ostream& operator<<(std::ostream& os, const GeometryArena::Statistics& statistics) {
+    auto kilobytes = [](std::size_t bytes) {
+        return bytes / 1024;
+    };
+
+    return os << statistics.formats << " formats, "
+        << statistics.vertexRanges << " vertex ranges ("
+        << kilobytes(statistics.vertexBytesUsed) << " / " << kilobytes(statistics.vertexBytes) << " KB), "
+        << statistics.indexRanges << " index ranges ("
+        << kilobytes(statistics.indexBytesUsed) << " / " << kilobytes(statistics.indexBytes) << " KB), "
+        << statistics.freeBlocks << " free blocks, fragmentation "
+        << statistics.vertexFragmentation << " vertices / "
+        << statistics.indexFragmentation << " indices";
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "gl/vertexLayout.hpp"
+#include "util/rangeAllocator.hpp"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+/**
+ * Process-wide vertex and index storage for every mesh.
+ *
+ * Each vertex format (layout, with or without uvs) gets one large vertex
+ * buffer, one index buffer and one VAO over them; meshes only own ranges of
+ * those (see GLObject), and are drawn with their base vertex and index
+ * offset. Switching meshes of the same format needs no VAO bind, and
+ * batches (see MultiDrawBatch) can draw them all with one call.
+ *
+ * Ranges come from a free list (see RangeAllocator) and are returned when
+ * their GLObject is destroyed. Full buffers grow in place: their names stay
+ * the same, so VAOs made over them stay valid.
+ * Must only be used from the GL thread.
+ **/
+class GeometryArena {
+    public:
+        static const uint32_t NO_FORMAT;
+        // size of a new format's buffers, doubled whenever they are full
+        static const std::size_t INITIAL_VERTEX_BYTES;
+        static const std::size_t INITIAL_INDEX_BYTES;
+        // index ranges start on multiples of this, so any index type is aligned
+        static const std::size_t INDEX_ALIGNMENT = 4;
+
+        // Vertices [first, first + count) of a format's vertex buffer;
+        // first is the base vertex to draw with
+        struct VertexRange {
+            uint32_t format = NO_FORMAT;
+            uint32_t first = 0;
+            uint32_t count = 0;
+        };
+
+        // Bytes [offset, offset + bytes) of a format's index buffer
+        struct IndexRange {
+            uint32_t format = NO_FORMAT;
+            std::size_t offset = 0;
+            std::size_t bytes = 0;
+        };
+
+        struct Statistics {
+            std::size_t formats = 0;
+            std::size_t vertexRanges = 0;
+            std::size_t indexRanges = 0;
+
+            // buffer sizes and the bytes in live ranges, over all formats
+            std::size_t vertexBytes = 0;
+            std::size_t vertexBytesUsed = 0;
+            std::size_t indexBytes = 0;
+            std::size_t indexBytesUsed = 0;
+
+            // holes between (and after) live ranges
+            std::size_t freeBlocks = 0;
+
+            // worst format, see RangeAllocator::getFragmentation
+            float vertexFragmentation = 0.0f;
+            float indexFragmentation = 0.0f;
+        };
+
+        GeometryArena() = default;
+        ~GeometryArena();
+
+        GeometryArena(GeometryArena&& other) = delete;
+        GeometryArena& operator=(GeometryArena&& other) = delete;
+
+        GeometryArena(const GeometryArena& other) = delete;
+        GeometryArena& operator=(const GeometryArena& other) = delete;
+
+        static GeometryArena& shared();
+
+        // The format's index, created on first use
+        uint32_t getFormat(const VertexLayout& layout, bool hasUvs);
+
+        // Copies count vertices, already packed in the format's layout
+        VertexRange allocateVertices(uint32_t format, const void* data, uint32_t count);
+        // Copies bytes of indices (of any type) into the format's index buffer
+        IndexRange allocateIndices(uint32_t format, const void* data, std::size_t bytes);
+
+        // Returns the range's space and resets it
+        void free(VertexRange& range);
+        void free(IndexRange& range);
+
+        // The format's VAO, with the vertex attributes and index buffer
+        GLuint getVertexArray(uint32_t format) const {
+            return formats[format].vertexArray;
+        }
+
+        // A new VAO over the format's buffers, e.g. to add per-instance
+        // attributes. Left bound; the caller owns it
+        GLuint createVertexArray(uint32_t format) const;
+
+        GLuint getVertexBuffer(uint32_t format) const {
+            return formats[format].vertexBuffer;
+        }
+
+        GLuint getIndexBuffer(uint32_t format) const {
+            return formats[format].indexBuffer;
+        }
+
+        Statistics getStatistics() const;
+    private:
+        struct Format {
+            VertexLayout layout;
+            bool hasUvs = false;
+            std::size_t stride = 0;
+
+            GLuint vertexArray = 0;
+            GLuint vertexBuffer = 0;
+            GLuint indexBuffer = 0;
+
+            // in vertices
+            RangeAllocator vertices;
+            // in INDEX_ALIGNMENT byte words
+            RangeAllocator indices;
+
+            std::size_t vertexRanges = 0;
+            std::size_t indexRanges = 0;
+        };
+
+        std::vector<Format> formats;
+
+        void setVertexAttributes(const Format& format) const;
+};
+
+std::ostream& operator<<(std::ostream& os, const GeometryArena::Statistics& statistics);
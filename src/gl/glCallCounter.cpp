@@ -0,0 +1,146 @@
+#include "glStats.hpp"
+
+#include <GL/glew.h>
+
+#include <dlfcn.h>
+
+// Counts every GL call the renderer makes into GLStats::Counters::glCalls.
+//
+// Entry points past GL 1.1 are GLEW function pointers, which countAllCalls
+// swaps for counting wrappers. GL 1.1 functions are linked from libGL
+// directly, so they are interposed instead: the definitions below take
+// precedence over libGL's within the executable and forward to it.
+//
+// Only built with -DCOUNT_GL_CALLS=ON, so that regular builds keep calling
+// GL directly.
+
+namespace {
+    template <auto pointer>
+    struct Counted;
+
+    template <typename R, typename... Args, R (GLAPIENTRY** pointer)(Args...)>
+    struct Counted<pointer> {
+        static inline R (GLAPIENTRY* original)(Args...) = nullptr;
+
+        static R GLAPIENTRY call(Args... args) {
+            GLStats::frame().glCalls++;
+            return original(args...);
+        }
+
+        static void install() {
+            // absent from the context, leave it be
+            if (*pointer == nullptr || *pointer == &call) {
+                return;
+            }
+
+            original = *pointer;
+            *pointer = &call;
+        }
+    };
+}
+
+#define COUNT_GL_1_1(name, parameters, arguments) \
+    extern "C" void GLAPIENTRY name parameters { \
+        static auto original = reinterpret_cast<void (GLAPIENTRY*) parameters>(dlsym(RTLD_NEXT, #name)); \
+        GLStats::frame().glCalls++; \
+        original arguments; \
+    }
+
+COUNT_GL_1_1(glBindTexture, (GLenum target, GLuint texture), (target, texture))
+COUNT_GL_1_1(glBlendFunc, (GLenum sfactor, GLenum dfactor), (sfactor, dfactor))
+COUNT_GL_1_1(glClear, (GLbitfield mask), (mask))
+COUNT_GL_1_1(glClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha), (red, green, blue, alpha))
+COUNT_GL_1_1(glClearStencil, (GLint s), (s))
+COUNT_GL_1_1(glColorMask, (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha), (red, green, blue, alpha))
+COUNT_GL_1_1(glCullFace, (GLenum mode), (mode))
+COUNT_GL_1_1(glDeleteTextures, (GLsizei n, const GLuint* textures), (n, textures))
+COUNT_GL_1_1(glDepthFunc, (GLenum func), (func))
+COUNT_GL_1_1(glDepthMask, (GLboolean flag), (flag))
+COUNT_GL_1_1(glDisable, (GLenum cap), (cap))
+COUNT_GL_1_1(glDrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+COUNT_GL_1_1(glDrawElements, (GLenum mode, GLsizei count, GLenum type, const void* indices), (mode, count, type, indices))
+COUNT_GL_1_1(glEnable, (GLenum cap), (cap))
+COUNT_GL_1_1(glGenTextures, (GLsizei n, GLuint* textures), (n, textures))
+COUNT_GL_1_1(glGetIntegerv, (GLenum pname, GLint* data), (pname, data))
+COUNT_GL_1_1(glGetTexImage, (GLenum target, GLint level, GLenum format, GLenum type, void* pixels), (target, level, format, type, pixels))
+COUNT_GL_1_1(glStencilFunc, (GLenum func, GLint ref, GLuint mask), (func, ref, mask))
+COUNT_GL_1_1(glStencilMask, (GLuint mask), (mask))
+COUNT_GL_1_1(glStencilOp, (GLenum fail, GLenum zfail, GLenum zpass), (fail, zfail, zpass))
+COUNT_GL_1_1(glTexImage2D, (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels), (target, level, internalformat, width, height, border, format, type, pixels))
+COUNT_GL_1_1(glTexParameteri, (GLenum target, GLenum pname, GLint param), (target, pname, param))
+COUNT_GL_1_1(glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+
+#undef COUNT_GL_1_1
+
+void GLStats::countAllCalls() {
+    Counted<&__glewActiveTexture>::install();
+    Counted<&__glewAttachShader>::install();
+    Counted<&__glewBeginQuery>::install();
+    Counted<&__glewBindBuffer>::install();
+    Counted<&__glewBindBufferBase>::install();
+    Counted<&__glewBindFramebuffer>::install();
+    Counted<&__glewBindRenderbuffer>::install();
+    Counted<&__glewBindVertexArray>::install();
+    Counted<&__glewBlitFramebuffer>::install();
+    Counted<&__glewBufferData>::install();
+    Counted<&__glewBufferSubData>::install();
+    Counted<&__glewCheckFramebufferStatus>::install();
+    Counted<&__glewClientWaitSync>::install();
+    Counted<&__glewCompileShader>::install();
+    Counted<&__glewCopyBufferSubData>::install();
+    Counted<&__glewCreateProgram>::install();
+    Counted<&__glewCreateShader>::install();
+    Counted<&__glewDeleteBuffers>::install();
+    Counted<&__glewDeleteFramebuffers>::install();
+    Counted<&__glewDeleteProgram>::install();
+    Counted<&__glewDeleteQueries>::install();
+    Counted<&__glewDeleteRenderbuffers>::install();
+    Counted<&__glewDeleteShader>::install();
+    Counted<&__glewDeleteSync>::install();
+    Counted<&__glewDeleteVertexArrays>::install();
+    Counted<&__glewDisableVertexAttribArray>::install();
+    Counted<&__glewDrawBuffers>::install();
+    Counted<&__glewDrawElementsBaseVertex>::install();
+    Counted<&__glewDrawElementsInstancedBaseVertex>::install();
+    Counted<&__glewEnableVertexAttribArray>::install();
+    Counted<&__glewEndQuery>::install();
+    Counted<&__glewFenceSync>::install();
+    Counted<&__glewFramebufferRenderbuffer>::install();
+    Counted<&__glewFramebufferTexture2D>::install();
+    Counted<&__glewGenBuffers>::install();
+    Counted<&__glewGenFramebuffers>::install();
+    Counted<&__glewGenQueries>::install();
+    Counted<&__glewGenRenderbuffers>::install();
+    Counted<&__glewGenVertexArrays>::install();
+    Counted<&__glewGenerateMipmap>::install();
+    Counted<&__glewGetProgramInfoLog>::install();
+    Counted<&__glewGetProgramiv>::install();
+    Counted<&__glewGetQueryObjectiv>::install();
+    Counted<&__glewGetQueryObjectui64v>::install();
+    Counted<&__glewGetShaderInfoLog>::install();
+    Counted<&__glewGetShaderiv>::install();
+    Counted<&__glewGetUniformBlockIndex>::install();
+    Counted<&__glewGetUniformLocation>::install();
+    Counted<&__glewLinkProgram>::install();
+    Counted<&__glewMapBufferRange>::install();
+    Counted<&__glewMultiDrawElementsBaseVertex>::install();
+    Counted<&__glewMultiDrawElementsIndirect>::install();
+    Counted<&__glewRenderbufferStorage>::install();
+    Counted<&__glewRenderbufferStorageMultisample>::install();
+    Counted<&__glewShaderSource>::install();
+    Counted<&__glewStencilOpSeparate>::install();
+    Counted<&__glewTexBuffer>::install();
+    Counted<&__glewUniform1f>::install();
+    Counted<&__glewUniform1i>::install();
+    Counted<&__glewUniform2i>::install();
+    Counted<&__glewUniform3fv>::install();
+    Counted<&__glewUniform4fv>::install();
+    Counted<&__glewUniformBlockBinding>::install();
+    Counted<&__glewUniformMatrix3fv>::install();
+    Counted<&__glewUniformMatrix4fv>::install();
+    Counted<&__glewUnmapBuffer>::install();
+    Counted<&__glewUseProgram>::install();
+    Counted<&__glewVertexAttribDivisor>::install();
+    Counted<&__glewVertexAttribIPointer>::install();
+    Counted<&__glewVertexAttribPointer>::install();
+}
@@ -1,63 +1,128 @@
 #include "glObject.hpp"
 
+#include <cstring>
 #include <iostream>
+#include <limits>
 
-GLObject::GLObject() {
-    createVertexArrayObject();
-}
+GLObject::GLObject() { }
 
 GLObject::GLObject(
     std::vector<float>&& vs,
-    std::vector<float>&& ns
-) {
-    createVertexArrayObject();
-    setVertices(std::move(vs));
-    setNormals(std::move(ns));
+    std::vector<float>&& ns,
+    std::vector<float>&& ts,
+    std::vector<uint32_t>&& is,
+    VertexLayout l,
+    HostCopy h
+) :
+    layout(l),
+    hostCopy(h)
+{
+    setVertices(std::move(vs), std::move(ns), std::move(ts));
+    setIndices(std::move(is));
 }
 
-GLObject::~GLObject() {
-    glDeleteVertexArrays(1, &vertexArrayObject);
+GLObject::GLObject(
+    const void* vertexData,
+    std::size_t vertexBytes,
+    uint32_t vertexCount,
+    bool hasUvs,
+    const void* indexData,
+    uint32_t indexCount,
+    GLenum indexType,
+    VertexLayout l
+) :
+    layout(l)
+{
+    setPackedVertices(vertexData, vertexBytes, vertexCount, hasUvs);
+    setPackedIndices(indexData, indexCount, indexType);
+}
 
-    glDeleteBuffers(1, &vertexBuffer);
-    glDeleteBuffers(1, &normalBuffer);
+GLObject::~GLObject() {
+    auto& arena = GeometryArena::shared();
+    arena.free(indexRange);
+    arena.free(vertexRange);
 }
 
-void GLObject::createVertexArrayObject() {
-    glGenVertexArrays(1, &vertexArrayObject);
+void GLObject::setVertices(std::vector<float>&& vs, std::vector<float>&& ns, std::vector<float>&& ts) {
+    auto interleaved = layout.pack(vs, ns, ts);
+    setPackedVertices(interleaved.data(), interleaved.size(), vs.size() / 3, !ts.empty());
+
+    if (hostCopy == HostCopy::keep) {
+        vertices = std::move(vs);
+        normals = std::move(ns);
+        uvs = std::move(ts);
+    } else {
+        vertices = {};
+        normals = {};
+        uvs = {};
+    }
 }
 
-void GLObject::setVertices(std::vector<float>&& vs) {
-    vertices.clear();
-    for (auto vtx : vs) {
-        vertices.push_back(vtx);
+void GLObject::setPackedVertices(const void* vertexData, std::size_t vertexBytes, uint32_t count, bool withUvs) {
+    vertexCount = count;
+    hasUvs = withUvs;
+
+    auto& arena = GeometryArena::shared();
+    auto format = arena.getFormat(layout, hasUvs);
+
+    // indices live in the format's index buffer too
+    if (indexRange.format != format) {
+        arena.free(indexRange);
     }
-    vertexCount = vertices.size() / 3;
 
-    if (vertexBuffer == 0) {
-        glGenBuffers(1, &vertexBuffer);
+    arena.free(vertexRange);
 
-        glBindVertexArray(vertexArrayObject);
-        glEnableVertexAttribArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    if (vertexBytes != count * layout.getStride(hasUvs)) {
+        std::cout << "Vertex data (" << vertexBytes << " bytes) does not match its layout" << std::endl;
+        vertexRange = arena.allocateVertices(format, nullptr, count);
+        return;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(GL_FLOAT), vertices.data(), GL_STATIC_DRAW);
+    vertexRange = arena.allocateVertices(format, vertexData, count);
 }
 
-void GLObject::setNormals(std::vector<float>&& ns) {
-    normals = std::move(ns);
+void GLObject::setIndices(std::vector<uint32_t>&& is) {
+    auto type = selectIndexType(vertexCount);
+    auto packed = packIndices(is, type);
+    setPackedIndices(packed.data(), is.size(), type);
+
+    if (hostCopy == HostCopy::keep) {
+        indices = std::move(is);
+    } else {
+        indices = {};
+    }
+}
+
+void GLObject::setPackedIndices(const void* indexData, uint32_t count, GLenum type) {
+    indexCount = count;
+    indexType = type;
+
+    auto indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    // in the buffer of the vertices' format
+    auto& arena = GeometryArena::shared();
+    arena.free(indexRange);
+    indexRange = arena.allocateIndices(arena.getFormat(layout, hasUvs), indexData, indexCount * indexSize);
+}
+
+GLenum GLObject::selectIndexType(uint32_t vertexCount) {
+    // half the index bandwidth for small meshes
+    return vertexCount <= std::numeric_limits<uint16_t>::max() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
 
-    if (normalBuffer == 0) {
-        glGenBuffers(1, &normalBuffer);
+std::vector<uint8_t> GLObject::packIndices(const std::vector<uint32_t>& is, GLenum type) {
+    std::vector<uint8_t> packed;
 
-        glBindVertexArray(vertexArrayObject);
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    if (type == GL_UNSIGNED_SHORT) {
+        packed.resize(is.size() * sizeof(uint16_t));
+        auto out = reinterpret_cast<uint16_t*>(packed.data());
+        for (std::size_t i = 0; i < is.size(); i++) {
+            out[i] = static_cast<uint16_t>(is[i]);
+        }
+    } else {
+        packed.resize(is.size() * sizeof(uint32_t));
+        std::memcpy(packed.data(), is.data(), packed.size());
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(GL_FLOAT), normals.data(), GL_STATIC_DRAW);
+    return packed;
 }
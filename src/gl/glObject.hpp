@@ -1,42 +1,162 @@
 #pragma once
 
+#include "gl/geometryArena.hpp"
+#include "gl/vertexLayout.hpp"
+
 #include <GL/glew.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
+// Whether a GLObject keeps its source arrays around after they are uploaded
+enum class HostCopy {
+    release,
+    keep
+};
 
+/**
+ * A mesh's vertices and indices, stored as ranges of the GeometryArena
+ * buffers of its vertex format. Draws bind the format's VAO and use the base
+ * vertex and index offset; destroying the object returns its ranges.
+ **/
 class GLObject {
     public:
         GLObject();
-        GLObject(std::vector<float>&& vs, std::vector<float>&& ns);
+        GLObject(
+            std::vector<float>&& vs,
+            std::vector<float>&& ns,
+            std::vector<float>&& ts,
+            std::vector<uint32_t>&& is,
+            VertexLayout layout = VertexLayout(),
+            HostCopy hostCopy = HostCopy::release
+        );
+        // Uploads already packed data (e.g. straight from a mapped mesh cache file)
+        GLObject(
+            const void* vertexData,
+            std::size_t vertexBytes,
+            uint32_t vertexCount,
+            bool hasUvs,
+            const void* indexData,
+            uint32_t indexCount,
+            GLenum indexType,
+            VertexLayout layout
+        );
         ~GLObject();
 
-        GLObject(GLObject&& other) = default;
-        GLObject(const GLObject& other) = default;
+        // owns its arena ranges
+        GLObject(GLObject&& other) = delete;
+        GLObject& operator=(GLObject&& other) = delete;
+
+        GLObject(const GLObject& other) = delete;
+        GLObject& operator=(const GLObject& other) = delete;
 
-        GLObject& operator=(const GLObject& other) = default;
-        GLObject& operator=(GLObject&& other) = default;
+        // Packs the attributes into one interleaved vertex buffer using the
+        // current layout (uvs may be empty)
+        void setVertices(
+            std::vector<float>&& vertices,
+            std::vector<float>&& normals,
+            std::vector<float>&& uvs
+        );
+        // Stored as GL_UNSIGNED_SHORT when every index fits, GL_UNSIGNED_INT otherwise
+        void setIndices(std::vector<uint32_t>&& indices);
 
-        void setVertices(std::vector<float>&& vertices);
-        void setNormals(std::vector<float>&& normals);
+        // vertexData must already be in this object's layout
+        void setPackedVertices(const void* vertexData, std::size_t vertexBytes, uint32_t vertexCount, bool hasUvs);
+        void setPackedIndices(const void* indexData, uint32_t indexCount, GLenum indexType);
 
+        // Smallest index type that can address vertexCount vertices
+        static GLenum selectIndexType(uint32_t vertexCount);
+        // Narrows indices to the given type, as raw bytes
+        static std::vector<uint8_t> packIndices(const std::vector<uint32_t>& indices, GLenum indexType);
+
+        // Shared by every object of the same vertex format
         GLuint getVertexArrayObject() const {
-            return vertexArrayObject;
+            return GeometryArena::shared().getVertexArray(vertexRange.format);
+        }
+
+        // A new VAO over the same vertex and index buffers, e.g. to add
+        // per-instance attributes. Left bound; the caller owns it
+        GLuint createVertexArray() const {
+            return GeometryArena::shared().createVertexArray(vertexRange.format);
+        }
+
+        // GeometryArena format, the same for objects that share buffers
+        uint32_t getFormat() const {
+            return vertexRange.format;
+        }
+
+        // To add to indices, see glDrawElementsBaseVertex
+        GLint getBaseVertex() const {
+            return static_cast<GLint>(vertexRange.first);
+        }
+
+        // Byte offset of the first index in the index buffer
+        std::size_t getIndexOffset() const {
+            return indexRange.offset;
         }
 
         uint32_t getVertexCount() const {
             return vertexCount;
         }
+
+        uint32_t getIndexCount() const {
+            return indexCount;
+        }
+
+        GLenum getIndexType() const {
+            return indexType;
+        }
+
+        const VertexLayout& getLayout() const {
+            return layout;
+        }
+
+        bool hasUvAttribute() const {
+            return hasUvs;
+        }
+
+        // The format's interleaved vertex buffer (see VertexLayout) and
+        // index buffer, which hold this object's data at the base vertex and
+        // index offset
+        GLuint getVertexBuffer() const {
+            return GeometryArena::shared().getVertexBuffer(vertexRange.format);
+        }
+
+        GLuint getIndexBuffer() const {
+            return GeometryArena::shared().getIndexBuffer(vertexRange.format);
+        }
+
+        // Only populated with HostCopy::keep
+        const std::vector<float>& getVertices() const {
+            return vertices;
+        }
+
+        const std::vector<float>& getNormals() const {
+            return normals;
+        }
+
+        const std::vector<float>& getUvs() const {
+            return uvs;
+        }
+
+        const std::vector<uint32_t>& getIndices() const {
+            return indices;
+        }
     private:
         uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
 
-        GLuint vertexArrayObject = 0;
-        GLuint vertexBuffer = 0;
-        GLuint normalBuffer = 0;
+        VertexLayout layout;
+        bool hasUvs = false;
+        HostCopy hostCopy = HostCopy::release;
+
+        GeometryArena::VertexRange vertexRange;
+        GeometryArena::IndexRange indexRange;
 
         std::vector<float> vertices = {};
         std::vector<float> normals = {};
-        // std::vector<float> uvs;
-
-        void createVertexArrayObject();
+        std::vector<float> uvs = {};
+        std::vector<uint32_t> indices = {};
 };
@@ -0,0 +1,42 @@
+#include "glStats.hpp"
+
+#include <ostream>
+
+namespace GLStats {
+    namespace {
+        Counters current;
+        Counters previous;
+    }
+
+    Counters& frame() {
+        return current;
+    }
+
+    const Counters& last() {
+        return previous;
+    }
+
+    void endFrame() {
+        previous = current;
+        current = Counters();
+    }
+
+    std::ostream& operator<<(std::ostream& os, const Counters& counters) {
+#ifdef COUNT_GL_CALLS
+        os << counters.glCalls << " GL calls, " << counters.getTotal() << " of them drawing models (";
+#else
+        os << counters.getTotal() << " GL calls drawing models (";
+#endif
+        return os << counters.getStateChanges() << " state changes: "
+            << counters.programBinds << " programs, "
+            << counters.vertexArrayBinds << " vertex arrays, "
+            << counters.cullFaceChanges << " cull faces; "
+            << counters.uniformLookups << " lookups, "
+            << counters.uniformUploads << " uniforms, "
+            << counters.drawCalls << " draws, "
+            << counters.triangles << " triangles, "
+            << counters.culledModels << " models culled, "
+            << counters.occludedModels << " occluded, "
+            << counters.culledClusters << " clusters culled)";
+    }
+} /* GLStats */
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+
+/**
+ * Per-frame counters: every GL call of the frame (when built with
+ * COUNT_GL_CALLS, which installs countAllCalls), and a breakdown of the calls made while drawing scene
+ * geometry through Material/Model (state changes, uniform location
+ * lookups, uniform uploads, draw calls).
+ **/
+namespace GLStats {
+    struct Counters {
+        // all GL calls, from the renderer, effects and materials alike; only
+        // counted when built with COUNT_GL_CALLS
+        std::size_t glCalls = 0;
+
+        std::size_t programBinds = 0;
+        std::size_t vertexArrayBinds = 0;
+        std::size_t cullFaceChanges = 0;
+        std::size_t uniformLookups = 0;
+        std::size_t uniformUploads = 0;
+        std::size_t drawCalls = 0;
+        // triangles drawn, not a GL call
+        std::size_t triangles = 0;
+        // models skipped by frustum culling, not a GL call
+        std::size_t culledModels = 0;
+        // models in the frustum but hidden behind the Hi-Z depth
+        std::size_t occludedModels = 0;
+        // mesh clusters outside the frustum or facing away
+        std::size_t culledClusters = 0;
+
+        std::size_t getStateChanges() const {
+            return programBinds + vertexArrayBinds + cullFaceChanges;
+        }
+
+        // of the Material/Model calls
+        std::size_t getTotal() const {
+            return getStateChanges() + uniformLookups + uniformUploads + drawCalls;
+        }
+    };
+
+    // Counters of the frame currently being recorded
+    Counters& frame();
+
+    // Counters of the last completed frame
+    const Counters& last();
+
+    void endFrame();
+
+    // Makes every GL entry point the renderer uses count into glCalls; call
+    // once, after glewInit. Only built with COUNT_GL_CALLS (see
+    // glCallCounter.cpp)
+    void countAllCalls();
+
+    std::ostream& operator<<(std::ostream& os, const Counters& counters);
+} /* GLStats */
@@ -0,0 +1,32 @@
+#include "gpuTimer.hpp"
+
+GPUTimer::~GPUTimer() {
+    glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+void GPUTimer::initialize() {
+    glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+}
+
+void GPUTimer::begin() const {
+    GLuint query = queries[spans % queries.size()];
+
+    // the span issued last time this query was used has had a frame to finish
+    if (spans >= queries.size()) {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (available) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            milliseconds = static_cast<float>(nanoseconds) / 1.0e6f;
+        }
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void GPUTimer::end() const {
+    glEndQuery(GL_TIME_ELAPSED);
+    spans++;
+}
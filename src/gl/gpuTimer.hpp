@@ -0,0 +1,40 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+
+/**
+ * GPU time of a span of GL commands, measured with GL_TIME_ELAPSED queries.
+ * Spans alternate between two queries and each is read back when its slot
+ * comes around again, a frame later, so timing never stalls on the GPU.
+ * Only one span (of any timer) may be open at a time.
+ **/
+class GPUTimer {
+    public:
+        GPUTimer() = default;
+
+        GPUTimer(GPUTimer&& other) = delete;
+        GPUTimer& operator=(GPUTimer&& other) = delete;
+
+        GPUTimer(const GPUTimer& other) = delete;
+        GPUTimer& operator=(const GPUTimer& other) = delete;
+
+        ~GPUTimer();
+
+        void initialize();
+
+        // Brackets the commands to time
+        void begin() const;
+        void end() const;
+
+        // Of the latest span read back, 0 until the first one is
+        float getMilliseconds() const {
+            return milliseconds;
+        }
+    private:
+        std::array<GLuint, 2> queries = {};
+        mutable std::size_t spans = 0;
+        mutable float milliseconds = 0.0f;
+};
@@ -0,0 +1,7 @@
+#include "shaderProgram.hpp"
+
+ShaderProgram::ShaderProgram(GLuint p) : program(p) {}
+
+ShaderProgram::~ShaderProgram() {
+    glDeleteProgram(program);
+}
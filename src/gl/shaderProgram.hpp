@@ -0,0 +1,36 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/**
+ * Owns a linked GL program. Programs are shared (see ResourceCache), so
+ * the program also remembers which user last uploaded its per-user
+ * uniform values.
+ **/
+class ShaderProgram {
+    public:
+        explicit ShaderProgram(GLuint program);
+        ~ShaderProgram();
+
+        ShaderProgram(ShaderProgram&& other) = delete;
+        ShaderProgram& operator=(ShaderProgram&& other) = delete;
+
+        ShaderProgram(const ShaderProgram& other) = delete;
+        ShaderProgram& operator=(const ShaderProgram& other) = delete;
+
+        GLuint get() const {
+            return program;
+        }
+
+        // Marks owner as the user whose values are currently in the program's
+        // uniforms. Returns true if that changed (and the values must be re-sent)
+        bool claim(const void* owner) const {
+            bool changed = owner != currentOwner;
+            currentOwner = owner;
+            return changed;
+        }
+    private:
+        GLuint program = 0;
+
+        mutable const void* currentOwner = nullptr;
+};
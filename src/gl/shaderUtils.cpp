@@ -73,3 +73,411 @@ GLuint ShaderUtils::compile(std::string vs, std::string fs) {
 
     return program;
 }
+
+void ShaderUtils::bindUniformBlock(GLuint program, const char* name, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(program, name);
+
+    if (index == GL_INVALID_INDEX) {
+        return;
+    }
+
+    glUniformBlockBinding(program, index, binding);
+}
+
+std::string ShaderUtils::addDefine(const std::string& source, const char* name) {
+    auto version = source.find("#version");
+    if (version == std::string::npos) {
+        return "#define " + std::string(name) + "\n" + source;
+    }
+
+    auto lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return source + "\n#define " + std::string(name) + "\n";
+    }
+
+    std::string result = source;
+    result.insert(lineEnd + 1, "#define " + std::string(name) + "\n");
+    return result;
+}
+
+const char* const ShaderUtils::OCTAHEDRAL_DECODE = R"(
+    vec3 decodeOctahedral(vec2 e) {
+        vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+        if (n.z < 0.0) {
+            n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        }
+        return normalize(n);
+    }
+)";
+
+const char* const ShaderUtils::LIGHTS_BLOCK = R"(
+    #define MAX_LIGHTS 10
+
+    struct Light {
+        vec4 position;
+        vec3 color;
+        float intensity;
+        float ambientCoefficient;
+        float attenuation;
+        float enabled;
+        // spotlight only
+        float coneAngle;
+        vec3 coneDirection;
+        // see Light::getRadius
+        float radius;
+    };
+
+    layout(std140) uniform Lights {
+        int numLights;
+        Light lights[MAX_LIGHTS];
+    };
+
+    // 1 / (1 + coefficient * d^2), windowed to reach 0 at the light's radius,
+    // where it is culled, instead of stopping there with a step
+    float attenuate(float distance, float coefficient, float radius) {
+        float x = distance / radius;
+        float window = clamp(1.0 - x * x * x * x, 0.0, 1.0);
+
+        return window * window / (1.0 + coefficient * distance * distance);
+    }
+)";
+
+const char* const ShaderUtils::FRAME_BLOCK = R"(
+    layout(std140) uniform Frame {
+        mat4 projectionMatrix;
+        mat4 viewMatrix;
+        mat4 inverseProjectionMatrix;
+        mat4 inverseViewMatrix;
+        // this frame's eye space to the previous frame's clip space
+        mat4 reprojectionMatrix;
+        vec2 viewportSize;
+        float time;
+        // 1 while the deferred pass uses the compact G-buffer layout
+        float compactGBuffer;
+        // counts the frames rendered
+        uint frameIndex;
+    };
+)";
+
+const char* const ShaderUtils::MATERIAL_VERTEX_INPUTS = R"(
+    // octahedral normals arrive as 2 snorm16, see VertexLayout
+    #ifdef OCTAHEDRAL_NORMALS
+    layout(location = 1) in vec2 normal;
+
+    vec3 vertexNormal() {
+        return decodeOctahedral(normal);
+    }
+    #else
+    layout(location = 1) in vec3 normal;
+
+    vec3 vertexNormal() {
+        return normal;
+    }
+    #endif
+
+    #ifdef INSTANCED
+    // per-instance attributes, must match InstanceAttributes
+    layout(location = 3) in mat4 instanceModelMatrix;
+    layout(location = 7) in mat3 instanceNormalMatrix;
+    // rgb + specularCoefficient
+    layout(location = 10) in vec4 instanceColor;
+    // rgb + strength
+    layout(location = 11) in vec4 instanceEmissive;
+    // roughness, metalness, shininess, emissiveEnabled
+    layout(location = 12) in vec4 instanceParameters;
+
+    flat out vec4 vInstanceColor;
+    flat out vec4 vInstanceEmissive;
+    flat out vec4 vInstanceParameters;
+
+    vec4 positionToEyespace(vec3 position) {
+        return viewMatrix * (instanceModelMatrix * vec4(position, 1.0));
+    }
+
+    // instance normal matrices are in world space so they survive camera
+    // moves; the view matrix is rigid, its rotation is its own normal matrix
+    vec3 normalToEyespace(vec3 normal) {
+        return mat3(viewMatrix) * (instanceNormalMatrix * normal);
+    }
+
+    void passMaterial() {
+        vInstanceColor = instanceColor;
+        vInstanceEmissive = instanceEmissive;
+        vInstanceParameters = instanceParameters;
+    }
+    #elif defined(MULTI_DRAW)
+    // draw index relative to firstDraw, see MultiDrawBatch
+    layout(location = 3) in uint drawId;
+    uniform int firstDraw;
+    // model of every draw
+    uniform usamplerBuffer drawModels;
+    // per model: model matrix, normal matrix (3 columns), color, emissive, parameters
+    uniform samplerBuffer drawRecords;
+
+    flat out vec4 vInstanceColor;
+    flat out vec4 vInstanceEmissive;
+    flat out vec4 vInstanceParameters;
+
+    int recordStart = -1;
+
+    vec4 fetchRecord(int texel) {
+        if (recordStart < 0) {
+            recordStart = 10 * int(texelFetch(drawModels, firstDraw + int(drawId)).r);
+        }
+        return texelFetch(drawRecords, recordStart + texel);
+    }
+
+    vec4 positionToEyespace(vec3 position) {
+        mat4 modelMatrix = mat4(fetchRecord(0), fetchRecord(1), fetchRecord(2), fetchRecord(3));
+        return viewMatrix * (modelMatrix * vec4(position, 1.0));
+    }
+
+    // world space, like the instance normal matrices
+    vec3 normalToEyespace(vec3 normal) {
+        mat3 normalMatrix = mat3(fetchRecord(4).xyz, fetchRecord(5).xyz, fetchRecord(6).xyz);
+        return mat3(viewMatrix) * (normalMatrix * normal);
+    }
+
+    void passMaterial() {
+        vInstanceColor = fetchRecord(7);
+        vInstanceEmissive = fetchRecord(8);
+        vInstanceParameters = fetchRecord(9);
+    }
+    #else
+    uniform mat4 modelViewMatrix;
+    // transpose(inverse(mat3(modelViewMatrix))), computed once per object on the CPU
+    uniform mat3 normalMatrix;
+
+    vec4 positionToEyespace(vec3 position) {
+        return modelViewMatrix * vec4(position, 1.0);
+    }
+
+    vec3 normalToEyespace(vec3 normal) {
+        return normalMatrix * normal;
+    }
+
+    void passMaterial() {}
+    #endif
+)";
+
+const char* const ShaderUtils::MATERIAL_FRAGMENT_INPUTS = R"(
+    #if defined(INSTANCED) || defined(MULTI_DRAW)
+    flat in vec4 vInstanceColor;
+    flat in vec4 vInstanceEmissive;
+    flat in vec4 vInstanceParameters;
+
+    vec3 color;
+    float specularCoefficient;
+    float shininess;
+
+    vec3 emissiveColor;
+    float emissiveStrength;
+    float emissiveEnabled;
+
+    float roughness;
+    float metalness;
+
+    void loadMaterial() {
+        color = vInstanceColor.rgb;
+        specularCoefficient = vInstanceColor.a;
+        emissiveColor = vInstanceEmissive.rgb;
+        emissiveStrength = vInstanceEmissive.a;
+        roughness = vInstanceParameters.x;
+        metalness = vInstanceParameters.y;
+        shininess = vInstanceParameters.z;
+        emissiveEnabled = vInstanceParameters.w;
+    }
+    #else
+    uniform vec3 color;
+    uniform float specularCoefficient;
+    uniform float shininess;
+
+    uniform vec3 emissiveColor;
+    uniform float emissiveStrength;
+    uniform float emissiveEnabled;
+
+    uniform float roughness;
+    uniform float metalness;
+
+    void loadMaterial() {}
+    #endif
+)";
+
+const char* const ShaderUtils::GBUFFER_OUTPUTS = R"(
+    // Targets without an attachment in the current layout are dropped
+    layout(location = 0) out vec4 gBufferPosition;
+    layout(location = 1) out vec4 gBufferNormal;
+    layout(location = 2) out vec4 gBufferAlbedo;
+    layout(location = 3) out vec4 gBufferEmissive;
+    layout(location = 4) out vec2 gBufferRoughnessAndMetalness;
+
+    vec2 encodeOctahedral(vec3 n) {
+        n /= abs(n.x) + abs(n.y) + abs(n.z);
+        if (n.z < 0.0) {
+            n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        }
+        return n.xy;
+    }
+
+    // positionEyespace.w and albedo.a are stored as is in the full layout;
+    // emissive is rgb + strength
+    void writeGBuffer(vec4 positionEyespace, vec3 N, vec4 albedo, float roughness, float metalness, vec4 emissive) {
+        if (compactGBuffer > 0.5) {
+            // the position is rebuilt from depth
+            gBufferNormal = vec4(encodeOctahedral(N) * 0.5 + 0.5, metalness, 1.0);
+            gBufferAlbedo = vec4(albedo.rgb, roughness);
+            gBufferEmissive = vec4(emissive.rgb * emissive.a, 1.0);
+        } else {
+            gBufferPosition = positionEyespace;
+            gBufferNormal = vec4(N, 0.0);
+            gBufferAlbedo = albedo;
+            gBufferEmissive = emissive;
+            gBufferRoughnessAndMetalness = vec2(roughness, metalness);
+        }
+    }
+)";
+
+const char* const ShaderUtils::GBUFFER_DECODE = R"(
+    uniform sampler2D gPosition;
+    uniform sampler2D gNormal;
+    uniform sampler2D gAlbedo;
+    uniform sampler2D gEmissive;
+    uniform sampler2D gRoughnessAndMetalness;
+    uniform sampler2D gDepth;
+
+    struct Surface {
+        // eye space
+        vec3 position;
+        vec3 normal;
+        // alpha is the material's own value in the full layout (e.g. the
+        // specular coefficient) and the roughness in the compact one
+        vec4 albedo;
+        // already scaled by its strength
+        vec3 emissive;
+        float roughness;
+        float metalness;
+        // false for the background and the skybox
+        bool lit;
+    };
+
+    vec3 positionFromDepth(vec2 uv, float depth) {
+        vec4 p = inverseProjectionMatrix * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+        return p.xyz / p.w;
+    }
+
+    vec3 readPosition(vec2 uv) {
+        if (compactGBuffer > 0.5) {
+            return positionFromDepth(uv, texture(gDepth, uv).r);
+        }
+        return texture(gPosition, uv).xyz;
+    }
+
+    // false for the background and the skybox, as Surface.lit
+    bool readLit(vec2 uv) {
+        if (compactGBuffer > 0.5) {
+            return texture(gDepth, uv).r < 1.0;
+        }
+        return texture(gPosition, uv).w > 0.5;
+    }
+
+    vec3 readNormal(vec2 uv) {
+        vec4 n = texture(gNormal, uv);
+        if (compactGBuffer > 0.5) {
+            return decodeOctahedral(n.rg * 2.0 - 1.0);
+        }
+        return normalize(n.xyz);
+    }
+
+    Surface readGBuffer(vec2 uv) {
+        Surface surface;
+
+        vec4 normal = texture(gNormal, uv);
+        vec4 emissive = texture(gEmissive, uv);
+        surface.albedo = texture(gAlbedo, uv);
+
+        if (compactGBuffer > 0.5) {
+            float depth = texture(gDepth, uv).r;
+
+            surface.position = positionFromDepth(uv, depth);
+            surface.normal = decodeOctahedral(normal.rg * 2.0 - 1.0);
+            surface.emissive = emissive.rgb;
+            surface.roughness = surface.albedo.a;
+            surface.metalness = normal.b;
+            // nothing but the skybox is drawn at the far plane
+            surface.lit = depth < 1.0;
+        } else {
+            vec4 position = texture(gPosition, uv);
+            vec2 roughnessAndMetalness = texture(gRoughnessAndMetalness, uv).rg;
+
+            surface.position = position.xyz;
+            surface.normal = normalize(normal.xyz);
+            surface.emissive = emissive.rgb * emissive.a;
+            surface.roughness = roughnessAndMetalness.r;
+            surface.metalness = roughnessAndMetalness.g;
+            surface.lit = position.w > 0.5;
+        }
+
+        return surface;
+    }
+)";
+
+const char* const ShaderUtils::CLUSTERED_LIGHTS = R"(
+    #define CLUSTER_TILES_X 16
+    #define CLUSTER_TILES_Y 9
+    #define CLUSTER_SLICES 24
+
+    // see ClusteredLights
+    uniform samplerBuffer clusterLights;
+    uniform usamplerBuffer clusterGrid;
+    uniform usamplerBuffer clusterIndices;
+
+    struct ClusterLight {
+        // eye space, w = 0 for directional lights
+        vec4 position;
+        // color * intensity
+        vec3 radiance;
+        float attenuation;
+        // see Light::getRadius
+        float radius;
+    };
+
+    // exponential slices between the near and far planes of projectionMatrix
+    int clusterSlice(float depth) {
+        float zNear = projectionMatrix[3][2] / (projectionMatrix[2][2] - 1.0);
+        float zFar = projectionMatrix[3][2] / (projectionMatrix[2][2] + 1.0);
+
+        if (depth <= zNear) {
+            return 0;
+        }
+
+        return min(int(log(depth / zNear) * float(CLUSTER_SLICES) / log(zFar / zNear)), CLUSTER_SLICES - 1);
+    }
+
+    // (first index, light count) of the cluster at screen uv and eye space depth (-z)
+    uvec2 findCluster(vec2 uv, float depth) {
+        ivec2 tile = clamp(
+            ivec2(uv * vec2(CLUSTER_TILES_X, CLUSTER_TILES_Y)),
+            ivec2(0),
+            ivec2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1)
+        );
+
+        int cluster = (clusterSlice(depth) * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x;
+
+        return texelFetch(clusterGrid, cluster).rg;
+    }
+
+    // The cluster's i-th light
+    ClusterLight clusterLight(uvec2 cluster, uint i) {
+        int index = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
+
+        vec4 radiance = texelFetch(clusterLights, 3 * index + 1);
+
+        ClusterLight light;
+        light.position = texelFetch(clusterLights, 3 * index);
+        light.radiance = radiance.rgb;
+        light.attenuation = radiance.a;
+        light.radius = texelFetch(clusterLights, 3 * index + 2).r;
+
+        return light;
+    }
+)";
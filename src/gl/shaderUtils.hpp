@@ -6,4 +6,52 @@
 
 namespace ShaderUtils {
     GLuint compile(std::string vertexShader, std::string fragmentShader);
+
+    // Binds the named uniform block to a binding point. Does nothing if the
+    // program doesn't declare the block
+    void bindUniformBlock(GLuint program, const char* name, GLuint binding);
+
+    // Returns the source with "#define name" inserted after its #version line
+    std::string addDefine(const std::string& source, const char* name);
+
+    // GLSL: vec3 decodeOctahedral(vec2 e)
+    // Inverse of the octahedral normal encoding (see VertexLayout)
+    extern const char* const OCTAHEDRAL_DECODE;
+
+    // GLSL: std140 uniform block Lights { int numLights; Light lights[MAX_LIGHTS]; }, float attenuate(float distance, float coefficient, float radius)
+    // Filled by LightBuffer; the layout must match LightBuffer::Block
+    extern const char* const LIGHTS_BLOCK;
+
+    // GLSL: std140 uniform block Frame { projectionMatrix, viewMatrix, their inverses, reprojectionMatrix, viewportSize, time, compactGBuffer, frameIndex }
+    // Filled by FrameUniforms; the layout must match FrameUniforms::Block
+    extern const char* const FRAME_BLOCK;
+
+    // GLSL: the normal attribute, vec3 vertexNormal(), vec4 positionToEyespace(vec3), vec3 normalToEyespace(vec3), void passMaterial()
+    // Inputs and transforms for the material vertex shaders. vertexNormal()
+    // decodes the normal attribute when OCTAHEDRAL_NORMALS is defined. With
+    // INSTANCED defined they read the per-instance attributes (see
+    // InstanceAttributes), with MULTI_DRAW the draw's model record (see
+    // MultiDrawBatch), otherwise the modelViewMatrix and normalMatrix
+    // uniforms. Expects FRAME_BLOCK and OCTAHEDRAL_DECODE before it
+    extern const char* const MATERIAL_VERTEX_INPUTS;
+
+    // GLSL: color, specularCoefficient, shininess, emissive*, roughness, metalness and void loadMaterial()
+    // Per-material values of the material fragment shaders, either uniforms or
+    // (with INSTANCED or MULTI_DRAW) flat per-draw varyings. Call loadMaterial() first in main()
+    extern const char* const MATERIAL_FRAGMENT_INPUTS;
+
+    // GLSL: G-buffer outputs and void writeGBuffer(positionEyespace, N, albedo, roughness, metalness, emissive)
+    // Encodes for the G-buffer layout in use (see GBufferLayout), picked by
+    // the Frame block's compactGBuffer. Expects FRAME_BLOCK before it
+    extern const char* const GBUFFER_OUTPUTS;
+
+    // GLSL: the G-buffer samplers, struct Surface readGBuffer(vec2 uv), vec3 readPosition(vec2 uv), bool readLit(vec2 uv), vec3 readNormal(vec2 uv)
+    // The one decoder of writeGBuffer's output, for the lighting passes and
+    // SSAO. Expects FRAME_BLOCK and OCTAHEDRAL_DECODE before it
+    extern const char* const GBUFFER_DECODE;
+
+    // GLSL: the cluster samplers, uvec2 findCluster(vec2 uv, float depth), ClusterLight clusterLight(uvec2 cluster, uint i)
+    // Reads ClusteredLights' texture buffers; the grid size must match
+    // ClusteredLights. Expects FRAME_BLOCK before it
+    extern const char* const CLUSTERED_LIGHTS;
 } /* ShaderUtils */
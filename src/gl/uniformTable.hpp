@@ -0,0 +1,109 @@
+#pragma once
+
+#include "glStats.hpp"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+/**
+ * Uniform locations of one program, resolved once and indexed by an enum.
+ * Key must be an enum class whose last enumerator is `count`; names are
+ * given in enum order. Uniforms the program doesn't declare (or that the
+ * compiler optimized away) resolve to -1 and are skipped by set().
+ *
+ * set() expects the program to be in use.
+ **/
+template <typename Key>
+class UniformTable {
+    public:
+        static constexpr std::size_t SIZE = static_cast<std::size_t>(Key::count);
+
+        UniformTable() {
+            locations.fill(-1);
+        }
+
+        // prefix allows resolving members of a struct array, e.g. "lights[3]."
+        void resolve(GLuint program, const std::array<const char*, SIZE>& names, const std::string& prefix = "") {
+            for (std::size_t i = 0; i < SIZE; i++) {
+                locations[i] = glGetUniformLocation(program, (prefix + names[i]).c_str());
+            }
+            GLStats::frame().uniformLookups += SIZE;
+        }
+
+        GLint get(Key key) const {
+            return locations[static_cast<std::size_t>(key)];
+        }
+
+        void set(Key key, int value) const {
+            GLint location = get(key);
+            if (location < 0) {
+                return;
+            }
+
+            GLStats::frame().uniformUploads++;
+            glUniform1i(location, value);
+        }
+
+        void set(Key key, float value) const {
+            GLint location = get(key);
+            if (location < 0) {
+                return;
+            }
+
+            GLStats::frame().uniformUploads++;
+            glUniform1f(location, value);
+        }
+
+        // the shaders take flags as floats
+        void set(Key key, bool value) const {
+            set(key, value ? 1.0f : 0.0f);
+        }
+
+        void set(Key key, const glm::vec3& value) const {
+            GLint location = get(key);
+            if (location < 0) {
+                return;
+            }
+
+            GLStats::frame().uniformUploads++;
+            glUniform3fv(location, 1, glm::value_ptr(value));
+        }
+
+        void set(Key key, const glm::vec4& value) const {
+            GLint location = get(key);
+            if (location < 0) {
+                return;
+            }
+
+            GLStats::frame().uniformUploads++;
+            glUniform4fv(location, 1, glm::value_ptr(value));
+        }
+
+        void set(Key key, const glm::mat3& value) const {
+            GLint location = get(key);
+            if (location < 0) {
+                return;
+            }
+
+            GLStats::frame().uniformUploads++;
+            glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+
+        void set(Key key, const glm::mat4& value) const {
+            GLint location = get(key);
+            if (location < 0) {
+                return;
+            }
+
+            GLStats::frame().uniformUploads++;
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+    private:
+        std::array<GLint, SIZE> locations;
+};
@@ -0,0 +1,175 @@
+#include "vertexLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    uint16_t toHalf(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000u;
+        int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xffu) - 127 + 15;
+        uint32_t mantissa = bits & 0x7fffffu;
+
+        if (((bits >> 23) & 0xffu) == 0xffu) {
+            // inf / nan
+            return static_cast<uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+        }
+        if (exponent >= 31) {
+            // overflow, clamp to inf
+            return static_cast<uint16_t>(sign | 0x7c00u);
+        }
+        if (exponent <= 0) {
+            if (exponent < -10) {
+                return static_cast<uint16_t>(sign);
+            }
+            // subnormal
+            mantissa |= 0x800000u;
+            uint32_t shift = static_cast<uint32_t>(14 - exponent);
+            uint32_t half = mantissa >> shift;
+            // round to nearest
+            if ((mantissa >> (shift - 1)) & 1u) {
+                half++;
+            }
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+        // round to nearest (may carry into the exponent, which is correct)
+        if (mantissa & 0x1000u) {
+            half++;
+        }
+        return static_cast<uint16_t>(half);
+    }
+
+    int32_t toSnorm(float value, int bits) {
+        float maxValue = static_cast<float>((1 << (bits - 1)) - 1);
+        return static_cast<int32_t>(std::round(std::clamp(value, -1.0f, 1.0f) * maxValue));
+    }
+
+    uint32_t pack2_10_10_10(const float* n) {
+        uint32_t x = static_cast<uint32_t>(toSnorm(n[0], 10)) & 0x3ffu;
+        uint32_t y = static_cast<uint32_t>(toSnorm(n[1], 10)) & 0x3ffu;
+        uint32_t z = static_cast<uint32_t>(toSnorm(n[2], 10)) & 0x3ffu;
+        return x | (y << 10) | (z << 20);
+    }
+
+    // Maps the unit sphere onto the [-1, 1] square
+    void encodeOctahedral(const float* n, int16_t* out) {
+        float l1 = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+        float x = l1 > 0.0f ? n[0] / l1 : 0.0f;
+        float y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+
+        if (n[2] < 0.0f) {
+            float ox = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float oy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = ox;
+            y = oy;
+        }
+
+        out[0] = static_cast<int16_t>(toSnorm(x, 16));
+        out[1] = static_cast<int16_t>(toSnorm(y, 16));
+    }
+}
+
+std::size_t VertexLayout::getPositionSize() const {
+    return position == PositionFormat::float32 ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+}
+
+std::size_t VertexLayout::getNormalSize() const {
+    return normal == NormalFormat::float32 ? 3 * sizeof(float) : sizeof(uint32_t);
+}
+
+std::size_t VertexLayout::getUvSize() const {
+    return uv == UvFormat::float32 ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+}
+
+std::size_t VertexLayout::getStride(bool hasUvs) const {
+    return getPositionSize() + getNormalSize() + (hasUvs ? getUvSize() : 0);
+}
+
+std::vector<uint8_t> VertexLayout::pack(
+    const std::vector<float>& positions,
+    const std::vector<float>& normals,
+    const std::vector<float>& uvs
+) const {
+    std::size_t vertexCount = positions.size() / 3;
+    bool hasUvs = !uvs.empty();
+    std::size_t stride = getStride(hasUvs);
+
+    std::vector<uint8_t> buffer(vertexCount * stride, 0);
+
+    for (std::size_t i = 0; i < vertexCount; i++) {
+        uint8_t* vertex = buffer.data() + i * stride;
+
+        const float* p = &positions[i * 3];
+        if (position == PositionFormat::float32) {
+            std::memcpy(vertex, p, 3 * sizeof(float));
+        } else {
+            uint16_t half[4] = { toHalf(p[0]), toHalf(p[1]), toHalf(p[2]), 0 };
+            std::memcpy(vertex, half, sizeof(half));
+        }
+        vertex += getPositionSize();
+
+        const float* n = &normals[i * 3];
+        if (normal == NormalFormat::float32) {
+            std::memcpy(vertex, n, 3 * sizeof(float));
+        } else if (normal == NormalFormat::int2_10_10_10) {
+            uint32_t packed = pack2_10_10_10(n);
+            std::memcpy(vertex, &packed, sizeof(packed));
+        } else {
+            int16_t octahedral[2];
+            encodeOctahedral(n, octahedral);
+            std::memcpy(vertex, octahedral, sizeof(octahedral));
+        }
+        vertex += getNormalSize();
+
+        if (hasUvs) {
+            const float* t = &uvs[i * 2];
+            if (uv == UvFormat::float32) {
+                std::memcpy(vertex, t, 2 * sizeof(float));
+            } else {
+                uint16_t half[2] = { toHalf(t[0]), toHalf(t[1]) };
+                std::memcpy(vertex, half, sizeof(half));
+            }
+        }
+    }
+
+    return buffer;
+}
+
+void VertexLayout::apply(bool hasUvs, std::size_t baseOffset) const {
+    auto stride = static_cast<GLsizei>(getStride(hasUvs));
+    std::size_t offset = baseOffset;
+
+    glEnableVertexAttribArray(0);
+    if (position == PositionFormat::float32) {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+    } else {
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+    }
+    offset += getPositionSize();
+
+    glEnableVertexAttribArray(1);
+    if (normal == NormalFormat::float32) {
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+    } else if (normal == NormalFormat::int2_10_10_10) {
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, reinterpret_cast<const void*>(offset));
+    } else {
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<const void*>(offset));
+    }
+    offset += getNormalSize();
+
+    if (hasUvs) {
+        glEnableVertexAttribArray(2);
+        if (uv == UvFormat::float32) {
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+        } else {
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offset));
+        }
+    } else {
+        glDisableVertexAttribArray(2);
+    }
+}
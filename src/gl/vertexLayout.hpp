@@ -0,0 +1,71 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Describes how vertex attributes are packed into a single interleaved
+ * vertex buffer. Attribute locations are fixed:
+ *   0 = position, 1 = normal, 2 = uv
+ *
+ * Normals stored as int2_10_10_10 are normalized by GL, so shaders can keep
+ * reading them as "in vec3 normal". Octahedral normals arrive as a vec2; the
+ * material shaders decode them when compiled with OCTAHEDRAL_NORMALS (see
+ * Material::setNormalFormat).
+ **/
+struct VertexLayout {
+    enum class PositionFormat {
+        float32, // 12 bytes
+        float16  // 8 bytes (3 halves + padding)
+    };
+
+    enum class NormalFormat {
+        float32,       // 12 bytes
+        int2_10_10_10, // 4 bytes, GL_INT_2_10_10_10_REV
+        octahedral     // 4 bytes, 2 x snorm16
+    };
+
+    enum class UvFormat {
+        float32, // 8 bytes
+        float16  // 4 bytes
+    };
+
+    PositionFormat position = PositionFormat::float32;
+    NormalFormat normal = NormalFormat::int2_10_10_10;
+    UvFormat uv = UvFormat::float16;
+
+    // Half positions + packed normals (+ half uvs): 12 (16) bytes per vertex
+    static VertexLayout compact() {
+        return { PositionFormat::float16, NormalFormat::int2_10_10_10, UvFormat::float16 };
+    }
+
+    // The original, uncompressed format: 24 (32) bytes per vertex
+    static VertexLayout full() {
+        return { PositionFormat::float32, NormalFormat::float32, UvFormat::float32 };
+    }
+
+    bool operator==(const VertexLayout& other) const {
+        return position == other.position && normal == other.normal && uv == other.uv;
+    }
+
+    std::size_t getPositionSize() const;
+    std::size_t getNormalSize() const;
+    std::size_t getUvSize() const;
+
+    std::size_t getStride(bool hasUvs) const;
+
+    // Interleaves tightly packed float attributes into one buffer
+    // (uvs may be empty)
+    std::vector<uint8_t> pack(
+        const std::vector<float>& positions,
+        const std::vector<float>& normals,
+        const std::vector<float>& uvs
+    ) const;
+
+    // Sets the attribute pointers on the currently bound VAO for the
+    // currently bound GL_ARRAY_BUFFER, starting at baseOffset
+    void apply(bool hasUvs, std::size_t baseOffset = 0) const;
+};
@@ -0,0 +1,331 @@
+#include "instancedBatch.hpp"
+
+#include "material/material.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "renderQueue.hpp"
+#include "util/matrixBatch.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+
+namespace {
+    const MaterialType MATERIAL_TYPES[] = {
+        MaterialType::standard,
+        MaterialType::deferred,
+        MaterialType::deferred_pbr
+    };
+
+    // never matches a model version, so new instances are always filled
+    const uint64_t UNBUILT = std::numeric_limits<uint64_t>::max();
+
+    // TODO: Support both sides
+    GLenum cullFace(const Material& material) {
+        return material.getSide() == Side::BACK ? GL_FRONT : GL_BACK;
+    }
+
+    const void* offset(std::size_t bytes) {
+        return reinterpret_cast<const void*>(bytes);
+    }
+
+    void applyColumns(GLuint location, GLint size, std::size_t start, GLuint columns) {
+        for (GLuint column = 0; column < columns; column++) {
+            glEnableVertexAttribArray(location + column);
+            glVertexAttribPointer(
+                location + column,
+                size,
+                GL_FLOAT,
+                GL_FALSE,
+                sizeof(InstanceAttributes),
+                offset(start + column * size * sizeof(float))
+            );
+            // advance once per instance instead of once per vertex
+            glVertexAttribDivisor(location + column, 1);
+        }
+    }
+}
+
+void InstanceAttributes::apply(std::size_t first) {
+    GLuint location = FIRST_LOCATION;
+    std::size_t base = first * sizeof(InstanceAttributes);
+
+    applyColumns(location, 4, base + offsetof(InstanceAttributes, modelMatrix), 4);
+    location += 4;
+    applyColumns(location, 3, base + offsetof(InstanceAttributes, normalMatrix), 3);
+    location += 3;
+    applyColumns(location++, 4, base + offsetof(InstanceAttributes, color), 1);
+    applyColumns(location++, 4, base + offsetof(InstanceAttributes, emissive), 1);
+    applyColumns(location++, 4, base + offsetof(InstanceAttributes, parameters), 1);
+}
+
+InstancedBatch::InstancedBatch(std::shared_ptr<Model> model) :
+    mesh(model->getMesh())
+{
+    for (auto type : MATERIAL_TYPES) {
+        auto material = model->getMaterial(type);
+        if (material != nullptr && material->getInstancedProgram()) {
+            groups.emplace(type, Group());
+        }
+    }
+
+    add(model);
+}
+
+InstancedBatch::~InstancedBatch() {
+    for (auto& entry : groups) {
+        for (auto& lod : entry.second.lods) {
+            glDeleteVertexArrays(1, &lod.vertexArray);
+        }
+        glDeleteBuffers(1, &entry.second.instanceBuffer);
+    }
+}
+
+bool InstancedBatch::accepts(const Model& model) const {
+    if (model.getMesh() != mesh) {
+        return false;
+    }
+
+    const Model& first = *models.front();
+
+    for (auto type : MATERIAL_TYPES) {
+        auto ours = first.getMaterial(type);
+        auto theirs = model.getMaterial(type);
+
+        if (ours == nullptr || theirs == nullptr) {
+            if (ours != theirs) {
+                return false;
+            }
+            continue;
+        }
+
+        if (
+            !ours->getInstancedProgram() ||
+            ours->getInstancedProgram() != theirs->getInstancedProgram() ||
+            ours->getSide() != theirs->getSide()
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void InstancedBatch::add(std::shared_ptr<Model> model) {
+    models.push_back(model);
+    versions.push_back(UNBUILT);
+
+    for (auto& entry : groups) {
+        entry.second.instances.emplace_back();
+    }
+}
+
+void InstancedBatch::update() {
+    changed.clear();
+    modelMatrices.clear();
+
+    for (std::size_t i = 0; i < models.size(); i++) {
+        models[i]->applyModelMatrix();
+        if (models[i]->getVersion() != versions[i]) {
+            versions[i] = models[i]->getVersion();
+            changed.push_back(i);
+            modelMatrices.push_back(models[i]->getModelMatrix());
+        }
+    }
+
+    if (changed.empty()) {
+        return;
+    }
+
+    worldMatrices.resize(changed.size());
+    normalMatrices.resize(changed.size());
+
+    // identity view: world space normal matrices
+    MatrixBatch::computeModelView(
+        glm::mat4(1.0f),
+        modelMatrices.data(),
+        worldMatrices.data(),
+        normalMatrices.data(),
+        changed.size()
+    );
+
+    for (auto& entry : groups) {
+        auto& group = entry.second;
+
+        for (std::size_t i = 0; i < changed.size(); i++) {
+            auto& instance = group.instances[changed[i]];
+            instance.modelMatrix = modelMatrices[i];
+            instance.normalMatrix = normalMatrices[i];
+            models[changed[i]]->getMaterial(entry.first)->fillInstance(instance);
+        }
+
+        group.dirty = true;
+    }
+}
+
+void InstancedBatch::upload(Group& group, const uint8_t* visible) const {
+    std::size_t lodCount = mesh->getLodCount();
+    bool changed = group.dirty || group.states.size() != models.size();
+
+    group.states.resize(models.size());
+
+    for (std::size_t i = 0; i < models.size(); i++) {
+        auto level = std::min(models[i]->getLodLevel(), lodCount - 1);
+        uint8_t state = visible[i] ? static_cast<uint8_t>(level + 1) : uint8_t(0);
+
+        if (group.states[i] != state) {
+            group.states[i] = state;
+            changed = true;
+        }
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    group.dirty = false;
+
+    // counting sort of the visible instances by level
+    group.lods.resize(lodCount);
+    for (auto& lod : group.lods) {
+        lod.instanceCount = 0;
+    }
+
+    for (auto state : group.states) {
+        if (state != 0) {
+            group.lods[state - 1].instanceCount++;
+        }
+    }
+
+    GLsizei count = 0;
+    std::array<GLsizei, MeshSimplification::MAX_LEVELS> next = {};
+
+    for (std::size_t level = 0; level < lodCount; level++) {
+        group.lods[level].firstInstance = count;
+        next[level] = count;
+        count += group.lods[level].instanceCount;
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    // only copy when something is culled or the levels differ
+    const InstanceAttributes* data = group.instances.data();
+    bool inOrder = std::any_of(group.lods.begin(), group.lods.end(), [&group](const Lod& lod) {
+        return static_cast<std::size_t>(lod.instanceCount) == group.instances.size();
+    });
+
+    if (!inOrder) {
+        group.visibleInstances.resize(static_cast<std::size_t>(count));
+        for (std::size_t i = 0; i < group.instances.size(); i++) {
+            if (group.states[i] != 0) {
+                group.visibleInstances[next[group.states[i] - 1]++] = group.instances[i];
+            }
+        }
+        data = group.visibleInstances.data();
+    }
+
+    if (group.instanceBuffer == 0) {
+        glGenBuffers(1, &group.instanceBuffer);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, group.instanceBuffer);
+
+    if (group.capacity < static_cast<std::size_t>(count)) {
+        // room for everything, so culling changes never reallocate
+        glBufferData(GL_ARRAY_BUFFER, group.instances.size() * sizeof(InstanceAttributes), nullptr, GL_DYNAMIC_DRAW);
+        group.capacity = group.instances.size();
+    }
+
+    glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<std::size_t>(count) * sizeof(InstanceAttributes), data);
+
+    // the ranges moved, point each level's attributes at its range
+    for (auto& lod : group.lods) {
+        if (lod.instanceCount == 0) {
+            continue;
+        }
+
+        if (lod.vertexArray == 0) {
+            lod.vertexArray = mesh->createVertexArray();
+        } else {
+            glBindVertexArray(lod.vertexArray);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, group.instanceBuffer);
+        InstanceAttributes::apply(static_cast<std::size_t>(lod.firstInstance));
+    }
+}
+
+void InstancedBatch::enqueue(
+    MaterialType type,
+    RenderQueue& queue,
+    const glm::mat4& viewMatrix,
+    const uint8_t* visible,
+    const MultiDraw* clusters
+) const {
+    if (!isInstanced()) {
+        for (std::size_t i = 0; i < models.size(); i++) {
+            auto material = models[i]->getMaterial(type);
+            if (material == nullptr || !visible[i]) {
+                continue;
+            }
+
+            DrawPacket packet;
+            packet.material = material;
+            packet.program = material->getProgram();
+            auto level = models[i]->getLodLevel();
+
+            packet.vertexArray = mesh->getVertexArrayObject();
+            packet.indexCount = static_cast<GLsizei>(mesh->getLod(level).indexCount);
+            packet.indexType = mesh->getIndexType();
+            packet.indexOffset = mesh->getLodOffset(level);
+            packet.baseVertex = mesh->getBaseVertex();
+            packet.cullFace = cullFace(*material);
+
+            if (clusters != nullptr && !clusters[i].empty()) {
+                packet.indexCount = clusters[i].indexCount;
+                packet.multiDraw = &clusters[i];
+            }
+
+            auto center = models[i]->getWorldBounds().sphere.center;
+            queue.push(packet, -(viewMatrix * glm::vec4(center, 1.0f)).z);
+        }
+        return;
+    }
+
+    auto found = groups.find(type);
+    if (found == groups.end()) {
+        return;
+    }
+
+    auto& group = found->second;
+
+    upload(group, visible);
+
+    // per-instance values come from the buffer, the rest is shared
+    auto material = models.front()->getMaterial(type);
+
+    for (std::size_t level = 0; level < group.lods.size(); level++) {
+        const auto& lod = group.lods[level];
+        if (lod.instanceCount == 0) {
+            continue;
+        }
+
+        DrawPacket packet;
+        packet.material = material;
+        packet.program = material->getInstancedProgram()->get();
+        packet.vertexArray = lod.vertexArray;
+        packet.indexCount = static_cast<GLsizei>(mesh->getLod(level).indexCount);
+        packet.indexType = mesh->getIndexType();
+        packet.indexOffset = mesh->getLodOffset(level);
+        packet.baseVertex = mesh->getBaseVertex();
+        packet.instanceCount = lod.instanceCount;
+        packet.cullFace = cullFace(*material);
+
+        // instances are spread out, so there is no one depth; draw before the
+        // single models that share its state
+        queue.push(packet, 0.0f);
+    }
+}
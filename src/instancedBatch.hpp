@@ -0,0 +1,141 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Mesh;
+class Model;
+class RenderQueue;
+struct MultiDraw;
+
+enum class MaterialType : int;
+
+/**
+ * Per-instance vertex attributes, one per model of an InstancedBatch.
+ * Locations must match ShaderUtils::MATERIAL_VERTEX_INPUTS:
+ *   3-6 = model matrix, 7-9 = normal matrix, 10 = color, 11 = emissive, 12 = parameters
+ *
+ * Matrices are in world space, so camera moves don't touch the buffer.
+ **/
+struct InstanceAttributes {
+    static const GLuint FIRST_LOCATION = 3;
+
+    glm::mat4 modelMatrix;
+    // transpose(inverse(mat3(modelMatrix)))
+    glm::mat3 normalMatrix;
+    // rgb + specularCoefficient
+    glm::vec4 color;
+    // rgb + strength
+    glm::vec4 emissive;
+    // roughness, metalness, shininess, emissiveEnabled
+    glm::vec4 parameters;
+
+    // Sets the attribute pointers on the currently bound VAO for the
+    // currently bound GL_ARRAY_BUFFER, starting at instance first
+    static void apply(std::size_t first = 0);
+};
+
+static_assert(sizeof(InstanceAttributes) == 148, "InstanceAttributes must be tightly packed");
+
+/**
+ * Models that share a mesh and, per material type, an instanced program and
+ * cull side. With two or more models each material type is drawn with a
+ * single glDrawElementsInstanced call per level of detail in use; a lone
+ * model is drawn as usual.
+ *
+ * Instance data is only rebuilt for models whose version changed, and only
+ * uploaded for the material type that is drawn.
+ **/
+class InstancedBatch {
+    public:
+        explicit InstancedBatch(std::shared_ptr<Model> model);
+        ~InstancedBatch();
+
+        InstancedBatch(InstancedBatch&& other) = delete;
+        InstancedBatch& operator=(InstancedBatch&& other) = delete;
+
+        InstancedBatch(const InstancedBatch& other) = delete;
+        InstancedBatch& operator=(const InstancedBatch& other) = delete;
+
+        // Whether the model can be drawn in the same instanced calls.
+        // Materials must be added to the model before it is batched
+        bool accepts(const Model& model) const;
+
+        void add(std::shared_ptr<Model> model);
+
+        bool isInstanced() const {
+            return models.size() >= 2;
+        }
+
+        const std::vector<std::shared_ptr<Model>>& getModels() const {
+            return models;
+        }
+
+        // Refreshes the instance data of changed models
+        void update();
+
+        // Indices (into getModels()) of the models the last update() refreshed
+        const std::vector<std::size_t>& getChanged() const {
+            return changed;
+        }
+
+        // Pushes one instanced packet per level of detail of the visible
+        // models, or one packet per visible model if there is a single model.
+        // visible[i] is the culling result of getModels()[i], levels come
+        // from Model::getLodLevel. Uploads pending instance data, compacted
+        // to the visible instances and grouped by level.
+        // clusters (optional, like visible) are the parts of lone models
+        // that survived cluster culling; non-empty ones are drawn instead of
+        // the level of detail
+        void enqueue(
+            MaterialType type,
+            RenderQueue& queue,
+            const glm::mat4& viewMatrix,
+            const uint8_t* visible,
+            const MultiDraw* clusters = nullptr
+        ) const;
+    private:
+        // Instances drawn at one level of detail: a range of the instance
+        // buffer, with a VAO whose instance attributes start at it
+        struct Lod {
+            GLuint vertexArray = 0;
+            GLsizei firstInstance = 0;
+            GLsizei instanceCount = 0;
+        };
+
+        struct Group {
+            GLuint instanceBuffer = 0;
+            std::size_t capacity = 0;
+
+            std::vector<InstanceAttributes> instances;
+            bool dirty = true;
+
+            // per model, 0 if hidden or 1 + its level of detail, as of the
+            // last fill of the buffer; and that fill
+            std::vector<uint8_t> states;
+            std::vector<InstanceAttributes> visibleInstances;
+            std::vector<Lod> lods;
+        };
+
+        std::shared_ptr<Mesh> mesh;
+        std::vector<std::shared_ptr<Model>> models;
+        // model versions the instance data was built from
+        std::vector<uint64_t> versions;
+
+        mutable std::unordered_map<MaterialType, Group> groups;
+
+        // scratch space for update()
+        std::vector<std::size_t> changed;
+        std::vector<glm::mat4> modelMatrices;
+        std::vector<glm::mat4> worldMatrices;
+        std::vector<glm::mat3> normalMatrices;
+
+        void upload(Group& group, const uint8_t* visible) const;
+};
@@ -0,0 +1,67 @@
+#include "mappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) :
+    data(std::exchange(other.data, nullptr)),
+    length(std::exchange(other.length, 0))
+{}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+    if (this != &other) {
+        close();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+
+    return *this;
+}
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    // we read the file front to back exactly once
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(mapping);
+    length = static_cast<std::size_t>(info.st_size);
+
+    return true;
+}
+
+void MappedFile::close() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), length);
+    }
+
+    data = nullptr;
+    length = 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only memory mapping of a file on disk.
+ * The mapping is released when the MappedFile is destroyed.
+ **/
+class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other);
+        MappedFile& operator=(MappedFile&& other);
+
+        // A mapping has exactly one owner
+        MappedFile(const MappedFile& other) = delete;
+        MappedFile& operator=(const MappedFile& other) = delete;
+
+        bool open(const std::string& filename);
+        void close();
+
+        bool isOpen() const {
+            return data != nullptr;
+        }
+
+        const char* begin() const {
+            return data;
+        }
+
+        const char* end() const {
+            return data + length;
+        }
+
+        std::size_t size() const {
+            return length;
+        }
+    private:
+        const char* data = nullptr;
+        std::size_t length = 0;
+};
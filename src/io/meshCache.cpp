@@ -0,0 +1,219 @@
+#include "meshCache.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+    const char MAGIC[4] = { 'M', 'V', 'M', 'B' };
+
+    constexpr std::size_t ALIGNMENT = 16;
+
+    std::size_t align(std::size_t offset) {
+        return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    inline uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    std::string getCacheDirectory() {
+        const char* dir = std::getenv("MODEL_VIEWER_CACHE_DIR");
+        return dir != nullptr ? std::string(dir) : std::string(".meshcache");
+    }
+}
+
+uint64_t MeshCache::hash(const char* begin, const char* end) {
+    // word-at-a-time multiplicative hash, much faster than parsing the file
+    uint64_t h = 0x84222325cbf29ce4ull ^ static_cast<uint64_t>(end - begin);
+
+    const char* p = begin;
+    for (; end - p >= 8; p += 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        h = (h ^ mix(word)) * 0x100000001b3ull;
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, end - p);
+    h = (h ^ mix(tail)) * 0x100000001b3ull;
+
+    return mix(h);
+}
+
+bool MeshCache::isEnabled() {
+    const char* disabled = std::getenv("MODEL_VIEWER_NO_CACHE");
+    return disabled == nullptr || std::strcmp(disabled, "0") == 0;
+}
+
+std::string MeshCache::getPath(uint64_t sourceHash, const VertexLayout& layout) {
+    std::ostringstream path;
+    path << getCacheDirectory() << "/"
+        << std::hex << std::setw(16) << std::setfill('0') << sourceHash
+        << std::dec << "-"
+        << static_cast<int>(layout.position)
+        << static_cast<int>(layout.normal)
+        << static_cast<int>(layout.uv)
+        << ".mesh";
+
+    return path.str();
+}
+
+bool MeshCache::write(const std::string& path, uint64_t sourceHash, uint64_t sourceSize, const Blob& blob) {
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+
+    header.positionFormat = static_cast<uint8_t>(blob.layout.position);
+    header.normalFormat = static_cast<uint8_t>(blob.layout.normal);
+    header.uvFormat = static_cast<uint8_t>(blob.layout.uv);
+    header.hasUvs = blob.hasUvs ? 1 : 0;
+
+    header.vertexCount = blob.vertexCount;
+    header.indexCount = blob.indexCount;
+    header.indexSize = blob.indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+
+    std::memcpy(header.boundsMin, blob.boundsMin, sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, blob.boundsMax, sizeof(header.boundsMax));
+    header.boundsRadius = blob.boundsRadius;
+
+    header.lodCount = blob.lodCount;
+    for (uint32_t i = 0; i < blob.lodCount; i++) {
+        header.lodFirstIndex[i] = blob.lods[i].firstIndex;
+        header.lodIndexCount[i] = blob.lods[i].indexCount;
+        header.lodError[i] = blob.lods[i].error;
+    }
+
+    header.vertexOffset = align(sizeof(Header));
+    header.vertexBytes = blob.vertexBytes;
+    header.indexOffset = align(header.vertexOffset + header.vertexBytes);
+    header.indexBytes = blob.indexBytes;
+    header.meshletOffset = align(header.indexOffset + header.indexBytes);
+    header.meshletCount = blob.meshletCount;
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    if (error) {
+        return false;
+    }
+
+    // unique per process and write, so viewers caching the same file at once
+    // never write into each other's temporary file; the rename is atomic
+    static std::atomic<uint32_t> writes(0);
+    auto temporaryPath = path + "." + std::to_string(getpid()) + "-" + std::to_string(writes++) + ".tmp";
+    {
+        std::ofstream ofs(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            return false;
+        }
+
+        const char padding[ALIGNMENT] = {};
+
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(padding, header.vertexOffset - sizeof(header));
+        ofs.write(static_cast<const char*>(blob.vertices), blob.vertexBytes);
+        ofs.write(padding, header.indexOffset - (header.vertexOffset + header.vertexBytes));
+        ofs.write(static_cast<const char*>(blob.indices), blob.indexBytes);
+        ofs.write(padding, header.meshletOffset - (header.indexOffset + header.indexBytes));
+        ofs.write(reinterpret_cast<const char*>(blob.meshlets), blob.meshletCount * sizeof(Meshlet));
+
+        if (!ofs) {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool MeshCache::read(
+    const std::string& path,
+    uint64_t sourceHash,
+    uint64_t sourceSize,
+    const VertexLayout& layout,
+    MappedFile& file,
+    Blob& blob
+) {
+    if (!file.open(path) || file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.begin(), sizeof(header));
+
+    bool valid =
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+        header.version == VERSION &&
+        header.sourceHash == sourceHash &&
+        header.sourceSize == sourceSize &&
+        header.positionFormat == static_cast<uint8_t>(layout.position) &&
+        header.normalFormat == static_cast<uint8_t>(layout.normal) &&
+        header.uvFormat == static_cast<uint8_t>(layout.uv) &&
+        (header.indexSize == 2 || header.indexSize == 4) &&
+        header.vertexOffset + header.vertexBytes <= file.size() &&
+        header.indexOffset + header.indexBytes <= file.size() &&
+        header.meshletOffset + header.meshletCount * sizeof(Meshlet) <= file.size() &&
+        header.vertexBytes == static_cast<uint64_t>(header.vertexCount) * layout.getStride(header.hasUvs != 0) &&
+        header.indexBytes == static_cast<uint64_t>(header.indexCount) * header.indexSize &&
+        header.lodCount >= 1 && header.lodCount <= MeshSimplification::MAX_LEVELS;
+
+    for (uint32_t i = 0; valid && i < header.lodCount; i++) {
+        valid = static_cast<uint64_t>(header.lodFirstIndex[i]) + header.lodIndexCount[i] <= header.indexCount;
+    }
+
+    auto meshlets = reinterpret_cast<const Meshlet*>(file.begin() + header.meshletOffset);
+
+    for (uint64_t i = 0; valid && i < header.meshletCount; i++) {
+        valid = static_cast<uint64_t>(meshlets[i].firstIndex) + meshlets[i].indexCount <= header.lodIndexCount[0];
+    }
+
+    if (!valid) {
+        file.close();
+        return false;
+    }
+
+    blob.layout = layout;
+    blob.hasUvs = header.hasUvs != 0;
+    blob.vertexCount = header.vertexCount;
+    blob.indexCount = header.indexCount;
+    blob.indexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    std::memcpy(blob.boundsMin, header.boundsMin, sizeof(blob.boundsMin));
+    std::memcpy(blob.boundsMax, header.boundsMax, sizeof(blob.boundsMax));
+    blob.boundsRadius = header.boundsRadius;
+
+    blob.lodCount = header.lodCount;
+    for (uint32_t i = 0; i < header.lodCount; i++) {
+        blob.lods[i].firstIndex = header.lodFirstIndex[i];
+        blob.lods[i].indexCount = header.lodIndexCount[i];
+        blob.lods[i].error = header.lodError[i];
+    }
+
+    blob.vertices = file.begin() + header.vertexOffset;
+    blob.vertexBytes = header.vertexBytes;
+    blob.indices = file.begin() + header.indexOffset;
+    blob.indexBytes = header.indexBytes;
+    blob.meshlets = meshlets;
+    blob.meshletCount = header.meshletCount;
+
+    return true;
+}
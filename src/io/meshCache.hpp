@@ -0,0 +1,115 @@
+#pragma once
+
+#include "geometry/meshlets.hpp"
+#include "geometry/meshSimplification.hpp"
+#include "gl/vertexLayout.hpp"
+#include "io/mappedFile.hpp"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ * Versioned binary container for GPU-ready meshes, plus an on-disk cache
+ * keyed by the content hash of the source file.
+ *
+ * File layout:
+ *   Header | vertex blob (interleaved, see VertexLayout) | index blob | meshlets
+ * The index blob holds every level of detail, full detail first; meshlets
+ * (possibly none) cover the full detail level.
+ * Blobs are 16-byte aligned so they can be uploaded straight from a mapping.
+ **/
+namespace MeshCache {
+    // bump whenever the file layout or the import pipeline output changes
+    constexpr uint32_t VERSION = 7;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+
+        // vertex layout descriptor
+        uint8_t positionFormat;
+        uint8_t normalFormat;
+        uint8_t uvFormat;
+        uint8_t hasUvs;
+
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        // 2 or 4
+        uint32_t indexSize;
+
+        float boundsMin[3];
+        float boundsMax[3];
+        // bounding sphere around the box center
+        float boundsRadius;
+
+        // levels of detail, as ranges of the index blob
+        uint32_t lodCount;
+        uint32_t lodFirstIndex[MeshSimplification::MAX_LEVELS];
+        uint32_t lodIndexCount[MeshSimplification::MAX_LEVELS];
+        float lodError[MeshSimplification::MAX_LEVELS];
+        uint32_t padding;
+
+        uint64_t vertexOffset;
+        uint64_t vertexBytes;
+        uint64_t indexOffset;
+        uint64_t indexBytes;
+        uint64_t meshletOffset;
+        uint64_t meshletCount;
+    };
+
+    // Non-owning view of packed mesh data
+    struct Blob {
+        VertexLayout layout;
+        bool hasUvs = false;
+
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        GLenum indexType = GL_UNSIGNED_INT;
+
+        float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+        float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+        float boundsRadius = 0.0f;
+
+        uint32_t lodCount = 0;
+        std::array<LodLevel, MeshSimplification::MAX_LEVELS> lods = {};
+
+        const void* vertices = nullptr;
+        std::size_t vertexBytes = 0;
+
+        const void* indices = nullptr;
+        std::size_t indexBytes = 0;
+
+        const Meshlet* meshlets = nullptr;
+        std::size_t meshletCount = 0;
+    };
+
+    uint64_t hash(const char* begin, const char* end);
+
+    // False when the environment variable MODEL_VIEWER_NO_CACHE is set (to
+    // anything but 0), so every load parses its source, e.g. to time imports
+    bool isEnabled();
+
+    // Location of the cached form of a source file with the given hash
+    std::string getPath(uint64_t sourceHash, const VertexLayout& layout);
+
+    // Writes atomically (unique temp file + rename). Failure only means no caching
+    bool write(const std::string& path, uint64_t sourceHash, uint64_t sourceSize, const Blob& blob);
+
+    // Maps the file at path. On success blob points into file's mapping, so
+    // file must outlive any use of blob
+    bool read(
+        const std::string& path,
+        uint64_t sourceHash,
+        uint64_t sourceSize,
+        const VertexLayout& layout,
+        MappedFile& file,
+        Blob& blob
+    );
+} /* MeshCache */
@@ -0,0 +1,374 @@
+#include "objParser.hpp"
+
+#include "util/threadPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char* skipSpaces(const char* p, const char* end) {
+        while (p < end && isSpace(*p)) {
+            p++;
+        }
+        return p;
+    }
+
+    inline const char* skipLine(const char* p, const char* end) {
+        auto newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        return newline == nullptr ? end : newline + 1;
+    }
+
+    inline const char* parseFloat(const char* p, const char* end, float& value) {
+        p = skipSpaces(p, end);
+        // from_chars does not accept a leading '+'
+        if (p < end && *p == '+') {
+            p++;
+        }
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            value = 0.0f;
+            return p;
+        }
+        return result.ptr;
+    }
+
+    inline const char* parseIndex(const char* p, const char* end, long& value) {
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) {
+            value = 0;
+        }
+        return result.ptr;
+    }
+
+    // Converts a 1-based (or negative, relative) OBJ index into a 0-based one.
+    // Returns -1 for missing or out of range indices
+    inline long resolve(long index, std::size_t count) {
+        if (index > 0 && static_cast<std::size_t>(index) <= count) {
+            return index - 1;
+        }
+        if (index < 0 && static_cast<std::size_t>(-index) <= count) {
+            return static_cast<long>(count) + index;
+        }
+        return -1;
+    }
+
+    struct Corner {
+        long position = -1;
+        long uv = -1;
+        long normal = -1;
+    };
+
+    // Parses "v", "v/t", "v//n" or "v/t/n"
+    inline const char* parseCorner(const char* p, const char* end, Corner& corner) {
+        long v = 0, t = 0, n = 0;
+        p = parseIndex(p, end, v);
+        if (p < end && *p == '/') {
+            p++;
+            if (p < end && *p != '/') {
+                p = parseIndex(p, end, t);
+            }
+            if (p < end && *p == '/') {
+                p++;
+                p = parseIndex(p, end, n);
+            }
+        }
+        corner.position = v;
+        corner.uv = t;
+        corner.normal = n;
+        return p;
+    }
+
+    // Chunks smaller than this aren't worth handing to another thread
+    constexpr std::size_t MIN_CHUNK_SIZE = 1 << 20;
+
+    struct Chunk {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        // totals of this chunk
+        OBJParser::Counts counts;
+        // totals of all preceding chunks (exclusive prefix sum)
+        OBJParser::Counts base;
+
+        const char* error = nullptr;
+    };
+
+    // Splits [begin, end) into newline-aligned chunks
+    std::vector<Chunk> split(const char* begin, const char* end, std::size_t numChunks) {
+        std::vector<Chunk> chunks;
+        chunks.reserve(numChunks);
+
+        auto size = static_cast<std::size_t>(end - begin);
+        const char* chunkBegin = begin;
+
+        for (std::size_t i = 1; i <= numChunks && chunkBegin < end; i++) {
+            const char* chunkEnd = i == numChunks ? end : skipLine(begin + size * i / numChunks, end);
+            if (chunkEnd <= chunkBegin) {
+                continue;
+            }
+
+            Chunk chunk;
+            chunk.begin = chunkBegin;
+            chunk.end = chunkEnd;
+            chunks.push_back(chunk);
+
+            chunkBegin = chunkEnd;
+        }
+
+        return chunks;
+    }
+
+    struct Attributes {
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> uvs;
+    };
+
+    // Pass 1: parses the v/vn/vt lines of a chunk into the global attribute arrays
+    void parseAttributes(const Chunk& chunk, Attributes& attributes) {
+        float* positions = attributes.positions.data() + chunk.base.positions * 3;
+        float* normals = attributes.normals.data() + chunk.base.normals * 3;
+        float* uvs = attributes.uvs.data() + chunk.base.uvs * 2;
+
+        const char* p = chunk.begin;
+        const char* end = chunk.end;
+        while (p < end) {
+            p = skipSpaces(p, end);
+            if (end - p >= 2 && p[0] == 'v' && isSpace(p[1])) {
+                p = parseFloat(p + 1, end, positions[0]);
+                p = parseFloat(p, end, positions[1]);
+                p = parseFloat(p, end, positions[2]);
+                positions += 3;
+            } else if (end - p >= 2 && p[0] == 'v' && p[1] == 'n') {
+                p = parseFloat(p + 2, end, normals[0]);
+                p = parseFloat(p, end, normals[1]);
+                p = parseFloat(p, end, normals[2]);
+                normals += 3;
+            } else if (end - p >= 2 && p[0] == 'v' && p[1] == 't') {
+                p = parseFloat(p + 2, end, uvs[0]);
+                p = parseFloat(p, end, uvs[1]);
+                uvs += 2;
+            }
+            p = skipLine(p, end);
+        }
+    }
+
+    // Pass 2: expands the faces of a chunk into its slice of the output.
+    // All attributes are known at this point, so faces may reference
+    // vertices anywhere in the file.
+    void parseFaces(Chunk& chunk, const Attributes& attributes, const OBJParser::Counts& totals, OBJParser::Data& out) {
+        // running (global) counts, used to resolve negative indices
+        std::size_t numPositions = chunk.base.positions;
+        std::size_t numNormals = chunk.base.normals;
+        std::size_t numUvs = chunk.base.uvs;
+        std::size_t numCorners = chunk.base.corners;
+
+        float* positionsOut = out.positions.data();
+        float* normalsOut = out.normals.data();
+        float* uvsOut = out.uvs.empty() ? nullptr : out.uvs.data();
+
+        // Writes one triangle. Corners must already be resolved to 0-based indices
+        auto emitTriangle = [&](const Corner& a, const Corner& b, const Corner& c) {
+            const Corner* corners[3] = { &a, &b, &c };
+
+            float* p = positionsOut + numCorners * 3;
+            float* n = normalsOut + numCorners * 3;
+
+            for (const Corner* corner : corners) {
+                std::memcpy(p, &attributes.positions[corner->position * 3], 3 * sizeof(float));
+                p += 3;
+            }
+
+            if (a.normal >= 0 && b.normal >= 0 && c.normal >= 0) {
+                for (const Corner* corner : corners) {
+                    std::memcpy(n, &attributes.normals[corner->normal * 3], 3 * sizeof(float));
+                    n += 3;
+                }
+            } else {
+                // no normals in the file for this face, use the flat face normal
+                const float* p0 = positionsOut + numCorners * 3;
+                float e1[3] = { p0[3] - p0[0], p0[4] - p0[1], p0[5] - p0[2] };
+                float e2[3] = { p0[6] - p0[0], p0[7] - p0[1], p0[8] - p0[2] };
+                float fn[3] = {
+                    e1[1] * e2[2] - e1[2] * e2[1],
+                    e1[2] * e2[0] - e1[0] * e2[2],
+                    e1[0] * e2[1] - e1[1] * e2[0]
+                };
+                float length = std::sqrt(fn[0] * fn[0] + fn[1] * fn[1] + fn[2] * fn[2]);
+                if (length > 0.0f) {
+                    fn[0] /= length;
+                    fn[1] /= length;
+                    fn[2] /= length;
+                }
+                for (unsigned int i = 0; i < 3; i++) {
+                    std::memcpy(n, fn, 3 * sizeof(float));
+                    n += 3;
+                }
+            }
+
+            if (uvsOut != nullptr) {
+                float* t = uvsOut + numCorners * 2;
+                for (const Corner* corner : corners) {
+                    if (corner->uv >= 0) {
+                        std::memcpy(t, &attributes.uvs[corner->uv * 2], 2 * sizeof(float));
+                    }
+                    t += 2;
+                }
+            }
+
+            numCorners += 3;
+        };
+
+        const char* p = chunk.begin;
+        const char* end = chunk.end;
+        while (p < end) {
+            p = skipSpaces(p, end);
+            if (end - p >= 2 && p[0] == 'v') {
+                if (isSpace(p[1])) {
+                    numPositions++;
+                } else if (p[1] == 'n') {
+                    numNormals++;
+                } else if (p[1] == 't') {
+                    numUvs++;
+                }
+            } else if (end - p >= 2 && p[0] == 'f' && isSpace(p[1])) {
+                // Triangulate as a fan around the first corner
+                Corner first, previous, current;
+                std::size_t cornersOnLine = 0;
+
+                p++;
+                while (true) {
+                    p = skipSpaces(p, end);
+                    if (p >= end || *p == '\n' || *p == '#') {
+                        break;
+                    }
+
+                    p = parseCorner(p, end, current);
+
+                    // positive indices may point anywhere in the file,
+                    // negative ones are relative to what we have seen so far
+                    current.position = resolve(current.position, current.position < 0 ? numPositions : totals.positions);
+                    current.uv = resolve(current.uv, current.uv < 0 ? numUvs : totals.uvs);
+                    current.normal = resolve(current.normal, current.normal < 0 ? numNormals : totals.normals);
+
+                    if (current.position < 0) {
+                        chunk.error = "face references an undefined vertex";
+                        return;
+                    }
+
+                    if (cornersOnLine == 0) {
+                        first = current;
+                    } else if (cornersOnLine >= 2) {
+                        emitTriangle(first, previous, current);
+                    }
+
+                    previous = current;
+                    cornersOnLine++;
+
+                    // skip anything we didn't understand in this token
+                    while (p < end && !isSpace(*p) && *p != '\n') {
+                        p++;
+                    }
+                }
+            }
+            p = skipLine(p, end);
+        }
+    }
+}
+
+OBJParser::Counts OBJParser::count(const char* begin, const char* end) {
+    Counts counts;
+
+    const char* p = begin;
+    while (p < end) {
+        p = skipSpaces(p, end);
+        if (end - p >= 2 && p[0] == 'v') {
+            if (isSpace(p[1])) {
+                counts.positions++;
+            } else if (p[1] == 'n') {
+                counts.normals++;
+            } else if (p[1] == 't') {
+                counts.uvs++;
+            }
+        } else if (end - p >= 2 && p[0] == 'f' && isSpace(p[1])) {
+            // count the corners on this line without converting them
+            std::size_t cornersOnLine = 0;
+            p++;
+            while (p < end && *p != '\n') {
+                p = skipSpaces(p, end);
+                if (p < end && *p != '\n' && *p != '#') {
+                    cornersOnLine++;
+                    while (p < end && !isSpace(*p) && *p != '\n') {
+                        p++;
+                    }
+                } else if (p < end && *p == '#') {
+                    break;
+                }
+            }
+            if (cornersOnLine >= 3) {
+                counts.corners += (cornersOnLine - 2) * 3;
+            }
+        }
+        p = skipLine(p, end);
+    }
+
+    return counts;
+}
+
+bool OBJParser::parse(const char* begin, const char* end, Data& out, const char** error) {
+    return parse(begin, end, out, error, ThreadPool::shared());
+}
+
+bool OBJParser::parse(const char* begin, const char* end, Data& out, const char** error, ThreadPool& pool) {
+    auto size = static_cast<std::size_t>(end - begin);
+    auto numChunks = std::max<std::size_t>(1, std::min(pool.getConcurrency() * 4, size / MIN_CHUNK_SIZE));
+
+    auto chunks = split(begin, end, numChunks);
+
+    pool.parallelFor(chunks.size(), [&](std::size_t i) {
+        chunks[i].counts = count(chunks[i].begin, chunks[i].end);
+    });
+
+    // exclusive prefix sum gives every chunk its global offsets
+    Counts totals;
+    for (auto& chunk : chunks) {
+        chunk.base = totals;
+        totals.positions += chunk.counts.positions;
+        totals.normals += chunk.counts.normals;
+        totals.uvs += chunk.counts.uvs;
+        totals.corners += chunk.counts.corners;
+    }
+
+    Attributes attributes;
+    attributes.positions.resize(totals.positions * 3);
+    attributes.normals.resize(totals.normals * 3);
+    attributes.uvs.resize(totals.uvs * 2);
+
+    pool.parallelFor(chunks.size(), [&](std::size_t i) {
+        parseAttributes(chunks[i], attributes);
+    });
+
+    // every chunk writes its faces straight into its own slice of the output
+    out.positions.resize(totals.corners * 3);
+    out.normals.resize(totals.corners * 3);
+    out.uvs.assign(totals.uvs > 0 ? totals.corners * 2 : 0, 0.0f);
+
+    pool.parallelFor(chunks.size(), [&](std::size_t i) {
+        parseFaces(chunks[i], attributes, totals, out);
+    });
+
+    for (const auto& chunk : chunks) {
+        if (chunk.error != nullptr) {
+            *error = chunk.error;
+            return false;
+        }
+    }
+
+    return true;
+}
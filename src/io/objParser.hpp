@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * Allocation-free tokenizer for Wavefront .obj files.
+ * Works directly on a character range (e.g. a MappedFile) and writes
+ * triangulated, fully expanded vertex attributes into preallocated arrays.
+ *
+ * Supported face formats: v, v/t, v//n, v/t/n (including negative indices).
+ * Polygons are triangulated as fans. Corners without a normal get the flat
+ * face normal.
+ *
+ * Large files are split into newline-aligned chunks that are parsed on the
+ * shared ThreadPool. A prefix sum over the per-chunk counts gives every chunk
+ * its global v/vn/vt offsets and its slice of the output arrays, so faces
+ * may appear anywhere in the file.
+ **/
+namespace OBJParser {
+    struct Counts {
+        std::size_t positions = 0;
+        std::size_t normals = 0;
+        std::size_t uvs = 0;
+        // number of triangle corners after triangulation
+        std::size_t corners = 0;
+    };
+
+    struct Data {
+        // 3 floats per corner
+        std::vector<float> positions;
+        // 3 floats per corner
+        std::vector<float> normals;
+        // 2 floats per corner, empty if the file has no texture coordinates
+        std::vector<float> uvs;
+    };
+
+    // Cheap first pass, used to size the output arrays
+    Counts count(const char* begin, const char* end);
+
+    // Returns false (and leaves a message in error) if the file is malformed
+    bool parse(const char* begin, const char* end, Data& out, const char** error);
+
+    // Same, on the given pool rather than the shared one
+    bool parse(const char* begin, const char* end, Data& out, const char** error, ThreadPool& pool);
+} /* OBJParser */
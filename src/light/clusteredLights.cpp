@@ -0,0 +1,248 @@
+#include "clusteredLights.hpp"
+
+#include "geometry/frustum.hpp"
+#include "light.hpp"
+#include "util/threadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <ostream>
+
+namespace {
+    // Creates a buffer texture of the given texel format over a new buffer
+    void createBufferTexture(GLenum format, GLuint& buffer, GLuint& texture) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Replaces the buffer's storage (so the GPU can keep reading last
+    // frame's) with the data; never empty, texel fetches past it read 0
+    void upload(GLuint buffer, const void* data, std::size_t bytes) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+
+        if (bytes == 0) {
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        } else {
+            glBufferData(GL_TEXTURE_BUFFER, bytes, data, GL_STREAM_DRAW);
+        }
+
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Maps eye space depths to exponentially spaced slices, matching
+    // clusterSlice in ShaderUtils::CLUSTERED_LIGHTS
+    struct Slicing {
+        float near;
+        float scale;
+
+        explicit Slicing(const glm::mat4& projection) {
+            // near and far back from a glm::perspective matrix
+            near = projection[3][2] / (projection[2][2] - 1.0f);
+            float far = projection[3][2] / (projection[2][2] + 1.0f);
+
+            scale = static_cast<float>(ClusteredLights::SLICES) / std::log(far / near);
+        }
+
+        uint8_t operator()(float depth) const {
+            if (!(depth > near)) {
+                return 0;
+            }
+
+            float slice = std::log(depth / near) * scale;
+            if (!(slice < static_cast<float>(ClusteredLights::SLICES))) {
+                return ClusteredLights::SLICES - 1;
+            }
+
+            return static_cast<uint8_t>(slice);
+        }
+    };
+}
+
+ClusteredLights::~ClusteredLights() {
+    glDeleteTextures(1, &lightTexture);
+    glDeleteTextures(1, &clusterTexture);
+    glDeleteTextures(1, &indexTexture);
+
+    glDeleteBuffers(1, &lightBuffer);
+    glDeleteBuffers(1, &clusterBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+}
+
+void ClusteredLights::initialize() {
+    createBufferTexture(GL_RGBA32F, lightBuffer, lightTexture);
+    createBufferTexture(GL_RG32UI, clusterBuffer, clusterTexture);
+    createBufferTexture(GL_R32UI, indexBuffer, indexTexture);
+
+    GLint texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &texels);
+    maxTexels = static_cast<std::size_t>(texels);
+
+    clusterTexels.assign(2 * CLUSTERS, 0);
+}
+
+void ClusteredLights::update(
+    const std::vector<std::shared_ptr<Light>>& lights,
+    const glm::mat4& viewMatrix,
+    const glm::mat4& projectionMatrix
+) const {
+    auto start = std::chrono::steady_clock::now();
+
+    statistics = Statistics();
+
+    // 1. enabled lights in eye space, directional lights reach everywhere
+    spheres.clear();
+    texels.clear();
+
+    for (const auto& light : lights) {
+        auto info = light->getLightInfo();
+        if (!info.enabled) {
+            continue;
+        }
+
+        glm::vec4 position;
+        if (info.position.w == 0.0f) {
+            position = glm::vec4(glm::normalize(glm::mat3(viewMatrix) * glm::vec3(info.position)), 0.0f);
+            spheres.emplace_back(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::infinity());
+        } else {
+            position = viewMatrix * info.position;
+            spheres.emplace_back(glm::vec3(position), light->getRadius());
+        }
+
+        texels.push_back(position);
+        texels.emplace_back(info.color * info.intensity, info.attenuation);
+        texels.emplace_back(light->getRadius(), 0.0f, 0.0f, 0.0f);
+    }
+
+    statistics.lights = spheres.size();
+
+    // 2. those in the view frustum, with the slices their sphere spans
+    auto frustum = Frustum::fromMatrix(projectionMatrix);
+    inFrustum.resize(spheres.size());
+    frustum.intersects(spheres.data(), inFrustum.data(), spheres.size());
+
+    Slicing slicing(projectionMatrix);
+
+    visibleSpheres.clear();
+    visibleSlices.clear();
+    lightTexels.clear();
+
+    for (std::size_t l = 0; l < spheres.size(); l++) {
+        if (!inFrustum[l]) {
+            continue;
+        }
+
+        const auto& sphere = spheres[l];
+        float depth = -sphere.z;
+
+        visibleSpheres.push_back(sphere);
+        visibleSlices.push_back({ slicing(depth - sphere.w), slicing(depth + sphere.w) });
+        lightTexels.insert(lightTexels.end(), texels.begin() + LIGHT_TEXELS * l, texels.begin() + LIGHT_TEXELS * (l + 1));
+    }
+
+    statistics.visibleLights = visibleSpheres.size();
+
+    // 3. per tile, the visible lights in its frustum sorted by slice
+    ThreadPool::shared().parallelFor(tiles.size(), [this, &projectionMatrix](std::size_t t) {
+        auto& tile = tiles[t];
+        auto x = static_cast<float>(t % TILES_X);
+        auto y = static_cast<float>(t / TILES_X);
+
+        glm::vec2 tileSize(2.0f / static_cast<float>(TILES_X), 2.0f / static_cast<float>(TILES_Y));
+        glm::vec2 ndcMin = glm::vec2(-1.0f) + glm::vec2(x, y) * tileSize;
+
+        auto tileFrustum = Frustum::fromMatrix(projectionMatrix, ndcMin, ndcMin + tileSize);
+
+        std::size_t count = visibleSpheres.size();
+        tile.visible.resize(count);
+        tileFrustum.intersects(visibleSpheres.data(), tile.visible.data(), count);
+
+        tile.count.fill(0);
+        for (std::size_t l = 0; l < count; l++) {
+            if (tile.visible[l]) {
+                for (uint32_t s = visibleSlices[l][0]; s <= visibleSlices[l][1]; s++) {
+                    tile.count[s]++;
+                }
+            }
+        }
+
+        uint32_t total = 0;
+        for (uint32_t s = 0; s < SLICES; s++) {
+            tile.first[s] = total;
+            total += tile.count[s];
+        }
+
+        tile.indices.resize(total);
+
+        auto cursor = tile.first;
+        for (std::size_t l = 0; l < count; l++) {
+            if (tile.visible[l]) {
+                for (uint32_t s = visibleSlices[l][0]; s <= visibleSlices[l][1]; s++) {
+                    tile.indices[cursor[s]++] = static_cast<uint32_t>(l);
+                }
+            }
+        }
+    });
+
+    // 4. concatenate the tiles' lists; lists past the texture buffer size limit are cut
+    indexTexels.clear();
+
+    for (uint32_t t = 0; t < tiles.size(); t++) {
+        const auto& tile = tiles[t];
+        std::size_t base = indexTexels.size();
+
+        for (uint32_t s = 0; s < SLICES; s++) {
+            std::size_t first = base + tile.first[s];
+            std::size_t count = tile.count[s];
+
+            if (first + count > maxTexels) {
+                count = first < maxTexels ? maxTexels - first : 0;
+            }
+
+            uint32_t cluster = (s * TILES_Y + t / TILES_X) * TILES_X + t % TILES_X;
+            clusterTexels[2 * cluster] = static_cast<uint32_t>(first);
+            clusterTexels[2 * cluster + 1] = static_cast<uint32_t>(count);
+
+            statistics.maxClusterLights = std::max(statistics.maxClusterLights, count);
+        }
+
+        indexTexels.insert(indexTexels.end(), tile.indices.begin(), tile.indices.end());
+    }
+
+    if (indexTexels.size() > maxTexels) {
+        if (!overflowReported) {
+            std::cout << "Too many cluster light indices (" << indexTexels.size() << "), only the first " << maxTexels << " are used\n";
+            overflowReported = true;
+        }
+
+        indexTexels.resize(maxTexels);
+    }
+
+    statistics.lightIndices = indexTexels.size();
+
+    upload(lightBuffer, lightTexels.data(), lightTexels.size() * sizeof(glm::vec4));
+    upload(clusterBuffer, clusterTexels.data(), clusterTexels.size() * sizeof(uint32_t));
+    upload(indexBuffer, indexTexels.data(), indexTexels.size() * sizeof(uint32_t));
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    statistics.binningMilliseconds = elapsed.count();
+}
+
+std::ostream& operator<<(std::ostream& os, const ClusteredLights::Statistics& statistics) {
+    return os << statistics.lights << " lights ("
+        << statistics.visibleLights << " in view), "
+        << statistics.lightIndices << " cluster entries (at most "
+        << statistics.maxClusterLights << " per cluster), binning "
+        << statistics.binningMilliseconds << " ms, lighting pass "
+        << statistics.lightingMilliseconds << " ms";
+}
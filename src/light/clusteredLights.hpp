@@ -0,0 +1,130 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+class Light;
+
+/**
+ * Bins the enabled lights into clusters (screen tiles x exponential depth
+ * slices of the view frustum) so the deferred lighting pass only shades a
+ * pixel with the lights whose range reaches its cluster. There is no cap on
+ * the number of lights.
+ *
+ * Binning runs on the CPU every frame: lights are culled against the view
+ * frustum, then every tile tests the remaining light spheres against its
+ * own frustum (four at a time, see Frustum::intersects) on the shared
+ * ThreadPool, and files them into the depth slices their sphere spans.
+ *
+ * The result is uploaded to three texture buffers:
+ * lights: RGBA32F, LIGHT_TEXELS per light: eye space position (w = 1) or
+ *   direction (w = 0), then color * intensity and attenuation, then the
+ *   radius (Light::getRadius)
+ * clusters: RG32UI, (first index, light count) per cluster, cluster
+ *   (x, y, slice) at (slice * TILES_Y + y) * TILES_X + x
+ * indices: R32UI, the lights of every cluster
+ * ShaderUtils::CLUSTERED_LIGHTS reads them back.
+ **/
+class ClusteredLights {
+    public:
+        static constexpr uint32_t TILES_X = 16;
+        static constexpr uint32_t TILES_Y = 9;
+        static constexpr uint32_t SLICES = 24;
+        static constexpr uint32_t CLUSTERS = TILES_X * TILES_Y * SLICES;
+        static constexpr uint32_t LIGHT_TEXELS = 3;
+
+        struct Statistics {
+            // enabled lights, and those in the view frustum
+            std::size_t lights = 0;
+            std::size_t visibleLights = 0;
+            // entries in all cluster lists, and the longest list
+            std::size_t lightIndices = 0;
+            std::size_t maxClusterLights = 0;
+
+            float binningMilliseconds = 0.0f;
+            // GPU time of the lighting pass, filled in by the renderer
+            float lightingMilliseconds = 0.0f;
+        };
+
+        ClusteredLights() = default;
+
+        ClusteredLights(ClusteredLights&& other) = delete;
+        ClusteredLights& operator=(ClusteredLights&& other) = delete;
+
+        ClusteredLights(const ClusteredLights& other) = delete;
+        ClusteredLights& operator=(const ClusteredLights& other) = delete;
+
+        ~ClusteredLights();
+
+        void initialize();
+
+        // Bins the lights for the camera and uploads the texture buffers
+        void update(
+            const std::vector<std::shared_ptr<Light>>& lights,
+            const glm::mat4& viewMatrix,
+            const glm::mat4& projectionMatrix
+        ) const;
+
+        GLuint getLightTexture() const {
+            return lightTexture;
+        }
+
+        GLuint getClusterTexture() const {
+            return clusterTexture;
+        }
+
+        GLuint getIndexTexture() const {
+            return indexTexture;
+        }
+
+        // Of the last update
+        const Statistics& getStatistics() const {
+            return statistics;
+        }
+    private:
+        // one tile's lights, sorted by slice; indices into the visible lights
+        struct Tile {
+            std::vector<uint8_t> visible;
+            std::vector<uint32_t> indices;
+            std::array<uint32_t, SLICES> first;
+            std::array<uint32_t, SLICES> count;
+        };
+
+        GLuint lightBuffer = 0;
+        GLuint lightTexture = 0;
+        GLuint clusterBuffer = 0;
+        GLuint clusterTexture = 0;
+        GLuint indexBuffer = 0;
+        GLuint indexTexture = 0;
+
+        // GL_MAX_TEXTURE_BUFFER_SIZE, in texels
+        std::size_t maxTexels = 0;
+
+        // warn only once about cluster lists that do not fit
+        mutable bool overflowReported = false;
+
+        // scratch space, kept to avoid per-frame allocations
+        // per enabled light: its eye space sphere and texels
+        mutable std::vector<glm::vec4> spheres;
+        mutable std::vector<glm::vec4> texels;
+        mutable std::vector<uint8_t> inFrustum;
+        // per visible light: its eye space sphere, first and last slice, texels
+        mutable std::vector<glm::vec4> visibleSpheres;
+        mutable std::vector<std::array<uint8_t, 2>> visibleSlices;
+        mutable std::vector<glm::vec4> lightTexels;
+        mutable std::array<Tile, TILES_X * TILES_Y> tiles;
+        mutable std::vector<uint32_t> clusterTexels;
+        mutable std::vector<uint32_t> indexTexels;
+
+        mutable Statistics statistics;
+};
+
+std::ostream& operator<<(std::ostream& os, const ClusteredLights::Statistics& statistics);
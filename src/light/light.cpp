@@ -1,5 +1,11 @@
 #include "light.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const float Light::RADIANCE_CUTOFF = 0.01f;
+
 Light::Light(
     glm::vec3 color,
     float intensity,
@@ -11,3 +17,14 @@ Light::Light(
     ambientCoefficient(ambientCoefficient),
     attenuation(attenuation)
 {}
+
+float Light::getRadius() const {
+    if (attenuation <= 0.0f) {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    // solve I * c / (1 + a * d^2) = cutoff for d, c the brightest channel
+    float radiance = intensity * std::max(color.x, std::max(color.y, color.z));
+
+    return std::sqrt(std::max(radiance / RADIANCE_CUTOFF - 1.0f, 0.0f) / attenuation);
+}
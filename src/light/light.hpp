@@ -16,6 +16,10 @@ typedef struct LightInfo {
 
 class Light {
     public:
+        // Radiance (color * intensity * attenuation) below which a light is
+        // considered to no longer contribute, see getRadius
+        static const float RADIANCE_CUTOFF;
+
         Light(
             glm::vec3 color,
             float intensity,
@@ -31,26 +35,46 @@ class Light {
 
         void setColor(glm::vec3 c) {
             color = c;
+            dirty = true;
         }
 
         void setAmbientCoefficient(float ac) {
             ambientCoefficient = ac;
+            dirty = true;
         }
 
         void setAttenuation(float a) {
             attenuation = a;
+            dirty = true;
         }
 
         void setIntensity(float i) {
             intensity = i;
+            dirty = true;
         }
 
         void toggle() {
             enabled = !enabled;
+            dirty = true;
         }
 
         virtual LightInfo getLightInfo() const = 0;
 
+        // Distance at which the light's radiance drops below RADIANCE_CUTOFF,
+        // with attenuation 1 / (1 + attenuation * d^2). Infinite for lights
+        // without attenuation (e.g. directional lights)
+        float getRadius() const;
+
+        // Set whenever the light changes, cleared by whoever consumes the
+        // change (LightBuffer)
+        bool isDirty() const {
+            return dirty;
+        }
+
+        void setDirty(bool d) {
+            dirty = d;
+        }
+
         virtual ~Light() = default;
 
     protected:
@@ -59,4 +83,6 @@ class Light {
         float ambientCoefficient;
         float attenuation;
         bool enabled = true;
+
+        bool dirty = true;
 };
@@ -0,0 +1,64 @@
+#include "lightBuffer.hpp"
+
+#include "light.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+LightBuffer::~LightBuffer() {
+    glDeleteBuffers(1, &buffer);
+}
+
+void LightBuffer::initialize() {
+    glGenBuffers(1, &buffer);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+
+    dirty = true;
+}
+
+void LightBuffer::update(const std::vector<std::shared_ptr<Light>>& lights) const {
+    bool changed = dirty;
+
+    for (const auto& light : lights) {
+        changed = changed || light->isDirty();
+        light->setDirty(false);
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    // only reported when the list changes; the clustered PBR pass has no cap
+    if (dirty && lights.size() > MAX_LIGHTS) {
+        std::cout << "Too many lights for the Lights block (" << lights.size() << "), only the first " << MAX_LIGHTS << " are used\n";
+    }
+
+    Block block = {};
+    block.numLights = static_cast<int32_t>(std::min(lights.size(), MAX_LIGHTS));
+
+    for (int32_t i = 0; i < block.numLights; i++) {
+        auto lightInfo = lights[i]->getLightInfo();
+        auto& entry = block.lights[i];
+
+        entry.position = lightInfo.position;
+        entry.color = lightInfo.color;
+        entry.intensity = lightInfo.intensity;
+        entry.ambientCoefficient = lightInfo.ambientCoefficient;
+        entry.attenuation = lightInfo.attenuation;
+        entry.enabled = lightInfo.enabled ? 1.0f : 0.0f;
+        entry.coneAngle = lightInfo.coneAngle;
+        entry.coneDirection = lightInfo.coneDirection;
+        entry.radius = lights[i]->getRadius();
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    dirty = false;
+}
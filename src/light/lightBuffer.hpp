@@ -0,0 +1,78 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Light;
+
+/**
+ * std140 uniform buffer holding every light in the scene, bound to a fixed
+ * binding point that all programs declaring the Lights block
+ * (ShaderUtils::LIGHTS_BLOCK) are attached to.
+ * The buffer is only re-uploaded when a light or the light list changes.
+ * Holds at most MAX_LIGHTS; the PBR pass reads any number of lights through
+ * ClusteredLights instead.
+ **/
+class LightBuffer {
+    public:
+        // Must match MAX_LIGHTS in ShaderUtils::LIGHTS_BLOCK
+        static constexpr std::size_t MAX_LIGHTS = 10;
+        static constexpr GLuint BINDING = 0;
+
+        LightBuffer() = default;
+
+        LightBuffer(LightBuffer&& other) = delete;
+        LightBuffer& operator=(LightBuffer&& other) = delete;
+
+        LightBuffer(const LightBuffer& other) = delete;
+        LightBuffer& operator=(const LightBuffer& other) = delete;
+
+        ~LightBuffer();
+
+        void initialize();
+
+        // Call when lights are added or removed
+        void invalidate() {
+            dirty = true;
+        }
+
+        // Uploads the lights if any of them changed since the last update
+        void update(const std::vector<std::shared_ptr<Light>>& lights) const;
+
+        GLuint getBuffer() const {
+            return buffer;
+        }
+    private:
+        // std140 layout of struct Light
+        struct Entry {
+            glm::vec4 position;
+            glm::vec3 color;
+            float intensity;
+            float ambientCoefficient;
+            float attenuation;
+            float enabled;
+            float coneAngle;
+            glm::vec3 coneDirection;
+            float radius;
+        };
+
+        // std140 layout of the Lights block; arrays of structs start on a 16 byte boundary
+        struct Block {
+            int32_t numLights;
+            int32_t padding[3];
+            Entry lights[MAX_LIGHTS];
+        };
+
+        static_assert(sizeof(Entry) == 64, "Entry must match the std140 layout of Light");
+        static_assert(sizeof(Block) == 16 + 64 * MAX_LIGHTS, "Block must match the std140 layout of Lights");
+
+        GLuint buffer = 0;
+
+        mutable bool dirty = true;
+};
@@ -24,6 +24,7 @@ class PointLight : public Light {
 
         void setPosition(glm::vec3 p) {
             position = p;
+            dirty = true;
         }
 
         LightInfo getLightInfo() const override;
@@ -22,17 +22,14 @@ void DeferredMaterial::create() {
     std::string vertexShaderSource = R"(
         #version 330
         layout(location = 0) in vec3 position;
-        layout(location = 1) in vec3 normal;
-        uniform mat4 projectionMatrix;
-        uniform mat4 viewMatrix;
-        uniform mat4 modelMatrix;
-
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::MATERIAL_VERTEX_INPUTS) + R"(
         out vec3 vNormalEyespace;
         out vec4 vPositionEyespace;
 
         void main() {
-            vNormalEyespace = (transpose(inverse(viewMatrix * modelMatrix)) * vec4(normal, 0.0)).xyz;
-            vPositionEyespace = viewMatrix * modelMatrix * vec4(position, 1.0);
+            vNormalEyespace = normalToEyespace(vertexNormal());
+            vPositionEyespace = positionToEyespace(position);
+            passMaterial();
 
             gl_Position = projectionMatrix * vPositionEyespace;
         }
@@ -46,22 +43,14 @@ void DeferredMaterial::create() {
         layout(location = 2) out vec4 albedo;
         layout(location = 3) out vec4 emissive;
 
-        uniform mat4 viewMatrix;
-
-        uniform vec3 color;
-        uniform float specularCoefficient;
-
-        // todo: shininess?
-        // uniform float shininess;
-
-        uniform vec3 emissiveColor;
-        uniform float emissiveStrength;
-        uniform float emissiveEnabled;
+    )" + std::string(ShaderUtils::MATERIAL_FRAGMENT_INPUTS) + R"(
 
         in vec3 vNormalEyespace;
         in vec4 vPositionEyespace;
 
         void main() {
+            loadMaterial();
+
             vec3 N = normalize(vNormalEyespace);
             vec3 E = normalize(-vPositionEyespace.xyz);
 
@@ -79,28 +68,5 @@ void DeferredMaterial::create() {
         }
     )";
 
-    if (!compile(vertexShaderSource, fragmentShaderSource)) {
-        return;
-    }
-
-    GLuint shader = getProgram();
-
-    glUseProgram(shader);
-    auto projectionMatrixLocation = glGetUniformLocation(shader, "projectionMatrix");
-    auto viewMatrixLocation = glGetUniformLocation(shader, "viewMatrix");
-    auto modelMatrixLocation = glGetUniformLocation(shader, "modelMatrix");
-    auto colorLocation = glGetUniformLocation(shader, "color");
-    auto specularCoefficientLocation = glGetUniformLocation(shader, "specularCoefficient");
-    auto emissiveColorLocation = glGetUniformLocation(shader, "emissiveColor");
-    auto emissiveStrengthLocation = glGetUniformLocation(shader, "emissiveStrength");
-    auto emissiveEnabledLocation = glGetUniformLocation(shader, "emissiveEnabled");
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
-    glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
-    glUniform3fv(colorLocation, 1, glm::value_ptr(getColor()));
-    glUniform1f(specularCoefficientLocation, getSpecularCoefficient());
-    glUniform3fv(emissiveColorLocation, 1, glm::value_ptr(getColor()));
-    glUniform1f(emissiveStrengthLocation, 0.0f);
-    glUniform1f(emissiveEnabledLocation, 0.0f);
-    glUseProgram(0);
+    compile(vertexShaderSource, fragmentShaderSource, true);
 }
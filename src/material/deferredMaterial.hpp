@@ -23,7 +23,6 @@ class DeferredMaterial : public Material {
 
         void setShininess(float shininess) const override { (void)shininess; }
 
-        void setLights(const std::vector<std::shared_ptr<Light>>& lights) const override { (void)lights; }
         void toggleBlinnPhongShading(bool value) const override { (void)value; }
     private:
 };
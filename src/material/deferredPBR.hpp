@@ -24,8 +24,10 @@ class DeferredPBRMaterial : public Material {
         void setRoughness(float roughness) const override;
         void setMetalness(float metalness) const override;
 
-        void setLights(const std::vector<std::shared_ptr<Light>>& lights) const override { (void)lights; }
+        void fillInstance(InstanceAttributes& instance) const override;
+    protected:
+        void uploadUniforms(const UniformTable<Uniform>& table) const override;
     private:
-        float roughness;
-        float metalness;
+        mutable float roughness;
+        mutable float metalness;
 };
@@ -1,21 +1,20 @@
 #include "material.hpp"
 
+#include "frameUniforms.hpp"
 #include "gl/shaderUtils.hpp"
-
-#include "light/light.hpp"
+#include "instancedBatch.hpp"
+#include "light/lightBuffer.hpp"
+#include "resourceCache.hpp"
 
 #include <GL/glew.h>
-#include <glm/gtc/type_ptr.hpp>
-
-#include <iostream>
 
 #include <string>
-#include <sstream>
 
 Material::Material(glm::vec3 color, float specularCoefficient, float shininess) :
     color(color),
     specularCoefficient(specularCoefficient),
-    shininess(shininess)
+    shininess(shininess),
+    emissiveColor(color)
 {}
 
 void Material::create() {
@@ -26,17 +25,14 @@ void Material::create() {
     std::string vertexShaderSource = R"(
         #version 330
         layout(location = 0) in vec3 position;
-        layout(location = 1) in vec3 normal;
-        uniform mat4 projectionMatrix;
-        uniform mat4 viewMatrix;
-        uniform mat4 modelMatrix;
-
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::MATERIAL_VERTEX_INPUTS) + R"(
         out vec3 vNormalEyespace;
         out vec4 vPositionEyespace;
 
         void main() {
-            vNormalEyespace = (transpose(inverse(viewMatrix * modelMatrix)) * vec4(normal, 0.0)).xyz;
-            vPositionEyespace = viewMatrix * modelMatrix * vec4(position, 1.0);
+            vNormalEyespace = normalToEyespace(vertexNormal());
+            vPositionEyespace = positionToEyespace(position);
+            passMaterial();
 
             gl_Position = projectionMatrix * vPositionEyespace;
         }
@@ -45,38 +41,16 @@ void Material::create() {
     std::string fragmentShaderSource = R"(
         #version 330
 
-        #define MAX_LIGHTS 10
-
         out vec4 fColor;
 
-        uniform mat4 viewMatrix;
-
-        uniform vec3 color;
-        uniform float shininess;
-
-        uniform vec3 emissiveColor;
-        uniform float emissiveStrength;
-        uniform float emissiveEnabled;
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + std::string(ShaderUtils::MATERIAL_FRAGMENT_INPUTS) + R"(
 
         uniform float blinnEnabled;
 
-        uniform float specularCoefficient;
-
         in vec3 vNormalEyespace;
         in vec4 vPositionEyespace;
 
-        uniform int numLights;
-        uniform struct Light {
-            vec4 position;
-            vec3 color;
-            float intensity;
-            float ambientCoefficient;
-            float attenuation;
-            float enabled;
-            // spotlight only
-            float coneAngle;
-            vec3 coneDirection;
-        } lights[MAX_LIGHTS];
+    )" + std::string(ShaderUtils::LIGHTS_BLOCK) + R"(
 
         vec3 illuminate(vec3 inColor, vec3 P, vec3 N, vec3 E) {
             vec3 outColor = vec3(0.0);
@@ -98,7 +72,7 @@ void Material::create() {
                     vec3 lightPositionEyespace = (viewMatrix * light.position).xyz;
                     L = normalize(lightPositionEyespace - P);
                     float distance = length(lightPositionEyespace - P);
-                    attenuation = 1.0 / (1.0 + light.attenuation * pow(distance, 2));
+                    attenuation = attenuate(distance, light.attenuation, light.radius);
                 }
                 // TODO: Spotlights
 
@@ -145,6 +119,8 @@ void Material::create() {
         }
 
         void main() {
+            loadMaterial();
+
             vec3 N = normalize(vNormalEyespace);
             vec3 E = normalize(-vPositionEyespace.xyz);
 
@@ -156,206 +132,158 @@ void Material::create() {
         }
     )";
 
-    if (!compile(vertexShaderSource, fragmentShaderSource)) {
-        return;
-    }
-
-    GLuint shader = getProgram();
-
-    glUseProgram(shader);
-    auto projectionMatrixLocation = glGetUniformLocation(shader, "projectionMatrix");
-    auto viewMatrixLocation = glGetUniformLocation(shader, "viewMatrix");
-    auto modelMatrixLocation = glGetUniformLocation(shader, "modelMatrix");
-    auto colorLocation = glGetUniformLocation(shader, "color");
-    auto shininessLocation = glGetUniformLocation(shader, "shininess");
-    auto specularCoefficientLocation = glGetUniformLocation(shader, "specularCoefficient");
-    auto emissiveColorLocation = glGetUniformLocation(shader, "emissiveColor");
-    auto emissiveStrengthLocation = glGetUniformLocation(shader, "emissiveStrength");
-    auto emissiveEnabledLocation = glGetUniformLocation(shader, "emissiveEnabled");
-    auto blinnEnabledLocation = glGetUniformLocation(shader, "blinnEnabled");
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
-    glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
-    glUniform3fv(colorLocation, 1, glm::value_ptr(color));
-    glUniform1f(shininessLocation, shininess);
-    glUniform1f(specularCoefficientLocation, specularCoefficient);
-    glUniform3fv(emissiveColorLocation, 1, glm::value_ptr(color));
-    glUniform1f(emissiveStrengthLocation, 0.0f);
-    glUniform1f(emissiveEnabledLocation, 0.0f);
-    glUniform1f(blinnEnabledLocation, 1.0f);
-    glUseProgram(0);
+    compile(vertexShaderSource, fragmentShaderSource, true);
 }
 
-Material::~Material() {
-    glDeleteProgram(program);
+namespace {
+    void link(const ShaderProgram& program, UniformTable<Material::Uniform>& uniforms) {
+        uniforms.resolve(
+            program.get(),
+            {
+                "modelViewMatrix",
+                "normalMatrix",
+                "color",
+                "shininess",
+                "specularCoefficient",
+                "emissiveColor",
+                "emissiveStrength",
+                "emissiveEnabled",
+                "blinnEnabled",
+                "roughness",
+                "metalness"
+            }
+        );
+
+        ShaderUtils::bindUniformBlock(program.get(), "Lights", LightBuffer::BINDING);
+        ShaderUtils::bindUniformBlock(program.get(), "Frame", FrameUniforms::BINDING);
+    }
 }
 
-bool Material::compile(std::string vertexShader, std::string fragmentShader) {
-    program = ShaderUtils::compile(vertexShader, fragmentShader);
+bool Material::compile(std::string vertexShader, std::string fragmentShader, bool instanced) {
+    if (normalFormat == VertexLayout::NormalFormat::octahedral) {
+        vertexShader = ShaderUtils::addDefine(vertexShader, "OCTAHEDRAL_NORMALS");
+    }
 
-    return program != 0;
-}
+    program = ResourceCache::shared().getProgram(vertexShader, fragmentShader);
 
-void Material::setColor(glm::vec3 color) const {
-    glUseProgram(program);
-    auto colorLocation = glGetUniformLocation(program, "color");
-    glUniform3fv(colorLocation, 1, glm::value_ptr(color));
-    glUseProgram(0);
-}
+    if (!program) {
+        return false;
+    }
 
-void Material::setEmissiveColorAndStrength(glm::vec3 color, float strength) const {
-    glUseProgram(program);
-    auto emissiveColorLocation = glGetUniformLocation(program, "emissiveColor");
-    auto emissiveStrengthLocation = glGetUniformLocation(program, "emissiveStrength");
-    glUniform3fv(emissiveColorLocation, 1, glm::value_ptr(color));
-    glUniform1f(emissiveStrengthLocation, strength);
-    glUseProgram(0);
-}
+    link(*program, uniforms);
 
-void Material::setEmissiveColor(glm::vec3 color) const {
-    glUseProgram(program);
-    auto emissiveColorLocation = glGetUniformLocation(program, "emissiveColor");
-    glUniform3fv(emissiveColorLocation, 1, glm::value_ptr(color));
-    glUseProgram(0);
-}
+    if (instanced) {
+        instancedProgram = ResourceCache::shared().getProgram(
+            ShaderUtils::addDefine(vertexShader, "INSTANCED"),
+            ShaderUtils::addDefine(fragmentShader, "INSTANCED")
+        );
 
-void Material::setEmissiveStrength(float strength) const {
-    glUseProgram(program);
-    auto emissiveStrengthLocation = glGetUniformLocation(program, "emissiveStrength");
-    glUniform1f(emissiveStrengthLocation, strength);
-    glUseProgram(0);
-}
+        if (instancedProgram) {
+            link(*instancedProgram, instancedUniforms);
+        }
 
-void Material::toggleEmissive(bool value) const {
-    glUseProgram(program);
-    auto emissiveEnabledLocation = glGetUniformLocation(program, "emissiveEnabled");
-    glUniform1f(emissiveEnabledLocation, value ? 1.0f : 0.0f);
-    glUseProgram(0);
-}
+        multiDrawProgram = ResourceCache::shared().getProgram(
+            ShaderUtils::addDefine(vertexShader, "MULTI_DRAW"),
+            ShaderUtils::addDefine(fragmentShader, "MULTI_DRAW")
+        );
 
-void Material::toggleBlinnPhongShading(bool value) const {
-    glUseProgram(program);
-    auto blinnEnabledLocation = glGetUniformLocation(program, "blinnEnabled");
-    glUniform1f(blinnEnabledLocation, value ? 1.0f : 0.0f);
-    glUseProgram(0);
+        if (multiDrawProgram) {
+            link(*multiDrawProgram, multiDrawUniforms);
+        }
+    }
+
+    return true;
 }
 
-void Material::setShininess(float shininess) const {
-    glUseProgram(program);
-    auto shininessLocation = glGetUniformLocation(program, "shininess");
-    glUniform1f(shininessLocation, shininess);
-    glUseProgram(0);
+void Material::setUniforms() const {
+    if (!program) {
+        return;
+    }
+
+    if (program->claim(this) || dirty) {
+        uploadUniforms(uniforms);
+        dirty = false;
+    }
 }
 
-void Material::setLights(const std::vector<std::shared_ptr<Light>>& lights) const {
-    std::size_t lightIndex = 0;
-
-    glUseProgram(program);
-
-    glUniform1i(glGetUniformLocation(program, "numLights"), lights.size());
-
-    for (const auto& light : lights) {
-        auto lightInfo = light->getLightInfo();
-
-        // position
-        std::ostringstream positionLocation;
-        std::ostringstream colorLocation;
-        std::ostringstream intensityLocation;
-        std::ostringstream attenuationLocation;
-        std::ostringstream ambientCoefficientLocation;
-        std::ostringstream enabledLocation;
-        std::ostringstream coneAngleLocation;
-        std::ostringstream coneDirectionLocation;
-
-        positionLocation << "lights[" << lightIndex << "].position";
-        colorLocation << "lights[" << lightIndex << "].color";
-        intensityLocation << "lights[" << lightIndex << "].intensity";
-        attenuationLocation << "lights[" << lightIndex << "].attenuation";
-        ambientCoefficientLocation << "lights[" << lightIndex << "].ambientCoefficient";
-        enabledLocation << "lights[" << lightIndex << "].enabled";
-        coneAngleLocation << "lights[" << lightIndex << "].coneAngle";
-        coneDirectionLocation << "lights[" << lightIndex << "].coneDirection";
-
-        glUniform4fv(
-            glGetUniformLocation(program, positionLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.position)
-        );
+void Material::setInstancedUniforms() const {
+    if (!instancedProgram) {
+        return;
+    }
 
-        glUniform3fv(
-            glGetUniformLocation(program, colorLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.color)
-        );
+    if (instancedProgram->claim(this) || instancedDirty) {
+        uploadUniforms(instancedUniforms);
+        instancedDirty = false;
+    }
+}
 
-        glUniform1f(
-            glGetUniformLocation(program, intensityLocation.str().c_str()),
-            lightInfo.intensity
-        );
+void Material::setMultiDrawUniforms() const {
+    if (!multiDrawProgram) {
+        return;
+    }
 
-        glUniform1f(
-            glGetUniformLocation(program, attenuationLocation.str().c_str()),
-            lightInfo.attenuation
-        );
+    if (multiDrawProgram->claim(this) || multiDrawDirty) {
+        uploadUniforms(multiDrawUniforms);
+        multiDrawDirty = false;
+    }
+}
 
-        glUniform1f(
-            glGetUniformLocation(program, ambientCoefficientLocation.str().c_str()),
-            lightInfo.ambientCoefficient
-        );
+void Material::uploadUniforms(const UniformTable<Uniform>& table) const {
+    table.set(Uniform::modelViewMatrix, modelViewMatrix);
+    table.set(Uniform::normalMatrix, normalMatrix);
+    table.set(Uniform::color, color);
+    table.set(Uniform::shininess, shininess);
+    table.set(Uniform::specularCoefficient, specularCoefficient);
+    table.set(Uniform::emissiveColor, emissiveColor);
+    table.set(Uniform::emissiveStrength, emissiveStrength);
+    table.set(Uniform::emissiveEnabled, emissiveEnabled);
+    table.set(Uniform::blinnEnabled, blinnEnabled);
+}
 
-        glUniform1f(
-            glGetUniformLocation(program, enabledLocation.str().c_str()),
-            lightInfo.enabled ? 1.0f : 0.0f
-        );
+void Material::fillInstance(InstanceAttributes& instance) const {
+    instance.color = glm::vec4(color, specularCoefficient);
+    instance.emissive = glm::vec4(emissiveColor, emissiveStrength);
+    instance.parameters = glm::vec4(0.0f, 0.0f, shininess, emissiveEnabled ? 1.0f : 0.0f);
+}
 
-        glUniform1f(
-            glGetUniformLocation(program, coneAngleLocation.str().c_str()),
-            lightInfo.coneAngle
-        );
+void Material::setColor(glm::vec3 c) const {
+    color = c;
+    markDirty();
+}
 
-        glUniform3fv(
-            glGetUniformLocation(program, coneDirectionLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.coneDirection)
-        );
+void Material::setEmissiveColorAndStrength(glm::vec3 c, float strength) const {
+    emissiveColor = c;
+    emissiveStrength = strength;
+    markDirty();
+}
 
+void Material::setEmissiveColor(glm::vec3 c) const {
+    emissiveColor = c;
+    markDirty();
+}
 
-        lightIndex++;
-    }
+void Material::setEmissiveStrength(float strength) const {
+    emissiveStrength = strength;
+    markDirty();
+}
 
-    glUseProgram(0);
+void Material::toggleEmissive(bool value) const {
+    emissiveEnabled = value;
+    markDirty();
 }
 
-void Material::setModelMatrix(const glm::mat4& modelMatrix) const {
-    glUseProgram(program);
-    auto modelMatrixLocation = glGetUniformLocation(program, "modelMatrix");
-    glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    glUseProgram(0);
+void Material::toggleBlinnPhongShading(bool value) const {
+    blinnEnabled = value;
+    markDirty();
 }
 
-void Material::setProjectionAndViewMatrices(
-    const glm::mat4& projectionMatrix,
-    const glm::mat4& viewMatrix
-) const {
-    glUseProgram(program);
-    auto projectionMatrixLocation = glGetUniformLocation(program, "projectionMatrix");
-    auto viewMatrixLocation = glGetUniformLocation(program, "viewMatrix");
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-    glUseProgram(0);
+void Material::setShininess(float s) const {
+    shininess = s;
+    markDirty();
 }
 
-void Material::setMatrices(
-    const glm::mat4& projectionMatrix,
-    const glm::mat4& viewMatrix,
-    const glm::mat4& modelMatrix
-) const {
-    glUseProgram(program);
-    auto projectionMatrixLocation = glGetUniformLocation(program, "projectionMatrix");
-    auto viewMatrixLocation = glGetUniformLocation(program, "viewMatrix");
-    auto modelMatrixLocation = glGetUniformLocation(program, "modelMatrix");
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
-    glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-    glUseProgram(0);
+void Material::setModelViewMatrices(const glm::mat4& modelView, const glm::mat3& normal) const {
+    modelViewMatrix = modelView;
+    normalMatrix = normal;
+    markDirty();
 }
@@ -1,19 +1,41 @@
 #pragma once
 
+#include "gl/shaderProgram.hpp"
+#include "gl/uniformTable.hpp"
+#include "gl/vertexLayout.hpp"
+
 #include <GL/glew.h>
 
 #include <glm/glm.hpp>
+
 #include <memory>
 #include <vector>
 
 enum class Side { FRONT, BACK, BOTH };
 
-class Light;
+struct InstanceAttributes;
 
 class Material {
     public:
+        // Uniforms of the material shaders, resolved once per material in compile().
+        // Not every shader declares all of them.
+        enum class Uniform {
+            modelViewMatrix,
+            normalMatrix,
+            color,
+            shininess,
+            specularCoefficient,
+            emissiveColor,
+            emissiveStrength,
+            emissiveEnabled,
+            blinnEnabled,
+            roughness,
+            metalness,
+            count
+        };
+
         Material(glm::vec3 color = glm::vec3(1.0f, 0.0f, 0.0), float specularCoefficient = 0.5f, float shininess = 32.0f);
-        virtual ~Material();
+        virtual ~Material() = default;
 
         Material(Material&& other) = default;
         Material(const Material& other) = default;
@@ -23,12 +45,16 @@ class Material {
 
         virtual void create();
 
+        // The normal format of the mesh this material draws; compile() builds
+        // the programs for it. Must be set before create()
+        void setNormalFormat(VertexLayout::NormalFormat format) {
+            normalFormat = format;
+        }
+
         virtual void setColor(glm::vec3 color) const;
 
         virtual void setShininess(float shininess) const;
 
-        virtual void setLights(const std::vector<std::shared_ptr<Light>>& lights) const;
-
         virtual void setEmissiveColorAndStrength(glm::vec3 color, float strength) const;
         virtual void setEmissiveColor(glm::vec3 color) const;
         virtual void setEmissiveStrength(float strength) const;
@@ -36,28 +62,48 @@ class Material {
         virtual void toggleEmissive(bool value) const;
         virtual void toggleBlinnPhongShading(bool value) const;
 
-        virtual void setModelMatrix(const glm::mat4& modelMatrix) const;
+        // normal = transpose(inverse(mat3(modelView)))
+        virtual void setModelViewMatrices(const glm::mat4& modelView, const glm::mat3& normal) const;
 
         virtual void setMetalness(float metalness) const { (void)metalness; }
         virtual void setRoughness(float roughness) const { (void)roughness; }
 
-        virtual void setProjectionAndViewMatrices(
-            const glm::mat4& projectionMatrix,
-            const glm::mat4& viewMatrix
-        ) const;
+        // Setters only record values; this uploads them. Per-material values
+        // are sent if the (shared) program currently holds another material's
+        // values or if they changed. Camera and lights come from the
+        // FrameUniforms and LightBuffer uniform blocks.
+        // Expects the program to be in use.
+        virtual void setUniforms() const;
 
-        virtual void setMatrices(
-            const glm::mat4& projectionMatrix,
-            const glm::mat4& viewMatrix,
-            const glm::mat4& modelMatrix
-        ) const;
+        // Same as setUniforms(), for the instanced program. Only values that are
+        // not per instance (see fillInstance) are uploaded
+        void setInstancedUniforms() const;
 
-        virtual void setUniforms() const {}
+        // Same as setInstancedUniforms(), for the multi-draw program
+        void setMultiDrawUniforms() const;
 
-        bool compile(std::string vertexShader, std::string fragmentShader);
+        // Writes this material's per-instance values (everything but the matrices)
+        virtual void fillInstance(InstanceAttributes& instance) const;
+
+        // Programs are shared between materials with the same source (see ResourceCache).
+        // If instanced, the sources are also compiled with INSTANCED defined,
+        // and with MULTI_DRAW defined (see MultiDrawBatch); they must use
+        // ShaderUtils::MATERIAL_VERTEX_INPUTS and MATERIAL_FRAGMENT_INPUTS.
+        // All of them get OCTAHEDRAL_NORMALS defined for octahedral normals
+        bool compile(std::string vertexShader, std::string fragmentShader, bool instanced = false);
 
         GLuint getProgram() const {
-            return program;
+            return program ? program->get() : 0;
+        }
+
+        // nullptr if the material can't be drawn instanced
+        const std::shared_ptr<ShaderProgram>& getInstancedProgram() const {
+            return instancedProgram;
+        }
+
+        // nullptr if the material can't be drawn by a MultiDrawBatch
+        const std::shared_ptr<ShaderProgram>& getMultiDrawProgram() const {
+            return multiDrawProgram;
         }
 
         void setSide(Side s) {
@@ -79,12 +125,54 @@ class Material {
         float getShininess() const {
             return shininess;
         }
+
+        glm::vec3 getEmissiveColor() const {
+            return emissiveColor;
+        }
+
+        float getEmissiveStrength() const {
+            return emissiveStrength;
+        }
+
+        bool isEmissiveEnabled() const {
+            return emissiveEnabled;
+        }
+    protected:
+        // Uploads to either program's uniforms; expects that program to be in use
+        virtual void uploadUniforms(const UniformTable<Uniform>& table) const;
+
+        void markDirty() const {
+            dirty = true;
+            instancedDirty = true;
+            multiDrawDirty = true;
+        }
     private:
-        GLuint program = 0;
+        std::shared_ptr<ShaderProgram> program;
+        std::shared_ptr<ShaderProgram> instancedProgram;
+        std::shared_ptr<ShaderProgram> multiDrawProgram;
 
-        glm::vec3 color;
-        float specularCoefficient;
-        float shininess;
+        UniformTable<Uniform> uniforms;
+        UniformTable<Uniform> instancedUniforms;
+        UniformTable<Uniform> multiDrawUniforms;
+
+        // per-material values, uploaded lazily by setUniforms()
+        mutable glm::vec3 color;
+        mutable float specularCoefficient;
+        mutable float shininess;
+
+        mutable glm::vec3 emissiveColor;
+        mutable float emissiveStrength = 0.0f;
+        mutable bool emissiveEnabled = false;
+        mutable bool blinnEnabled = true;
+
+        mutable glm::mat4 modelViewMatrix = glm::mat4(1.0f);
+        mutable glm::mat3 normalMatrix = glm::mat3(1.0f);
+
+        mutable bool dirty = true;
+        mutable bool instancedDirty = true;
+        mutable bool multiDrawDirty = true;
 
         Side side = Side::FRONT;
+
+        VertexLayout::NormalFormat normalFormat = VertexLayout().normal;
 };
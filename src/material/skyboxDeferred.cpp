@@ -24,8 +24,7 @@ void SkyboxDeferredMaterial::create() {
         #version 330
         layout(location = 0) in vec3 position;
 
-        uniform mat4 projectionMatrix;
-        uniform mat4 viewMatrix;
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + R"(
 
         out vec3 vPosition;
         out vec4 vPositionEyespace;
@@ -72,21 +71,15 @@ void SkyboxDeferredMaterial::create() {
     GLuint shader = getProgram();
 
     glUseProgram(shader);
-    auto projectionMatrixLocation = glGetUniformLocation(shader, "projectionMatrix");
-    auto viewMatrixLocation = glGetUniformLocation(shader, "viewMatrix");
-    glUniformMatrix4fv(projectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0)));
     glUniform1i(glGetUniformLocation(shader, "cubemap"), 0);
     glUseProgram(0);
 }
 
 void SkyboxDeferredMaterial::setUniforms() const {
-    GLuint shader = getProgram();
-    glUseProgram(shader);
-    // bind the cubemap to texture slot 0 and update the uniform accordingly
-    glActiveTexture(0);
+    Material::setUniforms();
+
+    // bind the cubemap to texture slot 0, the sampler is bound to slot 0 in create()
+    glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
-    glUniform1i(glGetUniformLocation(shader, "cubemap"), 0);
-    glUseProgram(0);
 }
 
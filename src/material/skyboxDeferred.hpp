@@ -25,8 +25,6 @@ class SkyboxDeferredMaterial : public Material {
 
         void setShininess (float shininess) const override { (void)shininess; }
 
-        void setLights (const std::vector<std::shared_ptr<Light>>& lights) const override { (void)lights; }
-
         void setEmissiveColorAndStrength(glm::vec3 color, float strength) const override { (void) color; (void)strength; }
         void setEmissiveColor(glm::vec3 color) const override { (void)color; }
         void setEmissiveStrength(float strength) const override { (void)strength; }
@@ -34,7 +32,7 @@ class SkyboxDeferredMaterial : public Material {
         void toggleEmissive(bool value) const override { (void)value; }
         void toggleBlinnPhongShading(bool value) const override { (void)value; }
 
-        void setModelMatrix(const glm::mat4& modelMatrix) const override { (void)modelMatrix; }
+        void setModelViewMatrices(const glm::mat4& modelView, const glm::mat3& normal) const override { (void)modelView; (void)normal; }
 
         void setUniforms() const override;
 
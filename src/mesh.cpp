@@ -1,92 +1,227 @@
 #include "mesh.hpp"
 
+#include "geometry/indexedGeometry.hpp"
+#include "geometry/meshlets.hpp"
+#include "geometry/meshOptimization.hpp"
+#include "geometry/meshSimplification.hpp"
 #include "gl/glObject.hpp"
+#include "io/mappedFile.hpp"
+#include "io/meshCache.hpp"
+#include "io/objParser.hpp"
+#include "util/threadPool.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <chrono>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
 #include <iostream>
 
+namespace {
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
 Mesh::Mesh() { }
 
 /**
  * Reads a .obj file and populates this Mesh object.
- * Note: Assumes all "f" lines come last
- * TODO: UV Support
+ * If the binary mesh cache holds an up to date copy of the file (same content
+ * hash and vertex layout) it is uploaded straight from the mapped cache file.
+ * Otherwise the file is memory mapped and tokenized in place, in parallel for
+ * large files (see OBJParser), welded into unique vertices + an index buffer
+ * (see MeshIndexing), simplified into levels of detail (see
+ * MeshSimplification), reordered for the vertex cache, overdraw and vertex
+ * fetch (see MeshOptimization), split into meshlets if dense (see Meshlets)
+ * and written back to the cache.
  **/
-Mesh& Mesh::fromOBJ(std::string filename) {
-    std::ifstream ifs(filename);
-    if (!ifs) {
+Mesh& Mesh::fromOBJ(std::string filename, VertexLayout layout, HostCopy hostCopy) {
+    MappedFile file;
+    if (!file.open(filename)) {
         std::cout << "File Not Found: " << filename << "\n";
         return *this;
     }
 
-    std::vector<float> rawVertices;
-    std::vector<float> rawNormals;
-    // std::vector<float> rawUvs;
+    std::cout << "Reading Mesh File: " << filename << "\n";
 
-    std::vector<float> vertices;
-    std::vector<float> normals;
+    auto start = std::chrono::steady_clock::now();
 
-    std::string type;
-    std::string line;
+    auto sourceHash = MeshCache::hash(file.begin(), file.end());
+    auto cachePath = MeshCache::getPath(sourceHash, layout);
 
-    std::cout << "Reading Mesh File: " << filename << "\n";
+    bool cacheEnabled = MeshCache::isEnabled();
+
+    // The cache only holds packed data, so it can't provide host copies
+    if (cacheEnabled && hostCopy == HostCopy::release) {
+        MappedFile cacheFile;
+        MeshCache::Blob blob;
+
+        if (MeshCache::read(cachePath, sourceHash, file.size(), layout, cacheFile, blob)) {
+            vertexArrayObject = std::make_shared<GLObject>(
+                blob.vertices,
+                blob.vertexBytes,
+                blob.vertexCount,
+                blob.hasUvs,
+                blob.indices,
+                blob.indexCount,
+                blob.indexType,
+                layout
+            );
+
+            bounds.box.min = glm::vec3(blob.boundsMin[0], blob.boundsMin[1], blob.boundsMin[2]);
+            bounds.box.max = glm::vec3(blob.boundsMax[0], blob.boundsMax[1], blob.boundsMax[2]);
+            bounds.sphere.center = bounds.box.getCenter();
+            bounds.sphere.radius = blob.boundsRadius;
+
+            lods.assign(blob.lods.begin(), blob.lods.begin() + blob.lodCount);
+            meshlets.assign(blob.meshlets, blob.meshlets + blob.meshletCount);
+
+            std::cout << "Loaded " << blob.indexCount / 3 << " triangles from " << cachePath
+                << " in " << millisecondsSince(start) << "ms\n";
+
+            return *this;
+        }
+    }
+
+    OBJParser::Data data;
+    const char* error = nullptr;
+
+    if (!OBJParser::parse(file.begin(), file.end(), data, &error)) {
+        std::cout << "Error reading " << filename << ": " << error << "\n";
+        return *this;
+    }
+
+    auto elapsed = millisecondsSince(start) / 1000.0;
+    auto megabytes = static_cast<double>(file.size()) / (1024.0 * 1024.0);
+
+    std::cout << "Parsed " << data.positions.size() / 9 << " triangles in "
+        << elapsed * 1000.0 << "ms (" << (elapsed > 0.0 ? megabytes / elapsed : 0.0) << " MB/s, "
+        << ThreadPool::shared().getConcurrency() << " threads)\n";
+
+    auto corners = data.positions.size() / 3;
+
+    auto geometry = MeshIndexing::deduplicate(
+        std::move(data.positions),
+        std::move(data.normals),
+        std::move(data.uvs)
+    );
 
-    float x = 0.0f, y = 0.0f, z = 0.0f;
-
-    while (ifs >> type) {
-        if (type[0] == '#') {
-            // comment, ignore the whole line
-            getline(ifs, line);
-        } else if (type == "v") {
-            ifs >> x >> y >> z;
-            rawVertices.push_back(x);
-            rawVertices.push_back(y);
-            rawVertices.push_back(z);
-        } else if (type == "vt") {
-            // ifs >> x >> y;
-            // rawUvs.push_back(x);
-            // rawUvs.push_back(y);
-
-            // Skip uvs for now
-            getline(ifs, line);
-        } else if (type == "vn") {
-            ifs >> x >> y >> z;
-            rawNormals.push_back(x);
-            rawNormals.push_back(y);
-            rawNormals.push_back(z);
-        } else if (type == "f") {
-            for (uint8_t i = 0; i < 3; i++) {
-                ifs >> line;
-                auto s1 = line.find('/');
-                auto s2 = line.find('/', s1 + 1);
-
-                auto vtxIdx = std::stoi(line.substr(0, s1)) - 1;
-                // auto uvIdx = std::stoi(line.substr(s1 + 1, s2)) - 1;
-                auto nIdx = std::stoi(line.substr(s2 + 1)) - 1;
-
-                vertices.push_back(rawVertices[vtxIdx * 3 + 0]);
-                vertices.push_back(rawVertices[vtxIdx * 3 + 1]);
-                vertices.push_back(rawVertices[vtxIdx * 3 + 2]);
-
-                // uvs.push_back(rawUvs[uvIdx * 2 + 0]);
-                // uvs.push_back(rawUvs[uvIdx * 2 + 1]);
-
-                normals.push_back(rawNormals[nIdx * 3 + 0]);
-                normals.push_back(rawNormals[nIdx * 3 + 1]);
-                normals.push_back(rawNormals[nIdx * 3 + 2]);
-            }
+    bool hasUvs = !geometry.uvs.empty();
+    auto vertexCount = static_cast<uint32_t>(geometry.getVertexCount());
+
+    std::cout << "Welded " << corners << " corners into " << vertexCount << " unique vertices ("
+        << layout.getStride(hasUvs) << " bytes per vertex)\n";
+
+    bounds = Bounds::fromPositions(geometry.positions);
+
+    auto simplifyStart = std::chrono::steady_clock::now();
+
+    lods = MeshSimplification::buildLods(geometry, bounds.sphere.radius);
+
+    if (lods.size() > 1) {
+        std::cout << "Built " << lods.size() - 1 << " levels of detail down to " << lods.back().indexCount / 3
+            << " triangles in " << millisecondsSince(simplifyStart) << "ms\n";
+    }
+
+    // every level is reordered on its own; vertices follow the full detail order
+    auto before = MeshOptimization::analyzeVertexCache(geometry.indices.data(), lods.front().indexCount, vertexCount);
+
+    bool splitMeshlets = lods.front().indexCount / 3 >= Meshlets::MIN_TRIANGLES;
+
+    std::vector<uint32_t> clusters;
+    std::vector<uint32_t> meshletOffsets;
+
+    for (std::size_t level = 0; level < lods.size(); level++) {
+        const auto& lod = lods[level];
+        uint32_t* levelIndices = geometry.indices.data() + lod.firstIndex;
+        MeshOptimization::optimizeVertexCache(levelIndices, lod.indexCount, vertexCount, &clusters);
+
+        if (level == 0 && splitMeshlets) {
+            // meshlets are grown over the surface rather than cut from the
+            // cache order, so they stay compact, then ordered whole for overdraw
+            clusters = Meshlets::partition(levelIndices, lod.indexCount, geometry.positions);
+            MeshOptimization::optimizeOverdraw(levelIndices, lod.indexCount, geometry.positions, clusters, 0.0f, &meshletOffsets);
         } else {
-            // Unknown line. Skip it
-            getline(ifs, line);
+            MeshOptimization::optimizeOverdraw(levelIndices, lod.indexCount, geometry.positions, clusters);
         }
     }
 
-    ifs.close();
+    MeshOptimization::optimizeVertexFetch(geometry);
+    vertexCount = static_cast<uint32_t>(geometry.getVertexCount());
 
-    vertexArrayObject = std::make_shared<GLObject>(std::move(vertices), std::move(normals));
+    auto after = MeshOptimization::analyzeVertexCache(geometry.indices.data(), lods.front().indexCount, vertexCount);
+
+    std::cout << "Vertex cache (" << MeshOptimization::CACHE_SIZE << " entries): ACMR "
+        << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << "\n";
+
+    if (splitMeshlets) {
+        meshlets = Meshlets::build(geometry.indices.data(), lods.front().indexCount, geometry.positions, meshletOffsets);
+
+        // how tight the spheres they are culled by are
+        float radiusSum = 0.0f;
+        float maxRadius = 0.0f;
+        for (const auto& meshlet : meshlets) {
+            radiusSum += meshlet.radius;
+            maxRadius = std::max(maxRadius, meshlet.radius);
+        }
+
+        std::cout << "Split into " << meshlets.size() << " meshlets of up to " << Meshlets::MAX_VERTICES
+            << " vertices / " << Meshlets::MAX_TRIANGLES << " triangles, radius "
+            << radiusSum / static_cast<float>(meshlets.size()) / bounds.sphere.radius << " of the mesh's on average (at most "
+            << maxRadius / bounds.sphere.radius << ")\n";
+    }
+
+    auto packedVertices = layout.pack(geometry.positions, geometry.normals, geometry.uvs);
+    auto indexType = GLObject::selectIndexType(vertexCount);
+    auto packedIndices = GLObject::packIndices(geometry.indices, indexType);
+
+    MeshCache::Blob blob;
+    blob.layout = layout;
+    blob.hasUvs = hasUvs;
+    blob.vertexCount = vertexCount;
+    blob.indexCount = static_cast<uint32_t>(geometry.indices.size());
+    blob.indexType = indexType;
+    blob.vertices = packedVertices.data();
+    blob.vertexBytes = packedVertices.size();
+    blob.indices = packedIndices.data();
+    blob.indexBytes = packedIndices.size();
+
+    std::copy_n(&bounds.box.min[0], 3, blob.boundsMin);
+    std::copy_n(&bounds.box.max[0], 3, blob.boundsMax);
+    blob.boundsRadius = bounds.sphere.radius;
+
+    blob.lodCount = static_cast<uint32_t>(lods.size());
+    std::copy(lods.begin(), lods.end(), blob.lods.begin());
+
+    blob.meshlets = meshlets.data();
+    blob.meshletCount = meshlets.size();
+
+    if (cacheEnabled && !MeshCache::write(cachePath, sourceHash, file.size(), blob)) {
+        std::cout << "Could not write mesh cache file " << cachePath << "\n";
+    }
+
+    if (hostCopy == HostCopy::keep) {
+        vertexArrayObject = std::make_shared<GLObject>(
+            std::move(geometry.positions),
+            std::move(geometry.normals),
+            std::move(geometry.uvs),
+            std::move(geometry.indices),
+            layout,
+            hostCopy
+        );
+    } else {
+        vertexArrayObject = std::make_shared<GLObject>(
+            blob.vertices,
+            blob.vertexBytes,
+            blob.vertexCount,
+            blob.hasUvs,
+            blob.indices,
+            blob.indexCount,
+            blob.indexType,
+            layout
+        );
+    }
 
     return *this;
 }
@@ -1,9 +1,14 @@
 #pragma once
 
+#include "geometry/bounds.hpp"
+#include "geometry/meshlets.hpp"
+#include "geometry/meshSimplification.hpp"
 #include "gl/glObject.hpp"
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 class Mesh {
     public:
@@ -16,16 +21,91 @@ class Mesh {
         Mesh& operator=(const Mesh& other) = default;
         Mesh& operator=(Mesh&& other) = default;
 
-        Mesh& fromOBJ(std::string filename);
+        // layout/hostCopy control how the mesh is stored on the GPU (see GLObject)
+        Mesh& fromOBJ(
+            std::string filename,
+            VertexLayout layout = VertexLayout(),
+            HostCopy hostCopy = HostCopy::release
+        );
 
+        // Object space bounds, computed at load time (or read from the mesh cache)
+        const Bounds& getBounds() const {
+            return bounds;
+        }
+
+        const GLObject& getGLObject() const {
+            return *vertexArrayObject;
+        }
+
+        // The layout the mesh was stored with; the default one if it failed to load
+        VertexLayout getLayout() const {
+            return vertexArrayObject ? vertexArrayObject->getLayout() : VertexLayout();
+        }
+
+        // Shared with the other meshes of its vertex format (see
+        // GeometryArena); draw with getBaseVertex and getLodOffset
         GLuint getVertexArrayObject() const {
             return vertexArrayObject->getVertexArrayObject();
         }
 
+        GLint getBaseVertex() const {
+            return vertexArrayObject->getBaseVertex();
+        }
+
+        // See GLObject::createVertexArray
+        GLuint createVertexArray() const {
+            return vertexArrayObject->createVertexArray();
+        }
+
         uint32_t getVertexCount() const {
             return vertexArrayObject->getVertexCount();
         }
+
+        // Indices of the full detail level
+        uint32_t getIndexCount() const {
+            return lods.empty() ? 0 : lods.front().indexCount;
+        }
+
+        GLenum getIndexType() const {
+            return vertexArrayObject->getIndexType();
+        }
+
+        // Levels of detail, full detail first; built at import time (see
+        // MeshSimplification). Small meshes only have the one level
+        std::size_t getLodCount() const {
+            return lods.size();
+        }
+
+        // Levels past the last one give the last (coarsest) one
+        const LodLevel& getLod(std::size_t level) const {
+            return lods[std::min(level, lods.size() - 1)];
+        }
+
+        const std::vector<LodLevel>& getLods() const {
+            return lods;
+        }
+
+        // Byte offset of a level's first index in the shared index buffer,
+        // for glDrawElementsBaseVertex
+        std::size_t getLodOffset(std::size_t level) const {
+            return vertexArrayObject->getIndexOffset() + getLod(level).firstIndex * getIndexSize();
+        }
+
+        // Bytes per index
+        std::size_t getIndexSize() const {
+            return getIndexType() == GL_UNSIGNED_SHORT ? 2 : 4;
+        }
+
+        // Clusters of the full detail level, for culling parts of the mesh;
+        // empty for meshes under Meshlets::MIN_TRIANGLES
+        const std::vector<Meshlet>& getMeshlets() const {
+            return meshlets;
+        }
     private:
         // should be able to share a GLObject between different mesh entities
         std::shared_ptr<GLObject> vertexArrayObject = nullptr;
+
+        Bounds bounds;
+        std::vector<LodLevel> lods;
+        std::vector<Meshlet> meshlets;
 };
@@ -1,5 +1,6 @@
 #include "model.hpp"
 
+#include "gl/glStats.hpp"
 #include "material/material.hpp"
 #include "mesh.hpp"
 
@@ -20,6 +21,7 @@ Model::Model(std::shared_ptr<Mesh> m, std::unique_ptr<Material>&& mat) :
     // of passing mesh and material by rvalue ref in the first place
     mesh(m)
 {
+    mat->setNormalFormat(mesh->getLayout().normal);
     mat->create();
     materials.emplace(MaterialType::standard, std::move(mat));
 }
@@ -30,7 +32,10 @@ Model::Model(Model&& other) {
     rotation = std::move(other.rotation);
     scale = std::move(other.scale);
     position = std::move(other.position);
+    modelMatrix = std::move(other.modelMatrix);
+    worldBounds = std::move(other.worldBounds);
     dirty = std::move(other.dirty);
+    version = std::move(other.version);
 }
 
 Model& Model::operator=(Model&& other) {
@@ -39,115 +44,155 @@ Model& Model::operator=(Model&& other) {
     rotation = std::move(other.rotation);
     scale = std::move(other.scale);
     position = std::move(other.position);
+    modelMatrix = std::move(other.modelMatrix);
+    worldBounds = std::move(other.worldBounds);
     dirty = std::move(other.dirty);
+    version = std::move(other.version);
 
     return *this;
 }
 
 void Model::addMaterial(MaterialType type, std::unique_ptr<Material>&& mat) {
+    mat->setNormalFormat(mesh->getLayout().normal);
     mat->create();
     materials.emplace(type, std::move(mat));
+    version++;
 }
 
 void Model::setColor(glm::vec3 color) {
     for (auto& m : materials) {
         m.second->setColor(color);
     }
+
+    version++;
 }
 
 void Model::setMetalness(float metalness) {
     for (auto& m : materials) {
         m.second->setMetalness(metalness);
     }
+
+    version++;
 }
 
 void Model::setRoughness(float roughness) {
     for (auto& m : materials) {
         m.second->setRoughness(roughness);
     }
+
+    version++;
 }
 
 void Model::toggleEmissive(bool value) {
     for (auto& m : materials) {
         m.second->toggleEmissive(value);
     }
+
+    version++;
 }
 
 void Model::toggleBlinnPhongShading(bool value) {
     for (auto& m : materials) {
         m.second->toggleBlinnPhongShading(value);
     }
+
+    version++;
 }
 
 void Model::setEmissiveColor(glm::vec3 color) {
     for (auto& m : materials) {
         m.second->setEmissiveColor(color);
     }
+
+    version++;
 }
 
 void Model::setEmissiveStrength(float strength) {
     for (auto& m : materials) {
         m.second->setEmissiveStrength(strength);
     }
+
+    version++;
 }
 
 void Model::setEmissiveColorAndStrength(glm::vec3 color, float strength) {
     for (auto& m : materials) {
         m.second->setEmissiveColorAndStrength(color, strength);
     }
-}
 
-void Model::setLights(const std::vector<std::shared_ptr<Light>>& lights) {
-    for (auto& m : materials) {
-        m.second->setLights(lights);
-    }
-}
-
-void Model::setProjectionAndViewMatrices(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix) {
-    for (auto& m : materials) {
-        m.second->setProjectionAndViewMatrices(projectionMatrix, viewMatrix);
-    }
+    version++;
 }
 
-void Model::applyModelMatrix() {
+bool Model::applyModelMatrix() {
     if (!dirty) {
-        return;
+        return false;
     }
 
-    glm::mat4 modelMatrix(1.0f);
+    modelMatrix = glm::mat4(1.0f);
     modelMatrix = glm::translate(modelMatrix, position);
     modelMatrix = glm::scale(modelMatrix, scale);
     modelMatrix = modelMatrix * glm::eulerAngleYXZ(rotation.y, rotation.x, rotation.z);
 
-    for (auto& m : materials) {
-        m.second->setModelMatrix(modelMatrix);
-    }
+    worldBounds = mesh->getBounds().transform(modelMatrix);
 
     dirty = false;
+    version++;
+
+    return true;
+}
+
+const Material* Model::getMaterial(MaterialType type) const {
+    auto found = materials.find(type);
+    if (found == materials.end()) {
+        return nullptr;
+    }
+
+    return found->second.get();
+}
+
+void Model::setModelViewMatrices(const glm::mat4& modelView, const glm::mat3& normal) {
+    for (auto& m : materials) {
+        m.second->setModelViewMatrices(modelView, normal);
+    }
 }
 
 void Model::draw(MaterialType type) const {
-    if (materials.count(type) == 0) {
+    auto found = materials.find(type);
+    if (found == materials.end()) {
         return;
     }
 
-    materials.at(type)->setUniforms();
-    glUseProgram(materials.at(type)->getProgram());
+    const Material& material = *found->second;
 
-    auto side = materials.at(type)->getSide();
+    // programs are shared, so uniforms can only be uploaded once ours is bound
+    glUseProgram(material.getProgram());
+    GLStats::frame().programBinds++;
+    material.setUniforms();
 
     // TODO: Support both sides
-    if (side == Side::BACK) {
+    if (material.getSide() == Side::BACK) {
         glCullFace(GL_FRONT);
     } else {
         glCullFace(GL_BACK);
     }
 
+    const auto& lod = mesh->getLod(lodLevel);
+
     glBindVertexArray(mesh->getVertexArrayObject());
-    glDrawArrays(GL_TRIANGLES, 0, mesh->getVertexCount());
+    glDrawElementsBaseVertex(
+        GL_TRIANGLES,
+        static_cast<GLsizei>(lod.indexCount),
+        mesh->getIndexType(),
+        reinterpret_cast<const void*>(mesh->getLodOffset(lodLevel)),
+        mesh->getBaseVertex()
+    );
 
     // set back to BACK
     glCullFace(GL_BACK);
 
-    glUseProgram(0);
+    GLStats::Counters& stats = GLStats::frame();
+    stats.vertexArrayBinds++;
+    stats.cullFaceChanges += 2;
+    stats.drawCalls++;
+    stats.triangles += lod.indexCount / 3;
 }
@@ -1,16 +1,19 @@
 #pragma once
 
+#include "geometry/bounds.hpp"
+
 #include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
 // Forward declare dependencies to reduce compilation-unit dependencies
-class Light;
 class Material;
 class Mesh;
 
-enum class MaterialType {
+enum class MaterialType : int {
     standard,
     deferred,
     deferred_pbr
@@ -44,10 +47,21 @@ class Model {
         void toggleEmissive(bool value);
         void toggleBlinnPhongShading(bool value);
 
-        void setLights(const std::vector<std::shared_ptr<Light>>& lights);
-        void setProjectionAndViewMatrices(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix);
         void draw(MaterialType type) const;
 
+        // Material of the given type, nullptr if the model has none
+        const Material* getMaterial(MaterialType type) const;
+
+        const std::shared_ptr<Mesh>& getMesh() const {
+            return mesh;
+        }
+
+        // Bumped whenever the model matrix or (through this model) a material
+        // changes, so instance data built from it can be refreshed lazily
+        uint64_t getVersion() const {
+            return version;
+        }
+
         void setPosition(glm::vec3 p) {
             position = p;
             dirty = true;
@@ -68,7 +82,30 @@ class Model {
             dirty = true;
         }
 
-        void applyModelMatrix();
+        // Recomputes the model matrix if the transform changed; returns true if it did
+        bool applyModelMatrix();
+
+        const glm::mat4& getModelMatrix() const {
+            return modelMatrix;
+        }
+
+        // The mesh bounds in world space, updated by applyModelMatrix
+        const Bounds& getWorldBounds() const {
+            return worldBounds;
+        }
+
+        // Mesh level of detail to draw; chosen by the renderer from the
+        // model's size on screen
+        std::size_t getLodLevel() const {
+            return lodLevel;
+        }
+
+        void setLodLevel(std::size_t level) {
+            lodLevel = level;
+        }
+
+        // Computed by the renderer for all models at once (see MatrixBatch)
+        void setModelViewMatrices(const glm::mat4& modelView, const glm::mat3& normal);
 
         void addMaterial(MaterialType type, std::unique_ptr<Material>&& mat);
     private:
@@ -76,8 +113,15 @@ class Model {
         glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
         glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 
+        glm::mat4 modelMatrix = glm::mat4(1.0f);
+        Bounds worldBounds;
+
         bool dirty = true;
 
+        uint64_t version = 0;
+
+        std::size_t lodLevel = 0;
+
         // Meshes can be shared between models
         std::shared_ptr<Mesh> mesh;
         // Materials must be unique (for now?)
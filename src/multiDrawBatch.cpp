@@ -0,0 +1,411 @@
+#include "multiDrawBatch.hpp"
+
+#include "gl/geometryArena.hpp"
+#include "gl/glStats.hpp"
+#include "instancedBatch.hpp"
+#include "material/material.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "renderQueue.hpp"
+#include "util/matrixBatch.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <tuple>
+
+namespace {
+    // level of an entry drawn as its cluster ranges
+    const std::size_t CLUSTERED = std::numeric_limits<std::size_t>::max();
+
+    GLenum cullFace(const Material& material) {
+        return material.getSide() == Side::BACK ? GL_FRONT : GL_BACK;
+    }
+
+    std::size_t getIndexSize(GLenum indexType) {
+        return indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+    }
+
+    const void* offset(std::size_t bytes) {
+        return reinterpret_cast<const void*>(bytes);
+    }
+}
+
+MultiDrawBatch::~MultiDrawBatch() {
+    for (auto& arena : arenas) {
+        glDeleteVertexArrays(1, &arena.vertexArray);
+    }
+
+    for (auto& entry : records) {
+        glDeleteTextures(1, &entry.second.texture);
+        glDeleteBuffers(1, &entry.second.buffer);
+    }
+
+    glDeleteTextures(1, &drawTexture);
+    glDeleteBuffers(1, &drawBuffer);
+    glDeleteBuffers(1, &drawIdBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+}
+
+void MultiDrawBatch::setModels(const std::vector<std::shared_ptr<Model>>& newModels) {
+    models = newModels;
+
+    // records follow the model order
+    for (auto& entry : records) {
+        entry.second.versions.clear();
+    }
+}
+
+void MultiDrawBatch::initialize() {
+    indirect = GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+
+    glGenBuffers(1, &drawIdBuffer);
+    glGenBuffers(1, &drawBuffer);
+    glGenTextures(1, &drawTexture);
+
+    if (indirect) {
+        glGenBuffers(1, &commandBuffer);
+    }
+
+    std::cout << "Multi-draw submission: "
+        << (indirect ? "glMultiDrawElementsIndirect" : "glDrawElementsInstancedBaseVertex per mesh") << "\n";
+
+    initialized = true;
+}
+
+uint32_t MultiDrawBatch::getArena(uint32_t format, GLenum indexType) {
+    for (std::size_t a = 0; a < arenas.size(); a++) {
+        if (arenas[a].format == format && arenas[a].indexType == indexType) {
+            return static_cast<uint32_t>(a);
+        }
+    }
+
+    Arena arena;
+    arena.format = format;
+    arena.indexType = indexType;
+
+    // the format's buffers never change names, so the VAO stays valid
+    arena.vertexArray = GeometryArena::shared().createVertexArray(format);
+
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glEnableVertexAttribArray(DRAW_ID_LOCATION);
+    glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, nullptr);
+    glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    arenas.push_back(arena);
+
+    return static_cast<uint32_t>(arenas.size() - 1);
+}
+
+void MultiDrawBatch::updateRecords(MaterialType type, Records& target) {
+    changed.clear();
+    modelMatrices.clear();
+
+    target.versions.resize(models.size(), std::numeric_limits<uint64_t>::max());
+    target.texels.resize(models.size() * RECORD_TEXELS);
+
+    for (std::size_t i = 0; i < models.size(); i++) {
+        if (models[i]->getMaterial(type) != nullptr && models[i]->getVersion() != target.versions[i]) {
+            target.versions[i] = models[i]->getVersion();
+            changed.push_back(i);
+            modelMatrices.push_back(models[i]->getModelMatrix());
+        }
+    }
+
+    if (changed.empty()) {
+        return;
+    }
+
+    worldMatrices.resize(changed.size());
+    normalMatrices.resize(changed.size());
+
+    // identity view: world space normal matrices, like the instance data
+    MatrixBatch::computeModelView(
+        glm::mat4(1.0f),
+        modelMatrices.data(),
+        worldMatrices.data(),
+        normalMatrices.data(),
+        changed.size()
+    );
+
+    for (std::size_t k = 0; k < changed.size(); k++) {
+        InstanceAttributes instance;
+        models[changed[k]]->getMaterial(type)->fillInstance(instance);
+
+        glm::vec4* texels = &target.texels[changed[k] * RECORD_TEXELS];
+
+        for (int column = 0; column < 4; column++) {
+            texels[column] = modelMatrices[k][column];
+        }
+
+        for (int column = 0; column < 3; column++) {
+            texels[4 + column] = glm::vec4(normalMatrices[k][column], 0.0f);
+        }
+
+        texels[7] = instance.color;
+        texels[8] = instance.emissive;
+        texels[9] = instance.parameters;
+    }
+
+    if (target.buffer == 0) {
+        glGenBuffers(1, &target.buffer);
+        glGenTextures(1, &target.texture);
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, target.buffer);
+
+    if (target.capacity < models.size()) {
+        glBufferData(GL_TEXTURE_BUFFER, target.texels.size() * sizeof(glm::vec4), target.texels.data(), GL_DYNAMIC_DRAW);
+        target.capacity = models.size();
+
+        glBindTexture(GL_TEXTURE_BUFFER, target.texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, target.buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    } else {
+        // changed is sorted, upload the span of it
+        std::size_t first = changed.front() * RECORD_TEXELS;
+        std::size_t end = (changed.back() + 1) * RECORD_TEXELS;
+
+        glBufferSubData(
+            GL_TEXTURE_BUFFER,
+            first * sizeof(glm::vec4),
+            (end - first) * sizeof(glm::vec4),
+            &target.texels[first]
+        );
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void MultiDrawBatch::reserveDraws(std::size_t count) {
+    if (count <= drawCapacity) {
+        return;
+    }
+
+    drawCapacity = std::max(count, 2 * drawCapacity);
+
+    std::vector<uint32_t> drawIds(drawCapacity);
+    std::iota(drawIds.begin(), drawIds.end(), 0);
+
+    // the arena VAOs refer to the buffer, not its storage
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(uint32_t), drawIds.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, drawBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, drawCapacity * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, drawBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+const MultiDrawBatch::Locations& MultiDrawBatch::getLocations(GLuint program) {
+    auto found = locations.find(program);
+    if (found != locations.end()) {
+        return found->second;
+    }
+
+    // expects the program to be in use; the samplers never change
+    Locations& result = locations[program];
+    result.firstDraw = glGetUniformLocation(program, "firstDraw");
+    glUniform1i(glGetUniformLocation(program, "drawRecords"), RECORD_UNIT);
+    glUniform1i(glGetUniformLocation(program, "drawModels"), DRAW_UNIT);
+
+    GLStats::frame().uniformLookups += 3;
+
+    return result;
+}
+
+void MultiDrawBatch::draw(MaterialType type, uint8_t* visible, const MultiDraw* clusters) {
+    if (!initialized) {
+        initialize();
+    }
+
+    auto& typeRecords = records[type];
+    updateRecords(type, typeRecords);
+
+    entries.clear();
+
+    for (std::size_t i = 0; i < models.size(); i++) {
+        if (!visible[i]) {
+            continue;
+        }
+
+        const auto& model = *models[i];
+        auto material = model.getMaterial(type);
+
+        if (material == nullptr || !material->getMultiDrawProgram()) {
+            continue;
+        }
+
+        const auto& mesh = *model.getMesh();
+        bool clustered = clusters != nullptr && !clusters[i].empty();
+
+        Entry entry;
+        entry.program = material->getMultiDrawProgram()->get();
+        entry.arena = getArena(mesh.getGLObject().getFormat(), mesh.getIndexType());
+        entry.cullFace = cullFace(*material);
+        entry.mesh = &mesh;
+        entry.firstIndex = static_cast<GLuint>(mesh.getLodOffset(0) / mesh.getIndexSize());
+        entry.level = clustered ? CLUSTERED : std::min(model.getLodLevel(), mesh.getLodCount() - 1);
+        entry.model = static_cast<uint32_t>(i);
+        entry.material = material;
+
+        entries.push_back(entry);
+        visible[i] = 0;
+    }
+
+    if (entries.empty()) {
+        return;
+    }
+
+    // passes, then meshes and levels within them
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return std::tie(a.program, a.arena, a.cullFace, a.firstIndex, a.level, a.model) <
+            std::tie(b.program, b.arena, b.cullFace, b.firstIndex, b.level, b.model);
+    });
+
+    drawList.clear();
+    commands.clear();
+    passes.clear();
+
+    for (std::size_t e = 0; e < entries.size(); e++) {
+        const auto& entry = entries[e];
+        const auto* previous = e > 0 ? &entries[e - 1] : nullptr;
+
+        bool samePass = previous != nullptr &&
+            previous->program == entry.program &&
+            previous->arena == entry.arena &&
+            previous->cullFace == entry.cullFace;
+
+        if (!samePass) {
+            passes.push_back({ entry.material, entry.program, entry.arena, entry.cullFace, commands.size(), 0 });
+        }
+
+        auto indexSize = entry.mesh->getIndexSize();
+        auto baseVertex = entry.mesh->getBaseVertex();
+
+        if (entry.level == CLUSTERED) {
+            const auto& ranges = clusters[entry.model];
+
+            for (std::size_t r = 0; r < ranges.counts.size(); r++) {
+                commands.push_back({
+                    static_cast<GLuint>(ranges.counts[r]),
+                    1,
+                    static_cast<GLuint>(reinterpret_cast<std::size_t>(ranges.offsets[r]) / indexSize),
+                    baseVertex,
+                    static_cast<GLuint>(drawList.size())
+                });
+                drawList.push_back(entry.model);
+            }
+        } else if (samePass && previous->mesh == entry.mesh && previous->level == entry.level) {
+            // another instance of the last command
+            commands.back().instanceCount++;
+            drawList.push_back(entry.model);
+        } else {
+            commands.push_back({
+                entry.mesh->getLod(entry.level).indexCount,
+                1,
+                static_cast<GLuint>(entry.mesh->getLodOffset(entry.level) / indexSize),
+                baseVertex,
+                static_cast<GLuint>(drawList.size())
+            });
+            drawList.push_back(entry.model);
+        }
+
+        passes.back().commandCount = commands.size() - passes.back().firstCommand;
+    }
+
+    reserveDraws(drawList.size());
+
+    glBindBuffer(GL_TEXTURE_BUFFER, drawBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, drawList.size() * sizeof(uint32_t), drawList.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    if (indirect) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+        if (commandCapacity < commands.size()) {
+            commandCapacity = std::max(commands.size(), 2 * commandCapacity);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity * sizeof(Command), nullptr, GL_STREAM_DRAW);
+        }
+
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(Command), commands.data());
+    }
+
+    glActiveTexture(GL_TEXTURE0 + RECORD_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, typeRecords.texture);
+    glActiveTexture(GL_TEXTURE0 + DRAW_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, drawTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLStats::Counters& stats = GLStats::frame();
+    GLenum currentCullFace = GL_BACK;
+
+    for (const auto& pass : passes) {
+        glUseProgram(pass.program);
+        stats.programBinds++;
+
+        pass.material->setMultiDrawUniforms();
+        const auto& location = getLocations(pass.program);
+
+        const auto& arena = arenas[pass.arena];
+        glBindVertexArray(arena.vertexArray);
+        stats.vertexArrayBinds++;
+
+        if (pass.cullFace != currentCullFace) {
+            currentCullFace = pass.cullFace;
+            glCullFace(currentCullFace);
+            stats.cullFaceChanges++;
+        }
+
+        if (indirect) {
+            // the base instance offsets the draw ids
+            glUniform1i(location.firstDraw, 0);
+            stats.uniformUploads++;
+
+            glMultiDrawElementsIndirect(
+                GL_TRIANGLES,
+                arena.indexType,
+                offset(pass.firstCommand * sizeof(Command)),
+                static_cast<GLsizei>(pass.commandCount),
+                0
+            );
+            stats.drawCalls++;
+        }
+
+        for (std::size_t c = pass.firstCommand; c < pass.firstCommand + pass.commandCount; c++) {
+            const auto& command = commands[c];
+
+            if (!indirect) {
+                glUniform1i(location.firstDraw, static_cast<GLint>(command.baseInstance));
+                glDrawElementsInstancedBaseVertex(
+                    GL_TRIANGLES,
+                    static_cast<GLsizei>(command.count),
+                    arena.indexType,
+                    offset(command.firstIndex * getIndexSize(arena.indexType)),
+                    static_cast<GLsizei>(command.instanceCount),
+                    command.baseVertex
+                );
+                stats.uniformUploads++;
+                stats.drawCalls++;
+            }
+
+            stats.triangles += static_cast<std::size_t>(command.count / 3) * command.instanceCount;
+        }
+    }
+
+    if (currentCullFace != GL_BACK) {
+        glCullFace(GL_BACK);
+    }
+
+    if (indirect) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+}
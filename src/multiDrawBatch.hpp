@@ -0,0 +1,167 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class Material;
+class Mesh;
+class Model;
+
+struct MultiDraw;
+
+enum class MaterialType : int;
+
+/**
+ * Draws any number of models, whatever their meshes, with a few multi-draw
+ * calls: one per vertex format, program and cull side.
+ *
+ * The meshes already share one vertex and index buffer per vertex format
+ * (see GeometryArena); on top of those, every format and index type gets an
+ * arena VAO with the draw id attribute, so draws only differ in their index
+ * ranges and base vertices. Per model data (world matrices and the material values of
+ * fillInstance) is kept in a texture buffer and only refreshed for models
+ * that changed. Every frame the visible models are grouped into one command
+ * per mesh range, and only the model of every draw is uploaded.
+ *
+ * With ARB_multi_draw_indirect (and ARB_base_instance) the commands go to
+ * glMultiDrawElementsIndirect. Otherwise every command is one
+ * glDrawElementsInstancedBaseVertex: GL 3.3's glMultiDrawElements can't tell
+ * the shader which draw it is in.
+ **/
+class MultiDrawBatch {
+    public:
+        // Instanced attribute with the draw index (0, 1, 2, ...), offset by
+        // the base instance; see ShaderUtils::MATERIAL_VERTEX_INPUTS
+        static const GLuint DRAW_ID_LOCATION = 3;
+        // vec4 texels per model record: model matrix (4 columns), normal
+        // matrix (3), color, emissive, parameters (see InstanceAttributes)
+        static const std::size_t RECORD_TEXELS = 10;
+        // texture units the buffers are bound to while drawing
+        static const GLint RECORD_UNIT = 14;
+        static const GLint DRAW_UNIT = 15;
+
+        MultiDrawBatch() = default;
+        ~MultiDrawBatch();
+
+        MultiDrawBatch(MultiDrawBatch&& other) = delete;
+        MultiDrawBatch& operator=(MultiDrawBatch&& other) = delete;
+
+        MultiDrawBatch(const MultiDrawBatch& other) = delete;
+        MultiDrawBatch& operator=(const MultiDrawBatch& other) = delete;
+
+        // The models to draw from (indices of visible and clusters refer to
+        // them)
+        void setModels(const std::vector<std::shared_ptr<Model>>& models);
+
+        // Draws the models marked in visible whose material of type has a
+        // multi-draw program, and unmarks them; the rest is left to the
+        // caller. clusters (optional, like visible) replace the full detail
+        // range of their models, see InstancedBatch::enqueue.
+        // Expects GL_CULL_FACE to be GL_BACK and leaves it that way
+        void draw(MaterialType type, uint8_t* visible, const MultiDraw* clusters);
+
+        // Whether draws go through glMultiDrawElementsIndirect; known after
+        // the first draw
+        bool isIndirect() const {
+            return indirect;
+        }
+    private:
+        // Layout of glMultiDrawElementsIndirect's commands
+        struct Command {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        };
+
+        // VAO over a GeometryArena format, for one index type
+        struct Arena {
+            uint32_t format = 0;
+            GLenum indexType = GL_UNSIGNED_INT;
+            GLuint vertexArray = 0;
+        };
+
+        // per material type
+        struct Records {
+            GLuint buffer = 0;
+            GLuint texture = 0;
+            std::size_t capacity = 0;
+
+            std::vector<glm::vec4> texels;
+            // model versions the records were built from
+            std::vector<uint64_t> versions;
+        };
+
+        // one visible model, sorted into passes and commands
+        struct Entry {
+            GLuint program;
+            uint32_t arena;
+            GLenum cullFace;
+            const Mesh* mesh;
+            // of the mesh in the index buffer, orders meshes within an arena
+            GLuint firstIndex;
+            // level of detail, or CLUSTERED
+            std::size_t level;
+            uint32_t model;
+            const Material* material;
+        };
+
+        // commands drawn with the same program, arena and cull side
+        struct Pass {
+            const Material* material;
+            GLuint program;
+            uint32_t arena;
+            GLenum cullFace;
+            std::size_t firstCommand;
+            std::size_t commandCount;
+        };
+
+        // locations of a multi-draw program's own uniforms
+        struct Locations {
+            GLint firstDraw = -1;
+        };
+
+        std::vector<std::shared_ptr<Model>> models;
+
+        std::vector<Arena> arenas;
+
+        std::unordered_map<MaterialType, Records> records;
+        std::unordered_map<GLuint, Locations> locations;
+
+        bool initialized = false;
+        bool indirect = false;
+
+        // 0, 1, 2, ... read by DRAW_ID_LOCATION
+        GLuint drawIdBuffer = 0;
+        // model of every draw, as a texture buffer
+        GLuint drawBuffer = 0;
+        GLuint drawTexture = 0;
+        std::size_t drawCapacity = 0;
+
+        GLuint commandBuffer = 0;
+        std::size_t commandCapacity = 0;
+
+        // scratch space for draw(), kept to avoid per-frame allocations
+        std::vector<Entry> entries;
+        std::vector<uint32_t> drawList;
+        std::vector<Command> commands;
+        std::vector<Pass> passes;
+        std::vector<std::size_t> changed;
+        std::vector<glm::mat4> modelMatrices;
+        std::vector<glm::mat4> worldMatrices;
+        std::vector<glm::mat3> normalMatrices;
+
+        void initialize();
+        uint32_t getArena(uint32_t format, GLenum indexType);
+        void updateRecords(MaterialType type, Records& target);
+        void reserveDraws(std::size_t count);
+        const Locations& getLocations(GLuint program);
+};
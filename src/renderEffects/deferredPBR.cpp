@@ -1,122 +1,115 @@
 #include "deferredPBR.hpp"
 
+#include "frameUniforms.hpp"
 #include "gl/shaderUtils.hpp"
-#include "light/light.hpp"
+#include "light/clusteredLights.hpp"
+#include "light/lightBuffer.hpp"
+#include "renderEffects/lightVolumes.hpp"
 
 #include <array>
+#include <cstddef>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <string>
-#include <sstream>
 
-DeferredPBREffect::DeferredPBREffect(int w, int h) :
-    width(w), height(h)
-{
-}
-
-void DeferredPBREffect::initialize() {
-    // initialize the framebuffer for the render target
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-    /** Position Texture **/
-
-    // initialize the texture to bind to the buffer
-    glGenTextures(1, &positionTexture);
-    glBindTexture(GL_TEXTURE_2D, positionTexture);
-
-    // floating point texture, RGB for position, A for depth
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    // attach the texture to the framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, positionTexture, 0);
+namespace {
+    // Creates a nearest filtered texture and attaches it to the bound framebuffer
+    GLuint createTarget(GLenum internalFormat, GLenum format, GLenum type, GLenum attachment, int width, int height) {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
 
-    /** Normal Texture **/
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
 
-    glGenTextures(1, &normalTexture);
-    glBindTexture(GL_TEXTURE_2D, normalTexture);
-
-    // floating point texture, RGB for position, A for depth
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    // attach the texture to the framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
-
-    /** Albedo Texture **/
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 
-    glGenTextures(1, &albedoTexture);
-    glBindTexture(GL_TEXTURE_2D, albedoTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-    // floating point texture, RGB for position, A for depth
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    // attach the texture to the framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, albedoTexture, 0);
-
-    /** Emissive Texture **/
-
-    glGenTextures(1, &emissiveTexture);
-    glBindTexture(GL_TEXTURE_2D, emissiveTexture);
-
-    // floating point texture, RGB for position, A for depth
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+        return texture;
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    const char* getName(GBufferLayout layout) {
+        return layout == GBufferLayout::compact ? "compact" : "full";
+    }
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+DeferredPBREffect::DeferredPBREffect(int w, int h, GBufferLayout l) :
+    width(w), height(h), layout(l)
+{
+}
 
-    // attach the texture to the framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, emissiveTexture, 0);
+void DeferredPBREffect::initialize() {
+    createGBuffer();
+    createOutput();
+    createDebugProgram();
+    createProgram();
+}
 
-    /** Roughness And Metalness Texture **/
+std::size_t DeferredPBREffect::getBytesPerPixel(GBufferLayout l) {
+    // 24 bit depth (with 8 bit stencil) is stored in 4 bytes
+    std::size_t depth = 4;
 
-    glGenTextures(1, &roughnessAndMetalnessTexture);
-    glBindTexture(GL_TEXTURE_2D, roughnessAndMetalnessTexture);
-
-    // floating point texture, R for roughness, G for metalness
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
+    if (l == GBufferLayout::compact) {
+        // normal + metalness, albedo + roughness, emissive
+        return depth + 4 + 4 + 4;
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    // position, normal, albedo, emissive, roughness and metalness
+    return depth + 8 + 8 + 4 + 8 + 4;
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+void DeferredPBREffect::setLayout(GBufferLayout l) {
+    if (l == layout) {
+        return;
+    }
 
-    // attach the texture to the framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT4, GL_TEXTURE_2D, roughnessAndMetalnessTexture, 0);
+    layout = l;
 
+    releaseGBuffer();
+    createGBuffer();
+}
 
-    // initialize the depth buffer
-    glGenRenderbuffers(1, &depthBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    // attach the depth buffer to the frame buffer
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+void DeferredPBREffect::createGBuffer() {
+    // initialize the framebuffer for the render target
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
+    // attachment i is written by the material's output at location i, see
+    // ShaderUtils::GBUFFER_OUTPUTS
     std::array<GLenum, 5> drawbuffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3, GL_COLOR_ATTACHMENT4 };
 
+    if (layout == GBufferLayout::compact) {
+        // no position (rebuilt from depth) and no separate roughness and metalness
+        drawbuffers[0] = GL_NONE;
+        drawbuffers[4] = GL_NONE;
+
+        // octahedral normal in rg, metalness in b
+        normalTexture = createTarget(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, GL_COLOR_ATTACHMENT1, width, height);
+        // roughness in a
+        albedoTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT2, width, height);
+        // color * strength
+        emissiveTexture = createTarget(GL_R11F_G11F_B10F, GL_RGB, GL_FLOAT, GL_COLOR_ATTACHMENT3, width, height);
+    } else {
+        // RGB for position, A for whether it is lit
+        positionTexture = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT0, width, height);
+        normalTexture = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT1, width, height);
+        albedoTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT2, width, height);
+        // RGB for color, A for strength
+        emissiveTexture = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_COLOR_ATTACHMENT3, width, height);
+        // R for roughness, G for metalness
+        roughnessAndMetalnessTexture = createTarget(GL_RG16F, GL_RG, GL_FLOAT, GL_COLOR_ATTACHMENT4, width, height);
+    }
+
+    // a texture rather than a renderbuffer, so the Hi-Z pyramid can be built
+    // from it (and the compact layout can rebuild positions)
+    // with stencil, for marking light volumes (see LightVolumes)
+    depthTexture = createTarget(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT, width, height);
 
-    glDrawBuffers(5, drawbuffers.data());
+    glDrawBuffers(static_cast<GLsizei>(drawbuffers.size()), drawbuffers.data());
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         std::cout << "Error creating DeferredPBREffect: Error creating framebuffer\n";
@@ -125,25 +118,47 @@ void DeferredPBREffect::initialize() {
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    createOutput();
-    createDebugProgram();
-    createProgram();
+    // every pixel is written at least once; overdraw adds to both
+    auto pixels = static_cast<double>(width) * static_cast<double>(height);
+    auto megabytes = [pixels](GBufferLayout l) {
+        return static_cast<double>(getBytesPerPixel(l)) * pixels / (1024.0 * 1024.0);
+    };
+
+    auto other = layout == GBufferLayout::compact ? GBufferLayout::full : GBufferLayout::compact;
+
+    std::cout << "G-buffer: " << getName(layout) << " layout, "
+        << getBytesPerPixel(layout) << " bytes/pixel, " << megabytes(layout) << " MB written per frame ("
+        << getName(other) << " layout: " << getBytesPerPixel(other) << " bytes/pixel, " << megabytes(other) << " MB)\n";
 }
 
-DeferredPBREffect::~DeferredPBREffect() {
-    glDeleteTextures(1, &outputTexture);
+void DeferredPBREffect::releaseGBuffer() {
     glDeleteTextures(1, &positionTexture);
     glDeleteTextures(1, &normalTexture);
     glDeleteTextures(1, &albedoTexture);
     glDeleteTextures(1, &emissiveTexture);
     glDeleteTextures(1, &roughnessAndMetalnessTexture);
+    glDeleteTextures(1, &depthTexture);
+
+    glDeleteFramebuffers(1, &fbo);
 
-    glDeleteRenderbuffers(1, &depthBuffer);
+    positionTexture = 0;
+    normalTexture = 0;
+    albedoTexture = 0;
+    emissiveTexture = 0;
+    roughnessAndMetalnessTexture = 0;
+    depthTexture = 0;
+    fbo = 0;
+}
 
+DeferredPBREffect::~DeferredPBREffect() {
+    releaseGBuffer();
+
+    glDeleteTextures(1, &outputTexture);
+    glDeleteRenderbuffers(1, &outputDepthStencil);
     glDeleteFramebuffers(1, &outputFbo);
-    glDeleteFramebuffers(1, &fbo);
 
     glDeleteProgram(program);
+    glDeleteProgram(volumeProgram);
     glDeleteProgram(debugProgram);
 }
 
@@ -167,6 +182,12 @@ void DeferredPBREffect::createOutput() {
     // attach the texture to the framebuffer
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputTexture, 0);
 
+    // the scene depth is copied in for drawing light volumes
+    glGenRenderbuffers(1, &outputDepthStencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, outputDepthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, outputDepthStencil);
+
     std::array<GLenum, 1> drawbuffers = { GL_COLOR_ATTACHMENT0 };
 
 
@@ -233,34 +254,18 @@ void DeferredPBREffect::createProgram() {
     std::string fragmentShaderSource = R"(
         #version 330
 
-        #define MAX_LIGHTS 10
         #define PI 3.1415926535
 
-        uniform mat4 viewMatrix;
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + R"(
 
         uniform float emissiveEnabled;
         uniform float ssaoEnabled;
         uniform float iblEnabled;
+        uniform float clusteredLightingEnabled;
+        uniform float lightVolumesEnabled;
 
-        uniform int numLights;
-        uniform struct Light {
-            vec4 position;
-            vec3 color;
-            float intensity;
-            float ambientCoefficient;
-            float attenuation;
-            float enabled;
-            // spotlight only
-            float coneAngle;
-            vec3 coneDirection;
-        } lights[MAX_LIGHTS];
+    )" + std::string(ShaderUtils::LIGHTS_BLOCK) + std::string(ShaderUtils::CLUSTERED_LIGHTS) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::GBUFFER_DECODE) + R"(
 
-        // scene is a floating point (HDR) texture
-        uniform sampler2D gPosition;
-        uniform sampler2D gNormal;
-        uniform sampler2D gAlbedo;
-        uniform sampler2D gEmissive;
-        uniform sampler2D gRoughnessAndMetalness;
         uniform sampler2D ambientOcclusion;
 
         // IBL
@@ -269,7 +274,19 @@ void DeferredPBREffect::createProgram() {
         uniform samplerCube prefilteredEnvironmentMap;
         uniform sampler2D integratedBRDFMap;
 
+        #ifdef LIGHT_VOLUME
+        // the one light of the volume being drawn, see LightVolumes
+        uniform vec4 volume;
+        uniform vec3 lightColor;
+        uniform float lightAttenuation;
+        // see Light::getRadius; volume.w covers it with the sphere mesh
+        uniform float lightRadius;
+
+        // set from gl_FragCoord, the G-buffer has the size of the viewport
+        vec2 vUv;
+        #else
         in vec2 vUv;
+        #endif
 
         out vec4 fragColor;
 
@@ -350,43 +367,63 @@ void DeferredPBREffect::createProgram() {
             return lambertDiffuse + specularCT;
         }
 
-        vec3 illuminate(vec4 albedo, vec4 emissive, vec3 P, vec3 N, vec3 V, float roughness, float metalness) {
-            vec3 inColor = albedo.rgb;
-            vec3 emissiveColor = emissive.rgb;
-            float emissiveStrength = emissive.a;
+        // Direct lighting from one light; lightPosition is in eye space, with
+        // w = 0 for directional lights, which are not attenuated
+        vec3 shadeLight(vec4 lightPosition, vec3 radiance, float attenuationCoefficient, float radius, vec3 P, vec3 N, vec3 V, vec3 albedo, vec3 F0, float roughness, float metalness) {
+            vec3 L;
+            float attenuation;
+            if (lightPosition.w == 0.0) {
+                L = normalize(lightPosition.xyz);
+                attenuation = 1.0;
+            } else {
+                L = normalize(lightPosition.xyz - P);
+                float distance = length(lightPosition.xyz - P);
+                attenuation = attenuate(distance, attenuationCoefficient, radius);
+            }
+
+            float nDotL = max(dot(N, L), 0.0);
+
+            return fCookTorrance(V, L, N, albedo, F0, roughness, metalness) * radiance * attenuation * nDotL;
+        }
+
+        vec3 illuminate(vec3 albedo, vec3 emissive, vec3 P, vec3 N, vec3 V, float roughness, float metalness) {
+            vec3 inColor = albedo;
 
             // use F0 = 0.04 for dielectric surfaces (non-metallic)
             vec3 F0 = vec3(0.04);
             // for metallic surfaces, mix it towards the albedo of the surface
             F0 = mix(F0, inColor, metalness);
 
+            #ifdef LIGHT_VOLUME
+            // the ambient, IBL and emissive terms are in the full screen pass
+            return shadeLight(vec4(volume.xyz, 1.0), lightColor, lightAttenuation, lightRadius, P, N, V, inColor, F0, roughness, metalness);
+            #else
             vec3 outColor = vec3(0.0);
 
-            for (int i = 0; i < numLights; i++) {
-                Light light = lights[i];
-                if (light.enabled < 0.5) {
-                    continue;
+            if (clusteredLightingEnabled > 0.5f && lightVolumesEnabled < 0.5f) {
+                // only the lights that reach this pixel's cluster
+                uvec2 cluster = findCluster(vUv, -P.z);
+
+                for (uint i = 0u; i < cluster.y; i++) {
+                    ClusterLight light = clusterLight(cluster, i);
+                    outColor += shadeLight(light.position, light.radiance, light.attenuation, light.radius, P, N, V, inColor, F0, roughness, metalness);
                 }
-                vec3 L;
-                float attenuation;
-                if (light.position.w == 0.0) {
-                    // directional light
-                    // convert the direction into eyespace
-                    L = normalize((viewMatrix * light.position).xyz);
-                    // directional lights don't support attenuation
-                    attenuation = 1.0;
-                } else {
-                    vec3 lightPositionEyespace = (viewMatrix * light.position).xyz;
-                    L = normalize(lightPositionEyespace - P);
-                    float distance = length(lightPositionEyespace - P);
-                    attenuation = 1.0 / (1.0 + light.attenuation * pow(distance, 2));
+            } else {
+                for (int i = 0; i < numLights; i++) {
+                    Light light = lights[i];
+                    if (light.enabled < 0.5) {
+                        continue;
+                    }
+
+                    // drawn as a light volume instead, see LightVolumes::hasVolume
+                    if (lightVolumesEnabled > 0.5f && light.position.w != 0.0 && light.attenuation > 0.0) {
+                        continue;
+                    }
+
+                    // directional lights keep w = 0, so this only rotates them
+                    vec4 lightPosition = viewMatrix * light.position;
+                    outColor += shadeLight(lightPosition, light.color * light.intensity, light.attenuation, light.radius, P, N, V, inColor, F0, roughness, metalness);
                 }
-
-                vec3 radiance = light.color * light.intensity * attenuation;
-
-                float nDotL = max(dot(N, L), 0.0);
-
-                outColor += fCookTorrance(V, L, N, inColor, F0, roughness, metalness) * radiance * nDotL;
             }
 
             float ao = 1.0;
@@ -422,32 +459,45 @@ void DeferredPBREffect::createProgram() {
             }
 
             if (emissiveEnabled > 0.5f) {
-                outColor += emissiveStrength * emissiveColor;
+                outColor += emissive;
             }
 
             return outColor;
+            #endif
         }
 
         void main() {
-            vec4 p = texture(gPosition, vUv);
-            vec3 position = p.xyz;
-            vec3 normal = texture(gNormal, vUv).rgb;
-            vec4 albedo = texture(gAlbedo, vUv);
-            vec4 emissive = texture(gEmissive, vUv);
-            vec2 mr = texture(gRoughnessAndMetalness, vUv).rg;
+            #ifdef LIGHT_VOLUME
+            vUv = gl_FragCoord.xy / viewportSize;
+            #endif
+
+            Surface surface = readGBuffer(vUv);
 
-            vec3 N = normalize(normal);
-            vec3 V = normalize(-position);
+            vec3 N = surface.normal;
+            vec3 V = normalize(-surface.position);
 
             if (dot(N, V) < 0.0) {
                 N = -N;
             }
 
-            vec3 color = albedo.rgb;
-            // only apply illumination if position's w component is 1
+            vec3 color = surface.albedo.rgb;
+
+            #ifdef LIGHT_VOLUME
+            // added to the full screen pass, which has the unlit color
+            color = vec3(0.0);
+            #endif
+
             // For instance, the skybox should not be illuminated
-            if (p.w > 0.5f) {
-                color = illuminate(albedo, emissive, position, N, V, max(mr.r, 0.01), mr.g);
+            if (surface.lit) {
+                color = illuminate(
+                    surface.albedo.rgb,
+                    surface.emissive,
+                    surface.position,
+                    N,
+                    V,
+                    max(surface.roughness, 0.01),
+                    surface.metalness
+                );
             }
 
             fragColor = vec4(color, 1.0);
@@ -455,111 +505,50 @@ void DeferredPBREffect::createProgram() {
     )";
 
     program = ShaderUtils::compile(vertexShaderSource, fragmentShaderSource);
+    ShaderUtils::bindUniformBlock(program, "Lights", LightBuffer::BINDING);
+    ShaderUtils::bindUniformBlock(program, "Frame", FrameUniforms::BINDING);
+
+    volumeProgram = ShaderUtils::compile(LightVolumes::getVertexShader(), ShaderUtils::addDefine(fragmentShaderSource, "LIGHT_VOLUME"));
+    ShaderUtils::bindUniformBlock(volumeProgram, "Lights", LightBuffer::BINDING);
+    ShaderUtils::bindUniformBlock(volumeProgram, "Frame", FrameUniforms::BINDING);
+
+    assignTextureUnits(program);
+    assignTextureUnits(volumeProgram);
 
     glUseProgram(program);
     glUniform1f(glGetUniformLocation(program, "ssaoEnabled"), 1.0f);
     glUniform1f(glGetUniformLocation(program, "emissiveEnabled"), 1.0f);
     glUniform1f(glGetUniformLocation(program, "iblEnabled"), 1.0f);
+    glUniform1f(glGetUniformLocation(program, "clusteredLightingEnabled"), 1.0f);
+    glUniform1f(glGetUniformLocation(program, "lightVolumesEnabled"), 0.0f);
     glUseProgram(0);
 }
 
-void DeferredPBREffect::setLights(const std::vector<std::shared_ptr<Light>>& lights) const {
-    std::size_t lightIndex = 0;
-
+void DeferredPBREffect::toggleSSAO(bool value) const {
     glUseProgram(program);
-
-    glUniform1i(glGetUniformLocation(program, "numLights"), lights.size());
-
-    for (const auto& light : lights) {
-        auto lightInfo = light->getLightInfo();
-
-        // position
-        std::ostringstream positionLocation;
-        std::ostringstream colorLocation;
-        std::ostringstream intensityLocation;
-        std::ostringstream attenuationLocation;
-        std::ostringstream ambientCoefficientLocation;
-        std::ostringstream enabledLocation;
-        std::ostringstream coneAngleLocation;
-        std::ostringstream coneDirectionLocation;
-
-        positionLocation << "lights[" << lightIndex << "].position";
-        colorLocation << "lights[" << lightIndex << "].color";
-        intensityLocation << "lights[" << lightIndex << "].intensity";
-        attenuationLocation << "lights[" << lightIndex << "].attenuation";
-        ambientCoefficientLocation << "lights[" << lightIndex << "].ambientCoefficient";
-        enabledLocation << "lights[" << lightIndex << "].enabled";
-        coneAngleLocation << "lights[" << lightIndex << "].coneAngle";
-        coneDirectionLocation << "lights[" << lightIndex << "].coneDirection";
-
-        glUniform4fv(
-            glGetUniformLocation(program, positionLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.position)
-        );
-
-        glUniform3fv(
-            glGetUniformLocation(program, colorLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.color)
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, intensityLocation.str().c_str()),
-            lightInfo.intensity
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, attenuationLocation.str().c_str()),
-            lightInfo.attenuation
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, ambientCoefficientLocation.str().c_str()),
-            lightInfo.ambientCoefficient
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, enabledLocation.str().c_str()),
-            lightInfo.enabled ? 1.0f : 0.0f
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, coneAngleLocation.str().c_str()),
-            lightInfo.coneAngle
-        );
-
-        glUniform3fv(
-            glGetUniformLocation(program, coneDirectionLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.coneDirection)
-        );
-
-
-        lightIndex++;
-    }
-
+    auto ssaoEnabledLocation = glGetUniformLocation(program, "ssaoEnabled");
+    glUniform1f(ssaoEnabledLocation, value ? 1.0f : 0.0f);
     glUseProgram(0);
 }
 
-void DeferredPBREffect::setViewMatrix(const glm::mat4& viewMatrix) const {
+void DeferredPBREffect::toggleIBL(bool value) const {
     glUseProgram(program);
-    auto viewMatrixLocation = glGetUniformLocation(program, "viewMatrix");
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+    auto iblEnabledLocation = glGetUniformLocation(program, "iblEnabled");
+    glUniform1f(iblEnabledLocation, value ? 1.0f : 0.0f);
     glUseProgram(0);
 }
 
-void DeferredPBREffect::toggleSSAO(bool value) const {
+void DeferredPBREffect::toggleClusteredLighting(bool value) const {
     glUseProgram(program);
-    auto ssaoEnabledLocation = glGetUniformLocation(program, "ssaoEnabled");
-    glUniform1f(ssaoEnabledLocation, value ? 1.0f : 0.0f);
+    auto clusteredLightingEnabledLocation = glGetUniformLocation(program, "clusteredLightingEnabled");
+    glUniform1f(clusteredLightingEnabledLocation, value ? 1.0f : 0.0f);
     glUseProgram(0);
 }
 
-void DeferredPBREffect::toggleIBL(bool value) const {
+void DeferredPBREffect::toggleLightVolumes(bool value) const {
     glUseProgram(program);
-    auto iblEnabledLocation = glGetUniformLocation(program, "iblEnabled");
-    glUniform1f(iblEnabledLocation, value ? 1.0f : 0.0f);
+    auto lightVolumesEnabledLocation = glGetUniformLocation(program, "lightVolumesEnabled");
+    glUniform1f(lightVolumesEnabledLocation, value ? 1.0f : 0.0f);
     glUseProgram(0);
 }
 
@@ -568,7 +557,8 @@ void DeferredPBREffect::render(
     GLuint ambientOcclusion,
     GLuint diffuseIrradianceMap,
     GLuint prefilteredEnvironmentMap,
-    GLuint integratedBRDFMap
+    GLuint integratedBRDFMap,
+    const ClusteredLights& clusteredLights
 ) const {
     glBindFramebuffer(GL_FRAMEBUFFER, outputFbo);
     glClearColor(0.0, 0.0, 0.0, 1.0);
@@ -581,20 +571,7 @@ void DeferredPBREffect::render(
     // use the debug program from the deferred target (just render 1 property)
     glUseProgram(deferredProgram);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, positionTexture);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, normalTexture);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, albedoTexture);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, emissiveTexture);
-
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, roughnessAndMetalnessTexture);
+    bindGBuffer();
 
     glActiveTexture(GL_TEXTURE5);
     glBindTexture(GL_TEXTURE_2D, ambientOcclusion);
@@ -608,17 +585,71 @@ void DeferredPBREffect::render(
     glActiveTexture(GL_TEXTURE8);
     glBindTexture(GL_TEXTURE_2D, integratedBRDFMap);
 
-    glUniform1i(glGetUniformLocation(deferredProgram, "gPosition"), 0);
-    glUniform1i(glGetUniformLocation(deferredProgram, "gNormal"), 1);
-    glUniform1i(glGetUniformLocation(deferredProgram, "gAlbedo"), 2);
-    glUniform1i(glGetUniformLocation(deferredProgram, "gEmissive"), 3);
-    glUniform1i(glGetUniformLocation(deferredProgram, "gRoughnessAndMetalness"), 4);
-    glUniform1i(glGetUniformLocation(deferredProgram, "ambientOcclusion"), 5);
-    glUniform1i(glGetUniformLocation(deferredProgram, "diffuseIrradianceMap"), 6);
-    glUniform1i(glGetUniformLocation(deferredProgram, "prefilteredEnvironmentMap"), 7);
-    glUniform1i(glGetUniformLocation(deferredProgram, "integratedBRDFMap"), 8);
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_BUFFER, clusteredLights.getLightTexture());
+
+    glActiveTexture(GL_TEXTURE11);
+    glBindTexture(GL_TEXTURE_BUFFER, clusteredLights.getClusterTexture());
+
+    glActiveTexture(GL_TEXTURE12);
+    glBindTexture(GL_TEXTURE_BUFFER, clusteredLights.getIndexTexture());
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
     glUseProgram(0);
 }
+
+void DeferredPBREffect::renderLightVolumes(
+    const LightVolumes& lightVolumes,
+    const std::vector<std::shared_ptr<Light>>& lights,
+    const glm::mat4& viewMatrix
+) const {
+    // the volumes are depth tested against the scene
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFbo);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFbo);
+
+    bindGBuffer();
+
+    lightVolumes.render(lights, viewMatrix, volumeProgram);
+}
+
+void DeferredPBREffect::bindGBuffer() const {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, positionTexture);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, normalTexture);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, albedoTexture);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, emissiveTexture);
+
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, roughnessAndMetalnessTexture);
+
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+}
+
+void DeferredPBREffect::assignTextureUnits(GLuint p) const {
+    // every sampler gets its own unit, samplers of different types must not share one
+    glUseProgram(p);
+    glUniform1i(glGetUniformLocation(p, "gPosition"), 0);
+    glUniform1i(glGetUniformLocation(p, "gNormal"), 1);
+    glUniform1i(glGetUniformLocation(p, "gAlbedo"), 2);
+    glUniform1i(glGetUniformLocation(p, "gEmissive"), 3);
+    glUniform1i(glGetUniformLocation(p, "gRoughnessAndMetalness"), 4);
+    glUniform1i(glGetUniformLocation(p, "ambientOcclusion"), 5);
+    glUniform1i(glGetUniformLocation(p, "diffuseIrradianceMap"), 6);
+    glUniform1i(glGetUniformLocation(p, "prefilteredEnvironmentMap"), 7);
+    glUniform1i(glGetUniformLocation(p, "integratedBRDFMap"), 8);
+    glUniform1i(glGetUniformLocation(p, "gDepth"), 9);
+    glUniform1i(glGetUniformLocation(p, "clusterLights"), 10);
+    glUniform1i(glGetUniformLocation(p, "clusterGrid"), 11);
+    glUniform1i(glGetUniformLocation(p, "clusterIndices"), 12);
+    glUseProgram(0);
+}
@@ -3,15 +3,36 @@
 #include <glm/glm.hpp>
 #include <GL/glew.h>
 
+#include <cstddef>
 #include <memory>
 #include <vector>
 
+class ClusteredLights;
 class Light;
+class LightVolumes;
+
+/**
+ * What the PBR G-buffer stores per pixel, besides 24 bit depth and stencil:
+ *
+ * full: eye space position + lit flag (RGBA16F), normal (RGBA16F),
+ *   albedo (RGBA8), emissive color + strength (RGBA16F),
+ *   roughness and metalness (RG16F); 36 bytes
+ * compact: octahedral normal + metalness (RGB10_A2), albedo + roughness
+ *   (RGBA8), premultiplied emissive (R11F_G11F_B10F); 16 bytes. The
+ *   position is rebuilt from depth, pixels at the far plane are unlit
+ *
+ * Materials write either through ShaderUtils::GBUFFER_OUTPUTS and passes
+ * read it through ShaderUtils::GBUFFER_DECODE.
+ **/
+enum class GBufferLayout {
+    full,
+    compact
+};
 
 // TODO(mfirmin): This and DeferredShadingEffect should both inherit from a shared parent class
 class DeferredPBREffect {
     public:
-        DeferredPBREffect(int width, int height);
+        DeferredPBREffect(int width, int height, GBufferLayout layout = GBufferLayout::compact);
 
         DeferredPBREffect(DeferredPBREffect&& other) = default;
         DeferredPBREffect& operator=(DeferredPBREffect&& other) = default;
@@ -23,6 +44,16 @@ class DeferredPBREffect {
 
         void initialize();
 
+        // Recreates the G-buffer textures (and so their names) in the new layout
+        void setLayout(GBufferLayout layout);
+
+        GBufferLayout getLayout() const {
+            return layout;
+        }
+
+        // Bytes written per pixel (without overdraw), depth included
+        static std::size_t getBytesPerPixel(GBufferLayout layout);
+
         GLuint getDebugProgram() const {
             return debugProgram;
         }
@@ -35,6 +66,7 @@ class DeferredPBREffect {
             return fbo;
         }
 
+        // 0 in the compact layout
         GLuint getPosition() const {
             return positionTexture;
         }
@@ -51,6 +83,10 @@ class DeferredPBREffect {
             return emissiveTexture;
         }
 
+        GLuint getDepth() const {
+            return depthTexture;
+        }
+
         GLuint getOutputFramebuffer() const {
             return outputFbo;
         }
@@ -59,25 +95,34 @@ class DeferredPBREffect {
             return outputTexture;
         }
 
-        void setLights(const std::vector<std::shared_ptr<Light>>& lights) const;
-
-        void setViewMatrix(
-            const glm::mat4& viewMatrix
-        ) const;
-
         void toggleSSAO(bool value) const;
         void toggleIBL(bool value) const;
+        // Shade with the lights of each pixel's cluster (see ClusteredLights)
+        // rather than every light of the Lights block
+        void toggleClusteredLighting(bool value) const;
+        // Leave the lights drawn by renderLightVolumes out of render
+        void toggleLightVolumes(bool value) const;
 
         void render(
             GLuint vao,
             GLuint ambientOcclusion,
             GLuint diffuseIrradianceMap,
             GLuint prefilteredEnvironmentMap,
-            GLuint integratedBRDFMap
+            GLuint integratedBRDFMap,
+            const ClusteredLights& clusteredLights
+        ) const;
+
+        // Adds the point and spot lights to render's output, drawn as light
+        // volumes against the G-buffer depth
+        void renderLightVolumes(
+            const LightVolumes& lightVolumes,
+            const std::vector<std::shared_ptr<Light>>& lights,
+            const glm::mat4& viewMatrix
         ) const;
     private:
         int width;
         int height;
+        GBufferLayout layout;
 
         GLuint fbo = 0;
         GLuint positionTexture = 0;
@@ -86,16 +131,26 @@ class DeferredPBREffect {
         GLuint emissiveTexture = 0;
         GLuint roughnessAndMetalnessTexture = 0;
 
-        GLuint depthBuffer = 0;
+        GLuint depthTexture = 0;
 
         GLuint outputFbo = 0;
         GLuint outputTexture = 0;
+        // copy of the G-buffer depth, and stencil for the light volumes
+        GLuint outputDepthStencil = 0;
 
         GLuint program = 0;
+        // shades one light volume, see LightVolumes
+        GLuint volumeProgram = 0;
         GLuint debugProgram = 0;
 
+        void createGBuffer();
+        void releaseGBuffer();
+
         void createDebugProgram();
         void createProgram();
 
         void createOutput();
+
+        void bindGBuffer() const;
+        void assignTextureUnits(GLuint program) const;
 };
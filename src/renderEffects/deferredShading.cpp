@@ -1,13 +1,14 @@
 #include "deferredShading.hpp"
 
+#include "frameUniforms.hpp"
 #include "gl/shaderUtils.hpp"
-#include "light/light.hpp"
+#include "light/lightBuffer.hpp"
+#include "renderEffects/lightVolumes.hpp"
 
 #include <array>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <string>
-#include <sstream>
 
 DeferredShadingEffect::DeferredShadingEffect(int w, int h) :
     width(w), height(h)
@@ -80,12 +81,23 @@ void DeferredShadingEffect::initialize() {
     // attach the texture to the framebuffer
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, emissiveTexture, 0);
 
-    // initialize the depth buffer
-    glGenRenderbuffers(1, &depthBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    // attach the depth buffer to the frame buffer
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    /** Depth Texture **/
+
+    // a texture rather than a renderbuffer, so the Hi-Z pyramid can be built from it;
+    // with stencil, for marking light volumes (see LightVolumes)
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // attach the depth texture to the frame buffer
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
 
     std::array<GLenum, 4> drawbuffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
 
@@ -110,12 +122,14 @@ DeferredShadingEffect::~DeferredShadingEffect() {
     glDeleteTextures(1, &albedoTexture);
     glDeleteTextures(1, &emissiveTexture);
 
-    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteTextures(1, &depthTexture);
 
+    glDeleteRenderbuffers(1, &outputDepthStencil);
     glDeleteFramebuffers(1, &outputFbo);
 
     glDeleteProgram(debugProgram);
     glDeleteProgram(program);
+    glDeleteProgram(volumeProgram);
 }
 
 void DeferredShadingEffect::createOutput() {
@@ -138,6 +152,12 @@ void DeferredShadingEffect::createOutput() {
     // attach the texture to the framebuffer
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputTexture, 0);
 
+    // the scene depth is copied in for drawing light volumes
+    glGenRenderbuffers(1, &outputDepthStencil);
+    glBindRenderbuffer(GL_RENDERBUFFER, outputDepthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, outputDepthStencil);
+
     std::array<GLenum, 1> drawbuffers = { GL_COLOR_ATTACHMENT0 };
 
 
@@ -206,140 +226,155 @@ void DeferredShadingEffect::createProgram() {
     std::string fragmentShaderSource = R"(
         #version 330
 
-        #define MAX_LIGHTS 10
-
-        uniform mat4 viewMatrix;
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + R"(
 
         uniform float blinnEnabled;
         uniform float emissiveEnabled;
         uniform float ssaoEnabled;
+        uniform float lightVolumesEnabled;
 
-        uniform int numLights;
-        uniform struct Light {
-            vec4 position;
-            vec3 color;
-            float intensity;
-            float ambientCoefficient;
-            float attenuation;
-            float enabled;
-            // spotlight only
-            float coneAngle;
-            vec3 coneDirection;
-        } lights[MAX_LIGHTS];
+    )" + std::string(ShaderUtils::LIGHTS_BLOCK) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::GBUFFER_DECODE) + R"(
 
-        // scene is a floating point (HDR) texture
-        uniform sampler2D gPosition;
-        uniform sampler2D gNormal;
-        uniform sampler2D gAlbedo;
-        uniform sampler2D gEmissive;
         uniform sampler2D ambientOcclusion;
 
+        #ifdef LIGHT_VOLUME
+        // the one light of the volume being drawn, see LightVolumes
+        uniform vec4 volume;
+        uniform vec3 lightColor;
+        uniform float lightAttenuation;
+        // see Light::getRadius; volume.w covers it with the sphere mesh
+        uniform float lightRadius;
+
+        // set from gl_FragCoord, the G-buffer has the size of the viewport
+        vec2 vUv;
+        #else
         in vec2 vUv;
+        #endif
 
         out vec4 fragColor;
 
-        vec3 illuminate(vec4 albedo, vec4 emissive, vec3 P, vec3 N, vec3 E) {
+        // Diffuse and specular lighting from one light; lightPosition is in
+        // eye space, with w = 0 for directional lights, which are not attenuated
+        vec3 shadeLight(vec4 lightPosition, vec3 radiance, float attenuationCoefficient, float radius, vec4 albedo, vec3 P, vec3 N, vec3 E) {
             vec3 inColor = albedo.rgb;
-            vec3 emissiveColor = emissive.rgb;
-            float emissiveStrength = emissive.a;
 
             float specularCoefficient = albedo.a;
 
-            vec3 outColor = vec3(0.0);
+            vec3 L;
+            float attenuation;
+            if (lightPosition.w == 0.0) {
+                L = normalize(lightPosition.xyz);
+                attenuation = 1.0;
+            } else {
+                L = normalize(lightPosition.xyz - P);
+                float distance = length(lightPosition.xyz - P);
+                attenuation = attenuate(distance, attenuationCoefficient, radius);
+            }
+            // TODO: Spotlights
 
-            for (int i = 0; i < numLights; i++) {
-                Light light = lights[i];
-                if (light.enabled < 0.5) {
-                    continue;
-                }
-                vec3 L;
-                float attenuation;
-                if (light.position.w == 0.0) {
-                    // directional light
-                    // convert the direction into eyespace
-                    L = normalize((viewMatrix * light.position).xyz);
-                    // directional lights don't support attenuation
-                    attenuation = 1.0;
+            vec3 H = normalize(L + E);
+
+            float diffuseCoefficient = max(0.0, dot(N, L));
+            vec3 diffuse = diffuseCoefficient * inColor * radiance;
+
+            float specularTerm = 0.0;
+
+            if (diffuseCoefficient > 0.0) {
+                float dir = 0.0;
+                if (blinnEnabled > 0.5f) {
+                    dir = dot(N, H);
                 } else {
-                    vec3 lightPositionEyespace = (viewMatrix * light.position).xyz;
-                    L = normalize(lightPositionEyespace - P);
-                    float distance = length(lightPositionEyespace - P);
-                    attenuation = 1.0 / (1.0 + light.attenuation * pow(distance, 2));
+                    dir = dot(
+                        E,
+                        reflect(-L, N)
+                    );
                 }
-                // TODO: Spotlights
+                specularTerm = pow(
+                    max(
+                        0.0,
+                        dir
+                    ),
+                    32.0
+                );
+            }
 
-                vec3 H = normalize(L + E);
+            // Specular color can (and should) be a different color than diffuse
+            // this is because it often represents a top glossy layer over the actual paint of the object.
 
-                float ao = 1.0;
+            vec3 specularColor = vec3(1.0, 1.0, 1.0);
 
-                if (ssaoEnabled > 0.5f) {
-                    ao = texture(ambientOcclusion, vUv).r;
-                }
+            vec3 specular = specularCoefficient * specularTerm * specularColor * radiance;
 
-                vec3 ambient = light.ambientCoefficient * inColor * light.color * light.intensity * ao;
-
-                float diffuseCoefficient = max(0.0, dot(N, L));
-                vec3 diffuse = diffuseCoefficient * inColor * light.color * light.intensity;
-
-                float specularTerm = 0.0;
-
-                if (diffuseCoefficient > 0.0) {
-                    float dir = 0.0;
-                    if (blinnEnabled > 0.5f) {
-                        dir = dot(N, H);
-                    } else {
-                        dir = dot(
-                            E,
-                            reflect(-L, N)
-                        );
-                    }
-                    specularTerm = pow(
-                        max(
-                            0.0,
-                            dir
-                        ),
-                        32.0
-                    );
-                }
+            // TODO: Shadows
+
+            return attenuation * (diffuse + specular);
+        }
+
+        vec3 illuminate(vec4 albedo, vec3 emissive, vec3 P, vec3 N, vec3 E) {
+            #ifdef LIGHT_VOLUME
+            // the ambient and emissive terms are in the full screen pass
+            return shadeLight(vec4(volume.xyz, 1.0), lightColor, lightAttenuation, lightRadius, albedo, P, N, E);
+            #else
+            vec3 inColor = albedo.rgb;
+
+            vec3 outColor = vec3(0.0);
+
+            float ao = 1.0;
 
-                // Specular color can (and should) be a different color than diffuse
-                // this is because it often represents a top glossy layer over the actual paint of the object.
+            if (ssaoEnabled > 0.5f) {
+                ao = texture(ambientOcclusion, vUv).r;
+            }
 
-                vec3 specularColor = vec3(1.0, 1.0, 1.0);
+            for (int i = 0; i < numLights; i++) {
+                Light light = lights[i];
+                if (light.enabled < 0.5) {
+                    continue;
+                }
 
-                vec3 specular = specularCoefficient * specularTerm * specularColor * light.color * light.intensity;
+                // not attenuated, so it is added everywhere
+                outColor += light.ambientCoefficient * inColor * light.color * light.intensity * ao;
 
-                // TODO: Shadows
+                // drawn as a light volume instead, see LightVolumes::hasVolume
+                if (lightVolumesEnabled > 0.5f && light.position.w != 0.0 && light.attenuation > 0.0) {
+                    continue;
+                }
 
-                outColor += ambient + attenuation * (diffuse + specular);
+                // directional lights keep w = 0, so this only rotates them
+                vec4 lightPosition = viewMatrix * light.position;
+                outColor += shadeLight(lightPosition, light.color * light.intensity, light.attenuation, light.radius, albedo, P, N, E);
             }
 
             if (emissiveEnabled > 0.5f) {
-                outColor += emissiveStrength * emissiveColor;
+                outColor += emissive;
             }
 
             return outColor;
+            #endif
         }
 
         void main() {
-            vec4 p = texture(gPosition, vUv);
-            vec3 position = p.xyz;
+            #ifdef LIGHT_VOLUME
+            vUv = gl_FragCoord.xy / viewportSize;
+            #endif
 
-            vec3 normal = texture(gNormal, vUv).rgb;
-            vec4 albedo = texture(gAlbedo, vUv);
-            vec4 emissive = texture(gEmissive, vUv);
+            Surface surface = readGBuffer(vUv);
 
-            vec3 N = normalize(normal);
-            vec3 E = normalize(-position);
+            vec3 N = surface.normal;
+            vec3 E = normalize(-surface.position);
 
             if (dot(N, E) < 0.0) {
                 N = -N;
             }
 
-            vec3 color = albedo.rgb;
+            vec3 color = surface.albedo.rgb;
+
+            #ifdef LIGHT_VOLUME
+            // added to the full screen pass, which has the unlit color
+            color = vec3(0.0);
+            #endif
 
-            if (p.w > 0.5f) {
-                color = illuminate(albedo, emissive, position, N, E);
+            if (surface.lit) {
+                color = illuminate(surface.albedo, surface.emissive, surface.position, N, E);
             }
 
             fragColor = vec4(color, 1.0);
@@ -347,104 +382,42 @@ void DeferredShadingEffect::createProgram() {
     )";
 
     program = ShaderUtils::compile(vertexShaderSource, fragmentShaderSource);
+    ShaderUtils::bindUniformBlock(program, "Lights", LightBuffer::BINDING);
+    ShaderUtils::bindUniformBlock(program, "Frame", FrameUniforms::BINDING);
+
+    volumeProgram = ShaderUtils::compile(LightVolumes::getVertexShader(), ShaderUtils::addDefine(fragmentShaderSource, "LIGHT_VOLUME"));
+    ShaderUtils::bindUniformBlock(volumeProgram, "Lights", LightBuffer::BINDING);
+    ShaderUtils::bindUniformBlock(volumeProgram, "Frame", FrameUniforms::BINDING);
 
     glUseProgram(program);
     glUniform1f(glGetUniformLocation(program, "blinnEnabled"), 1.0f);
     glUniform1f(glGetUniformLocation(program, "ssaoEnabled"), 1.0f);
     glUniform1f(glGetUniformLocation(program, "emissiveEnabled"), 1.0f);
+    glUniform1f(glGetUniformLocation(program, "lightVolumesEnabled"), 0.0f);
+
+    glUseProgram(volumeProgram);
+    glUniform1f(glGetUniformLocation(volumeProgram, "blinnEnabled"), 1.0f);
+    glUniform1i(glGetUniformLocation(volumeProgram, "gPosition"), 0);
+    glUniform1i(glGetUniformLocation(volumeProgram, "gNormal"), 1);
+    glUniform1i(glGetUniformLocation(volumeProgram, "gAlbedo"), 2);
+    glUniform1i(glGetUniformLocation(volumeProgram, "gEmissive"), 3);
     glUseProgram(0);
 }
 
-void DeferredShadingEffect::setLights(const std::vector<std::shared_ptr<Light>>& lights) const {
-    std::size_t lightIndex = 0;
-
-    glUseProgram(program);
-
-    glUniform1i(glGetUniformLocation(program, "numLights"), lights.size());
-
-    for (const auto& light : lights) {
-        auto lightInfo = light->getLightInfo();
-
-        // position
-        std::ostringstream positionLocation;
-        std::ostringstream colorLocation;
-        std::ostringstream intensityLocation;
-        std::ostringstream attenuationLocation;
-        std::ostringstream ambientCoefficientLocation;
-        std::ostringstream enabledLocation;
-        std::ostringstream coneAngleLocation;
-        std::ostringstream coneDirectionLocation;
-
-        positionLocation << "lights[" << lightIndex << "].position";
-        colorLocation << "lights[" << lightIndex << "].color";
-        intensityLocation << "lights[" << lightIndex << "].intensity";
-        attenuationLocation << "lights[" << lightIndex << "].attenuation";
-        ambientCoefficientLocation << "lights[" << lightIndex << "].ambientCoefficient";
-        enabledLocation << "lights[" << lightIndex << "].enabled";
-        coneAngleLocation << "lights[" << lightIndex << "].coneAngle";
-        coneDirectionLocation << "lights[" << lightIndex << "].coneDirection";
-
-        glUniform4fv(
-            glGetUniformLocation(program, positionLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.position)
-        );
-
-        glUniform3fv(
-            glGetUniformLocation(program, colorLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.color)
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, intensityLocation.str().c_str()),
-            lightInfo.intensity
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, attenuationLocation.str().c_str()),
-            lightInfo.attenuation
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, ambientCoefficientLocation.str().c_str()),
-            lightInfo.ambientCoefficient
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, enabledLocation.str().c_str()),
-            lightInfo.enabled ? 1.0f : 0.0f
-        );
-
-        glUniform1f(
-            glGetUniformLocation(program, coneAngleLocation.str().c_str()),
-            lightInfo.coneAngle
-        );
-
-        glUniform3fv(
-            glGetUniformLocation(program, coneDirectionLocation.str().c_str()),
-            1,
-            glm::value_ptr(lightInfo.coneDirection)
-        );
-
-
-        lightIndex++;
+void DeferredShadingEffect::toggleBlinnPhongShading(bool value) const {
+    // the light volumes shade specular highlights too
+    for (auto p : { program, volumeProgram }) {
+        glUseProgram(p);
+        auto blinnEnabledLocation = glGetUniformLocation(p, "blinnEnabled");
+        glUniform1f(blinnEnabledLocation, value ? 1.0f : 0.0f);
     }
-
-    glUseProgram(0);
-}
-
-void DeferredShadingEffect::setViewMatrix(const glm::mat4& viewMatrix) const {
-    glUseProgram(program);
-    auto viewMatrixLocation = glGetUniformLocation(program, "viewMatrix");
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
     glUseProgram(0);
 }
 
-void DeferredShadingEffect::toggleBlinnPhongShading(bool value) const {
+void DeferredShadingEffect::toggleLightVolumes(bool value) const {
     glUseProgram(program);
-    auto blinnEnabledLocation = glGetUniformLocation(program, "blinnEnabled");
-    glUniform1f(blinnEnabledLocation, value ? 1.0f : 0.0f);
+    auto lightVolumesEnabledLocation = glGetUniformLocation(program, "lightVolumesEnabled");
+    glUniform1f(lightVolumesEnabledLocation, value ? 1.0f : 0.0f);
     glUseProgram(0);
 }
 
@@ -496,3 +469,29 @@ void DeferredShadingEffect::render(GLuint vao, GLuint ambientOcclusion) const {
 
     glUseProgram(0);
 }
+
+void DeferredShadingEffect::renderLightVolumes(
+    const LightVolumes& lightVolumes,
+    const std::vector<std::shared_ptr<Light>>& lights,
+    const glm::mat4& viewMatrix
+) const {
+    // the volumes are depth tested against the scene
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFbo);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFbo);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, positionTexture);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, normalTexture);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, albedoTexture);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, emissiveTexture);
+
+    lightVolumes.render(lights, viewMatrix, volumeProgram);
+}
@@ -7,6 +7,7 @@
 #include <vector>
 
 class Light;
+class LightVolumes;
 
 // TODO(mfirmin): This and DeferredPBREffect should both inherit from a shared parent class
 class DeferredShadingEffect {
@@ -51,6 +52,10 @@ class DeferredShadingEffect {
             return emissiveTexture;
         }
 
+        GLuint getDepth() const {
+            return depthTexture;
+        }
+
         GLuint getOutputFramebuffer() const {
             return outputFbo;
         }
@@ -59,17 +64,21 @@ class DeferredShadingEffect {
             return outputTexture;
         }
 
-        void setLights(const std::vector<std::shared_ptr<Light>>& lights) const;
-
-        void setViewMatrix(
-            const glm::mat4& viewMatrix
-        ) const;
-
         void toggleBlinnPhongShading(bool value) const;
         void toggleSSAO(bool value) const;
         void toggleIBL(bool value) const;
+        // Leave the lights drawn by renderLightVolumes out of render
+        void toggleLightVolumes(bool value) const;
 
         void render(GLuint vao, GLuint ambientOcclusion) const;
+
+        // Adds the point and spot lights to render's output, drawn as light
+        // volumes against the G-buffer depth
+        void renderLightVolumes(
+            const LightVolumes& lightVolumes,
+            const std::vector<std::shared_ptr<Light>>& lights,
+            const glm::mat4& viewMatrix
+        ) const;
     private:
         int width;
         int height;
@@ -80,12 +89,16 @@ class DeferredShadingEffect {
         GLuint albedoTexture = 0;
         GLuint emissiveTexture = 0;
 
-        GLuint depthBuffer = 0;
+        GLuint depthTexture = 0;
 
         GLuint outputFbo = 0;
         GLuint outputTexture = 0;
+        // copy of the G-buffer depth, and stencil for the light volumes
+        GLuint outputDepthStencil = 0;
 
         GLuint program = 0;
+        // shades one light volume, see LightVolumes
+        GLuint volumeProgram = 0;
         GLuint debugProgram = 0;
 
         void createDebugProgram();
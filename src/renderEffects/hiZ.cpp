@@ -0,0 +1,317 @@
+#include "hiZ.hpp"
+
+#include "gl/shaderUtils.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <string>
+
+HiZEffect::HiZEffect(int w, int h) :
+    width(w),
+    height(h)
+{}
+
+HiZEffect::~HiZEffect() {
+    for (auto& level : levels) {
+        glDeleteFramebuffers(1, &level.fbo);
+    }
+
+    for (auto& readback : readbacks) {
+        glDeleteSync(readback.fence);
+        glDeleteBuffers(1, &readback.buffer);
+    }
+
+    glDeleteTextures(1, &texture);
+    glDeleteProgram(program);
+}
+
+// Must call this AFTER GL/SDL have been initialized
+void HiZEffect::initialize() {
+    createLevels();
+    createProgram();
+}
+
+void HiZEffect::createLevels() {
+    int levelWidth = std::max(width / 2, 1);
+    int levelHeight = std::max(height / 2, 1);
+
+    while (true) {
+        Level level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        levels.push_back(level);
+
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+    }
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // single channel floating point, depths aren't filtered
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_R32F, levels[i].width, levels[i].height, 0, GL_RED, GL_FLOAT, nullptr);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size() - 1));
+
+    // one framebuffer per level, each level is rendered from the one before it
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        glGenFramebuffers(1, &levels[i].fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, levels[i].fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, static_cast<GLint>(i));
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Error creating HiZEffect: Error creating framebuffer for level " << i << "\n";
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    readbackLevel = 0;
+    while (readbackLevel + 1 < levels.size() && levels[readbackLevel].width > READBACK_WIDTH) {
+        readbackLevel++;
+    }
+
+    readbackSize = 0;
+    for (std::size_t i = readbackLevel; i < levels.size(); i++) {
+        levels[i].readbackOffset = readbackSize;
+        readbackSize += static_cast<std::size_t>(levels[i].width) * static_cast<std::size_t>(levels[i].height);
+    }
+
+    for (auto& readback : readbacks) {
+        glGenBuffers(1, &readback.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(readbackSize * sizeof(float)), nullptr, GL_STREAM_READ);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void HiZEffect::createProgram() {
+    std::string vertexShaderSource = R"(
+        #version 330
+        layout(location = 0) in vec2 position;
+        layout(location = 1) in vec2 uv;
+
+        void main() {
+            gl_Position = vec4(position, 0.0, 1.0);
+        }
+    )";
+
+    std::string fragmentShaderSource = R"(
+        #version 330
+
+        // the previous level (or the depth buffer), as the only accessible level
+        uniform sampler2D source;
+        uniform ivec2 sourceSize;
+
+        out float depth;
+
+        void main() {
+            ivec2 first = 2 * ivec2(gl_FragCoord.xy);
+
+            // with an odd sized source, the last row/column also takes the texel left over
+            int countX = first.x + 3 == sourceSize.x ? 3 : 2;
+            int countY = first.y + 3 == sourceSize.y ? 3 : 2;
+
+            float farthest = 0.0;
+
+            for (int y = 0; y < countY; y++) {
+                for (int x = 0; x < countX; x++) {
+                    ivec2 texel = min(first + ivec2(x, y), sourceSize - 1);
+                    farthest = max(farthest, texelFetch(source, texel, 0).r);
+                }
+            }
+
+            depth = farthest;
+        }
+    )";
+
+    program = ShaderUtils::compile(vertexShaderSource, fragmentShaderSource);
+}
+
+void HiZEffect::build(GLuint vao, GLuint depth, const glm::mat4& viewProjection) const {
+    glUseProgram(program);
+    glBindVertexArray(vao);
+
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "source"), 0);
+
+    GLint sourceSizeLocation = glGetUniformLocation(program, "sourceSize");
+
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        if (i == 0) {
+            glBindTexture(GL_TEXTURE_2D, depth);
+            glUniform2i(sourceSizeLocation, width, height);
+        } else {
+            // restrict sampling to the previous level, the one being
+            // rendered to must not be accessible
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(i - 1));
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(i - 1));
+            glUniform2i(sourceSizeLocation, levels[i - 1].width, levels[i - 1].height);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, levels[i].fbo);
+        glViewport(0, 0, levels[i].width, levels[i].height);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size() - 1));
+
+    // the coarse levels go into a pixel buffer, the copy is queued behind
+    // the reduction and collect() maps it once the fence has passed
+    auto& readback = readbacks[nextReadback];
+    nextReadback = (nextReadback + 1) % readbacks.size();
+
+    // not collected in time, this one replaces it
+    glDeleteSync(readback.fence);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    for (std::size_t i = readbackLevel; i < levels.size(); i++) {
+        auto offset = levels[i].readbackOffset * sizeof(float);
+        glGetTexImage(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RED, GL_FLOAT, reinterpret_cast<void*>(offset));
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.viewProjection = viewProjection;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    glUseProgram(0);
+}
+
+void HiZEffect::collect() const {
+    // newest first, a finished readback makes the older ones useless
+    for (std::size_t age = 1; age <= readbacks.size(); age++) {
+        auto& readback = readbacks[(nextReadback + readbacks.size() - age) % readbacks.size()];
+
+        if (readback.fence == nullptr) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        auto size = static_cast<GLsizeiptr>(readbackSize * sizeof(float));
+        const auto* data = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+
+        if (data != nullptr) {
+            for (std::size_t i = readbackLevel; i < levels.size(); i++) {
+                auto& level = levels[i];
+                const float* first = data + level.readbackOffset;
+                level.depths.assign(first, first + static_cast<std::size_t>(level.width) * static_cast<std::size_t>(level.height));
+            }
+
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            depthViewProjection = readback.viewProjection;
+        }
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        for (std::size_t older = age; older <= readbacks.size(); older++) {
+            auto& stale = readbacks[(nextReadback + readbacks.size() - older) % readbacks.size()];
+            glDeleteSync(stale.fence);
+            stale.fence = nullptr;
+        }
+
+        return;
+    }
+}
+
+void HiZEffect::clear() const {
+    for (auto& level : levels) {
+        level.depths.clear();
+    }
+
+    for (auto& readback : readbacks) {
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+    }
+}
+
+bool HiZEffect::isOccluded(const AABB& box) const {
+    if (levels.empty() || levels[readbackLevel].depths.empty()) {
+        return false;
+    }
+
+    // screen rectangle and nearest window depth of the box's corners
+    glm::vec2 low(std::numeric_limits<float>::max());
+    glm::vec2 high(-std::numeric_limits<float>::max());
+    float nearest = 1.0f;
+
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner(
+            (i & 1) ? box.max.x : box.min.x,
+            (i & 2) ? box.max.y : box.min.y,
+            (i & 4) ? box.max.z : box.min.z
+        );
+
+        glm::vec4 clip = depthViewProjection * glm::vec4(corner, 1.0f);
+
+        // behind the eye, the projection of the box is unbounded
+        if (clip.w <= 0.0f) {
+            return false;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+
+        low = glm::min(low, glm::vec2(ndc));
+        high = glm::max(high, glm::vec2(ndc));
+        nearest = std::min(nearest, 0.5f * ndc.z + 0.5f);
+    }
+
+    glm::vec2 size(static_cast<float>(width), static_cast<float>(height));
+    glm::vec2 first = glm::clamp((0.5f * low + 0.5f) * size, glm::vec2(0.0f), size - 1.0f);
+    glm::vec2 last = glm::clamp((0.5f * high + 0.5f) * size, glm::vec2(0.0f), size - 1.0f);
+
+    // finest level where the rectangle covers at most 4 x 4 texels; pixel p
+    // lies in texel p / 2^(level + 1), the last texel takes the odd leftovers
+    std::size_t index = readbackLevel;
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    while (true) {
+        const auto& level = levels[index];
+        float scale = static_cast<float>(2 << index);
+
+        x0 = std::min(static_cast<int>(first.x / scale), level.width - 1);
+        y0 = std::min(static_cast<int>(first.y / scale), level.height - 1);
+        x1 = std::min(static_cast<int>(last.x / scale), level.width - 1);
+        y1 = std::min(static_cast<int>(last.y / scale), level.height - 1);
+
+        if ((x1 - x0 < 4 && y1 - y0 < 4) || index + 1 == levels.size()) {
+            break;
+        }
+
+        index++;
+    }
+
+    const auto& level = levels[index];
+    float farthest = 0.0f;
+
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            farthest = std::max(farthest, level.depths[static_cast<std::size_t>(y * level.width + x)]);
+        }
+    }
+
+    return nearest > farthest;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "geometry/bounds.hpp"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Hierarchical-Z pyramid over a depth texture, for occlusion culling.
+ *
+ * Level 0 is half the size of the depth texture; every texel holds the
+ * farthest depth of the texels below it, so a box whose nearest point is
+ * behind that is hidden. The coarse levels (READBACK_WIDTH wide and below)
+ * are copied into a pixel buffer after building and mapped once its fence has
+ * passed, usually the next frame, so the CPU never waits for the reduction.
+ * Boxes are tested on the CPU against the latest pyramid read back, through
+ * the view projection it was built with, at the finest level where they
+ * cover a few texels.
+ **/
+class HiZEffect {
+    public:
+        static const int READBACK_WIDTH = 128;
+        // pyramids in flight; a newer one replaces any not collected yet
+        static const std::size_t READBACK_BUFFERS = 2;
+
+        HiZEffect(int width, int height);
+
+        HiZEffect(HiZEffect&& other) = default;
+        HiZEffect& operator=(HiZEffect&& other) = default;
+
+        HiZEffect(const HiZEffect& other) = delete;
+        HiZEffect& operator=(const HiZEffect& other) = delete;
+
+        ~HiZEffect();
+
+        void initialize();
+
+        // Reduces depth (width x height window depths, seen through
+        // viewProjection) into the pyramid and starts reading back its coarse
+        // levels. Leaves the default framebuffer bound, with a width x height
+        // viewport
+        void build(GLuint vao, GLuint depth, const glm::mat4& viewProjection) const;
+
+        // Takes the newest pyramid whose readback has finished, if any,
+        // without waiting. Call before isOccluded
+        void collect() const;
+
+        // Forgets the pyramids read back and in flight
+        void clear() const;
+
+        // Whether the box is behind the depth last collected, as seen through
+        // the view projection it was built with. Boxes crossing the near
+        // plane are never occluded
+        bool isOccluded(const AABB& box) const;
+
+        GLuint getTexture() const {
+            return texture;
+        }
+    private:
+        struct Level {
+            int width = 0;
+            int height = 0;
+            GLuint fbo = 0;
+            // in floats, into the readback buffers
+            std::size_t readbackOffset = 0;
+            // farthest depths, only for the levels that are read back
+            std::vector<float> depths;
+        };
+
+        struct Readback {
+            GLuint buffer = 0;
+            // passed once the copy into buffer is done; null when collected
+            GLsync fence = nullptr;
+            glm::mat4 viewProjection = glm::mat4(1.0f);
+        };
+
+        int width;
+        int height;
+
+        GLuint texture = 0;
+        GLuint program = 0;
+
+        mutable std::vector<Level> levels;
+        // first level that is read back
+        std::size_t readbackLevel = 0;
+        // floats per readback, all the levels read back
+        std::size_t readbackSize = 0;
+
+        mutable std::array<Readback, READBACK_BUFFERS> readbacks;
+        mutable std::size_t nextReadback = 0;
+        // of the depths collected
+        mutable glm::mat4 depthViewProjection = glm::mat4(1.0f);
+
+        void createLevels();
+        void createProgram();
+};
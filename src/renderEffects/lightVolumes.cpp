@@ -0,0 +1,138 @@
+#include "lightVolumes.hpp"
+
+#include "frameUniforms.hpp"
+#include "gl/shaderUtils.hpp"
+#include "light/light.hpp"
+#include "mesh.hpp"
+#include "resourceCache.hpp"
+
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+
+// of the subdivided icosahedron in assets/sphere.obj
+const float LightVolumes::MESH_INRADIUS = 0.934f;
+
+LightVolumes::~LightVolumes() {
+    glDeleteProgram(stencilProgram);
+}
+
+void LightVolumes::initialize() {
+    // only positions are read, the lamps already load it this way
+    sphere = ResourceCache::shared().getMesh("assets/sphere.obj", VertexLayout::compact());
+
+    std::string fragmentShaderSource = R"(
+        #version 330
+
+        void main() {
+        }
+    )";
+
+    stencilProgram = ShaderUtils::compile(getVertexShader(), fragmentShaderSource);
+    ShaderUtils::bindUniformBlock(stencilProgram, "Frame", FrameUniforms::BINDING);
+}
+
+std::string LightVolumes::getVertexShader() {
+    return R"(
+        #version 330
+        layout(location = 0) in vec3 position;
+
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + R"(
+
+        // eye space center, radius
+        uniform vec4 volume;
+
+        void main() {
+            gl_Position = projectionMatrix * vec4(volume.xyz + position * volume.w, 1.0);
+        }
+    )";
+}
+
+bool LightVolumes::hasVolume(const Light& light) {
+    return light.getLightInfo().position.w != 0.0f && std::isfinite(light.getRadius());
+}
+
+void LightVolumes::render(const std::vector<std::shared_ptr<Light>>& lights, const glm::mat4& viewMatrix, GLuint program) const {
+    volumeCount = 0;
+
+    auto stencilVolumeLocation = glGetUniformLocation(stencilProgram, "volume");
+    auto volumeLocation = glGetUniformLocation(program, "volume");
+    auto lightColorLocation = glGetUniformLocation(program, "lightColor");
+    auto lightAttenuationLocation = glGetUniformLocation(program, "lightAttenuation");
+    auto lightRadiusLocation = glGetUniformLocation(program, "lightRadius");
+
+    glBindVertexArray(sphere->getVertexArrayObject());
+
+    auto draw = [this]() {
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES,
+            sphere->getIndexCount(),
+            sphere->getIndexType(),
+            reinterpret_cast<const void*>(sphere->getLodOffset(0)),
+            sphere->getBaseVertex()
+        );
+    };
+
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(0xFF);
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+
+    glDepthMask(GL_FALSE);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    for (const auto& light : lights) {
+        auto lightInfo = light->getLightInfo();
+        if (!lightInfo.enabled || !hasVolume(*light)) {
+            continue;
+        }
+
+        float radius = light->getRadius();
+        glm::vec4 volume(glm::vec3(viewMatrix * lightInfo.position), radius / MESH_INRADIUS);
+
+        // 1. mark the pixels whose surface is inside the sphere
+        glUseProgram(stencilProgram);
+        glUniform4fv(stencilVolumeLocation, 1, glm::value_ptr(volume));
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+
+        draw();
+
+        // 2. light them; back faces cover the whole sphere on screen, also
+        // from inside it, and reset the stencil behind them
+        glUseProgram(program);
+        glUniform4fv(volumeLocation, 1, glm::value_ptr(volume));
+        glUniform3fv(lightColorLocation, 1, glm::value_ptr(lightInfo.color * lightInfo.intensity));
+        glUniform1f(lightAttenuationLocation, lightInfo.attenuation);
+        glUniform1f(lightRadiusLocation, radius);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+
+        glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+
+        draw();
+
+        volumeCount++;
+    }
+
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glCullFace(GL_BACK);
+    glEnable(GL_CULL_FACE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glUseProgram(0);
+}
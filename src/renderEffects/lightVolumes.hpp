@@ -0,0 +1,76 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Light;
+class Mesh;
+
+/**
+ * Draws point and spot lights as spheres over their range (see
+ * Light::getRadius), so a deferred lighting pass only shades the pixels a
+ * light can reach rather than the whole screen per light. Spot lights get
+ * the sphere around their full range, their cone is not used for shading
+ * either.
+ *
+ * Each light takes two draws of assets/sphere.obj into a framebuffer holding
+ * the scene depth and a stencil buffer:
+ * 1. stencil only, both faces, depth tested: back faces behind the scene
+ *   increment, front faces behind it decrement, leaving non-zero only where
+ *   the surface is inside the sphere. Front faces clipped by the near plane
+ *   (the camera inside the sphere) don't decrement, which is still right
+ * 2. back faces with the lighting program where the stencil is set, added to
+ *   the color, clearing the stencil for the next light
+ *
+ * Directional lights, lights without attenuation and the ambient terms stay
+ * in the full screen pass.
+ **/
+class LightVolumes {
+    public:
+        // Distance of the sphere mesh's faces from its center (its vertices
+        // are at 1); volumes are scaled up by its inverse to cover the range
+        static const float MESH_INRADIUS;
+
+        LightVolumes() = default;
+
+        LightVolumes(LightVolumes&& other) = delete;
+        LightVolumes& operator=(LightVolumes&& other) = delete;
+
+        LightVolumes(const LightVolumes& other) = delete;
+        LightVolumes& operator=(const LightVolumes& other) = delete;
+
+        ~LightVolumes();
+
+        void initialize();
+
+        // Vertex shader of the lighting programs: places the sphere from
+        // uniform vec4 volume (eye space center, radius), with the Frame block
+        static std::string getVertexShader();
+
+        // Whether the light is drawn as a volume rather than in the full
+        // screen pass
+        static bool hasVolume(const Light& light);
+
+        // Draws the volumes of the lights into the bound framebuffer. program
+        // is a lighting program built on getVertexShader, shading one light
+        // from the uniforms volume, lightColor (color * intensity),
+        // lightAttenuation and lightRadius at gl_FragCoord. Leaves the default
+        // GL state
+        void render(const std::vector<std::shared_ptr<Light>>& lights, const glm::mat4& viewMatrix, GLuint program) const;
+
+        // Of the last render
+        std::size_t getVolumeCount() const {
+            return volumeCount;
+        }
+    private:
+        std::shared_ptr<Mesh> sphere = nullptr;
+        GLuint stencilProgram = 0;
+
+        mutable std::size_t volumeCount = 0;
+};
@@ -0,0 +1,107 @@
+#include "motionVectors.hpp"
+
+#include "frameUniforms.hpp"
+#include "gl/shaderUtils.hpp"
+
+#include <iostream>
+#include <string>
+
+MotionVectorsEffect::MotionVectorsEffect(int w, int h) :
+    width(w),
+    height(h)
+{}
+
+MotionVectorsEffect::~MotionVectorsEffect() {
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &texture);
+
+    glDeleteProgram(program);
+}
+
+// Must call this AFTER GL/SDL have been initialized
+void MotionVectorsEffect::initialize() {
+    createGLObjects();
+    createProgram();
+}
+
+void MotionVectorsEffect::createGLObjects() {
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Error creating motion vectors: Error creating framebuffer\n";
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void MotionVectorsEffect::createProgram() {
+    std::string vertexShader = R"(
+        #version 330
+        layout(location = 0) in vec2 position;
+        layout(location = 1) in vec2 uv;
+
+        out vec2 vUv;
+
+        void main() {
+            vUv = uv;
+            gl_Position = vec4(position, 0.0, 1.0);
+        }
+    )";
+
+    std::string fragmentShader = R"(
+        #version 330
+
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::GBUFFER_DECODE) + R"(
+
+        in vec2 vUv;
+
+        out vec2 motion;
+
+        void main() {
+            vec3 position = readLit(vUv) ? readPosition(vUv) : positionFromDepth(vUv, 1.0);
+
+            vec4 previous = reprojectionMatrix * vec4(position, 1.0);
+            motion = (previous.xy / previous.w) * 0.5 + 0.5 - vUv;
+        }
+    )";
+
+    program = ShaderUtils::compile(vertexShader, fragmentShader);
+    ShaderUtils::bindUniformBlock(program, "Frame", FrameUniforms::BINDING);
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "gPosition"), 0);
+    glUniform1i(glGetUniformLocation(program, "gDepth"), 1);
+    glUseProgram(0);
+}
+
+void MotionVectorsEffect::render(GLuint vao, GLuint gPosition, GLuint gDepth) const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glUseProgram(program);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gPosition);
+
+    // only read with the compact G-buffer
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gDepth);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
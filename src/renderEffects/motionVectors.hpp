@@ -0,0 +1,46 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/**
+ * Per-pixel screen motion since the previous frame, for effects that
+ * reproject their history (see TemporalHistory): the texture coordinate a
+ * pixel's surface had last frame minus its current one (RG16F).
+ *
+ * Built from the G-buffer positions and the Frame block's
+ * reprojectionMatrix, so it captures camera motion; models are static. The
+ * background reprojects as if at the far plane.
+ **/
+class MotionVectorsEffect {
+    public:
+        MotionVectorsEffect(int width, int height);
+
+        MotionVectorsEffect(MotionVectorsEffect&& other) = delete;
+        MotionVectorsEffect& operator=(MotionVectorsEffect&& other) = delete;
+
+        MotionVectorsEffect(const MotionVectorsEffect& other) = delete;
+        MotionVectorsEffect& operator=(const MotionVectorsEffect& other) = delete;
+
+        ~MotionVectorsEffect();
+
+        void initialize();
+
+        // Reads the G-buffer through ShaderUtils::GBUFFER_DECODE, so gPosition
+        // may be 0 with the compact layout
+        void render(GLuint vao, GLuint gPosition, GLuint gDepth) const;
+
+        GLuint getTexture() const {
+            return texture;
+        }
+    private:
+        int width;
+        int height;
+
+        GLuint fbo = 0;
+        GLuint texture = 0;
+
+        GLuint program = 0;
+
+        void createGLObjects();
+        void createProgram();
+};
@@ -1,26 +1,111 @@
 #include "ssao.hpp"
 
+#include "frameUniforms.hpp"
 #include "gl/shaderUtils.hpp"
 
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <random>
+#include <string>
 
 std::uniform_real_distribution<float> randomFloat(0.0f, 1.0f);
 std::default_random_engine generator;
 
+namespace {
+    const char* const QUAD_VERTEX_SHADER = R"(
+        #version 330
+        layout(location = 0) in vec2 position;
+        layout(location = 1) in vec2 uv;
+
+        out vec2 vUv;
+
+        void main() {
+            vUv = uv;
+            gl_Position = vec4(position, 0.0, 1.0);
+        }
+    )";
+
+    // Creates a nearest filtered, edge clamped texture and attaches it to the
+    // bound framebuffer
+    GLuint createTarget(GLenum internalFormat, GLenum format, GLenum type, GLenum attachment, int width, int height) {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+
+        return texture;
+    }
+
+    // Binds the G-buffer to units 0, 1 and 3, see the sampler assignments in
+    // SSAOEffect::createProgram
+    void bindGBuffer(GLuint gPosition, GLuint gNormal, GLuint gDepth) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, gPosition);
+
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gNormal);
+
+        // only read with the compact G-buffer
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, gDepth);
+    }
+
+    void assignSampler(GLuint program, const char* name, GLint unit) {
+        glUniform1i(glGetUniformLocation(program, name), unit);
+    }
+
+    int getDivisor(SSAOResolution resolution) {
+        switch (resolution) {
+            case SSAOResolution::half:
+                return 2;
+            case SSAOResolution::quarter:
+                return 4;
+            default:
+                return 1;
+        }
+    }
+
+    const char* getName(SSAOResolution resolution) {
+        switch (resolution) {
+            case SSAOResolution::half:
+                return "half";
+            case SSAOResolution::quarter:
+                return "quarter";
+            default:
+                return "full";
+        }
+    }
+}
+
 SSAOEffect::SSAOEffect(int w, int h) :
     width(w),
     height(h),
-    blurEffect(w, h)
+    blurEffect(w, h),
+    history(w, h, GL_R16F)
 {}
 
 SSAOEffect::~SSAOEffect() {
+    releaseReducedTargets();
+
     glDeleteTextures(1, &ambientOcclusionTexture);
     glDeleteTextures(1, &kernelNoiseTexture);
     glDeleteFramebuffers(1, &fbo);
 
     glDeleteProgram(program);
+    glDeleteProgram(reducedProgram);
+    glDeleteProgram(downsampleProgram);
+    glDeleteProgram(bilateralBlurProgram);
+    glDeleteProgram(upsampleProgram);
     glDeleteProgram(debugProgram);
 }
 
@@ -30,9 +115,120 @@ void SSAOEffect::initialize() {
     constructKernel();
     constructKernelNoise();
     createProgram();
+    createReducedPrograms();
     createDebugProgram();
 
     blurEffect.initialize();
+    history.initialize();
+    timer.initialize();
+
+    if (resolution != SSAOResolution::full) {
+        createReducedTargets();
+    }
+}
+
+void SSAOEffect::setResolution(SSAOResolution r) {
+    if (r == resolution) {
+        return;
+    }
+
+    resolution = r;
+    history.reset();
+
+    releaseReducedTargets();
+    if (resolution != SSAOResolution::full) {
+        createReducedTargets();
+    }
+
+    std::cout << "SSAO at " << getName(resolution) << " resolution ("
+        << width / getDivisor(resolution) << "x" << height / getDivisor(resolution) << ")\n";
+}
+
+void SSAOEffect::toggleTemporal(bool value) {
+    temporalEnabled = value;
+    history.reset();
+
+    for (auto p : { program, reducedProgram }) {
+        glUseProgram(p);
+        glUniform1f(glGetUniformLocation(p, "temporalEnabled"), value ? 1.0f : 0.0f);
+    }
+    glUseProgram(0);
+}
+
+void SSAOEffect::setSampleCount(int count) {
+    sampleCount = std::clamp(count, 1, static_cast<int>(kernel.size()));
+
+    for (auto p : { program, reducedProgram }) {
+        glUseProgram(p);
+        glUniform1i(glGetUniformLocation(p, "samplesToUse"), sampleCount);
+    }
+    glUseProgram(0);
+
+    std::cout << "SSAO samples: " << sampleCount << "\n";
+}
+
+void SSAOEffect::createReducedTargets() {
+    int divisor = getDivisor(resolution);
+    // round up so the reduced texels cover every pixel
+    reduced.width = (width + divisor - 1) / divisor;
+    reduced.height = (height + divisor - 1) / divisor;
+
+    glGenFramebuffers(1, &reduced.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, reduced.fbo);
+    reduced.depthTexture = createTarget(GL_R32F, GL_RED, GL_FLOAT, GL_COLOR_ATTACHMENT0, reduced.width, reduced.height);
+    reduced.normalTexture = createTarget(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, GL_COLOR_ATTACHMENT1, reduced.width, reduced.height);
+
+    std::array<GLenum, 2> drawbuffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(static_cast<GLsizei>(drawbuffers.size()), drawbuffers.data());
+
+    glGenFramebuffers(1, &reduced.occlusionFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, reduced.occlusionFbo);
+    reduced.occlusionTexture = createTarget(GL_R8, GL_RED, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, reduced.width, reduced.height);
+
+    glGenFramebuffers(1, &reduced.blurFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, reduced.blurFbo);
+    reduced.blurTexture = createTarget(GL_R8, GL_RED, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, reduced.width, reduced.height);
+
+    glGenFramebuffers(1, &upsampleFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, upsampleFbo);
+    upsampledTexture = createTarget(GL_R8, GL_RED, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0, width, height);
+
+    for (auto target : { reduced.fbo, reduced.occlusionFbo, reduced.blurFbo, upsampleFbo }) {
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Error creating SSAO: Error creating reduced resolution framebuffers\n";
+            break;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // the noise tiles over the reduced buffer
+    glUseProgram(reducedProgram);
+    glUniform1f(glGetUniformLocation(reducedProgram, "width"), reduced.width);
+    glUniform1f(glGetUniformLocation(reducedProgram, "height"), reduced.height);
+
+    glUseProgram(downsampleProgram);
+    glUniform1i(glGetUniformLocation(downsampleProgram, "divisor"), divisor);
+
+    glUseProgram(0);
+}
+
+void SSAOEffect::releaseReducedTargets() {
+    glDeleteTextures(1, &reduced.depthTexture);
+    glDeleteTextures(1, &reduced.normalTexture);
+    glDeleteTextures(1, &reduced.occlusionTexture);
+    glDeleteTextures(1, &reduced.blurTexture);
+    glDeleteTextures(1, &upsampledTexture);
+
+    glDeleteFramebuffers(1, &reduced.fbo);
+    glDeleteFramebuffers(1, &reduced.occlusionFbo);
+    glDeleteFramebuffers(1, &reduced.blurFbo);
+    glDeleteFramebuffers(1, &upsampleFbo);
+
+    reduced = {};
+    upsampledTexture = 0;
+    upsampleFbo = 0;
 }
 
 void SSAOEffect::createGLObjects() {
@@ -99,43 +295,65 @@ void SSAOEffect::constructKernelNoise() {
 }
 
 void SSAOEffect::createProgram() {
-    std::string vertexShader = R"(
-        #version 330
-        layout(location = 0) in vec2 position;
-        layout(location = 1) in vec2 uv;
-
-        out vec2 vUv;
-
-        void main() {
-            vUv = uv;
-            gl_Position = vec4(position, 0.0, 1.0);
-        }
-    )";
-
     std::string fragmentShader = R"(
         #version 330
 
         const int numSamples = 64;
 
-        // scene is an hdr, floating point texture
-        uniform sampler2D gPosition;
-        uniform sampler2D gNormal;
         uniform sampler2D noise;
 
         uniform vec3 samples[numSamples];
 
-        uniform mat4 projectionMatrix;
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::GBUFFER_DECODE) + R"(
+
+    #ifdef REDUCED_RESOLUTION
+        // point sampled from the G-buffer by the downsample program
+        uniform sampler2D reducedDepth;
+        uniform sampler2D reducedNormal;
+
+        float surfaceDepth(vec2 uv) {
+            return texture(reducedDepth, uv).r;
+        }
+
+        vec3 surfacePosition(vec2 uv) {
+            // along the ray through the texel, out to its depth
+            vec4 ray = inverseProjectionMatrix * vec4(uv * 2.0 - 1.0, 1.0, 1.0);
+            return ray.xyz / ray.z * surfaceDepth(uv);
+        }
+
+        vec3 surfaceNormal(vec2 uv) {
+            return normalize(texture(reducedNormal, uv).xyz * 2.0 - 1.0);
+        }
+    #else
+        float surfaceDepth(vec2 uv) {
+            return readPosition(uv).z;
+        }
+
+        vec3 surfacePosition(vec2 uv) {
+            return readPosition(uv);
+        }
+
+        vec3 surfaceNormal(vec2 uv) {
+            return readNormal(uv);
+        }
+    #endif
 
+        // of the target, the noise tiles over it
         uniform float width;
         uniform float height;
 
-        // Adjust to use only a subset of the samples.
+        // Adjust to use only a subset of the samples, spread over the
+        // kernel (whose samples grow with their index).
         // default = numSamples
         uniform int samplesToUse;
         // multiplier on kernel size. 1.0f by default.
         uniform float radius;
         // bias to use when testing for occlusion
         uniform float bias;
+        // vary the kernel per frame, for TemporalHistory to accumulate
+        uniform float temporalEnabled;
+
+        const float GOLDEN_ANGLE = 2.39996323;
 
         in vec2 vUv;
 
@@ -144,19 +362,31 @@ void SSAOEffect::createProgram() {
         void main() {
             vec2 noiseScale = vec2(width / 4.0, height / 4.0);
 
-            vec3 position = texture(gPosition, vUv).xyz;
-            vec3 normal = texture(gNormal, vUv).xyz;
+            vec3 position = surfacePosition(vUv);
+            vec3 normal = surfaceNormal(vUv);
             vec3 randomVec = texture(noise, vUv * noiseScale).xyz;
 
             vec3 v1 = normalize(randomVec - normal * dot(randomVec, normal));
             vec3 v2 = cross(normal, v1);
+
+            // a new rotation about the normal every frame, and a new subset
+            // of the kernel until every sample has been used
+            int firstSample = 0;
+            if (temporalEnabled > 0.5) {
+                float angle = float(frameIndex % 1024u) * GOLDEN_ANGLE;
+                v1 = cos(angle) * v1 + sin(angle) * v2;
+                v2 = cross(normal, v1);
+
+                firstSample = int(frameIndex % uint(max(numSamples / samplesToUse, 1)));
+            }
+
             mat3 sampleBasis =  mat3(v1, v2, normal);
 
             float occlusion = 0.0;
             for (int i = 0; i < samplesToUse; i++) {
                 // convert the sample from tangent space to
                 // world (view in this case) space
-                vec3 sample = sampleBasis * samples[i];
+                vec3 sample = sampleBasis * samples[firstSample + i * numSamples / samplesToUse];
 
                 sample = position + sample * radius;
 
@@ -170,7 +400,7 @@ void SSAOEffect::createProgram() {
                 // get the (stored) depth of the fragment corresponding
                 // to the sample position. Since this is in eyespace,
                 // depth = z component
-                float sampleDepth = texture(gPosition, offset.xy).z;
+                float sampleDepth = surfaceDepth(offset.xy);
                 // put less weight on samples with depths significantly outside of the sample radius
                 float rangeCheck = smoothstep(0.0, 1.0, radius / abs(position.z - sampleDepth));
                 occlusion += (sampleDepth >= sample.z + bias ? 1.0 : 0.0) * rangeCheck;
@@ -183,15 +413,10 @@ void SSAOEffect::createProgram() {
         }
     )";
 
-    program = ShaderUtils::compile(vertexShader, fragmentShader);
-
-    glUseProgram(program);
-    glUniform1f(glGetUniformLocation(program, "width"), width);
-    glUniform1f(glGetUniformLocation(program, "height"), height);
-    glUniform1f(glGetUniformLocation(program, "radius"), 0.5f);
-    glUniform1f(glGetUniformLocation(program, "bias"), 0.025f);
+    program = ShaderUtils::compile(QUAD_VERTEX_SHADER, fragmentShader);
+    reducedProgram = ShaderUtils::compile(QUAD_VERTEX_SHADER, ShaderUtils::addDefine(fragmentShader, "REDUCED_RESOLUTION"));
 
-    glUniform1i(glGetUniformLocation(program, "samplesToUse"), kernel.size());
+    sampleCount = static_cast<int>(kernel.size());
 
     std::vector<float> flatKernel(kernel.size() * 3);
 
@@ -201,8 +426,175 @@ void SSAOEffect::createProgram() {
         flatKernel[i * 3 + 2] = kernel[i].z;
     }
 
-    glUniform3fv(glGetUniformLocation(program, "samples"), kernel.size(), flatKernel.data());
-    glUniformMatrix4fv(glGetUniformLocation(program, "projectionMatrix"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    for (auto p : { program, reducedProgram }) {
+        ShaderUtils::bindUniformBlock(p, "Frame", FrameUniforms::BINDING);
+
+        glUseProgram(p);
+        glUniform1f(glGetUniformLocation(p, "width"), width);
+        glUniform1f(glGetUniformLocation(p, "height"), height);
+        glUniform1f(glGetUniformLocation(p, "radius"), 0.5f);
+        glUniform1f(glGetUniformLocation(p, "bias"), 0.025f);
+        glUniform1f(glGetUniformLocation(p, "temporalEnabled"), 0.0f);
+
+        glUniform1i(glGetUniformLocation(p, "samplesToUse"), sampleCount);
+        glUniform3fv(glGetUniformLocation(p, "samples"), kernel.size(), flatKernel.data());
+
+        assignSampler(p, "gPosition", 0);
+        assignSampler(p, "gNormal", 1);
+        assignSampler(p, "noise", 2);
+        assignSampler(p, "gDepth", 3);
+        assignSampler(p, "reducedDepth", 4);
+        assignSampler(p, "reducedNormal", 5);
+    }
+
+    glUseProgram(0);
+}
+
+void SSAOEffect::createReducedPrograms() {
+    std::string downsampleShader = R"(
+        #version 330
+
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::GBUFFER_DECODE) + R"(
+
+        // full resolution pixels per reduced texel, along each axis
+        uniform int divisor;
+
+        layout(location = 0) out float depth;
+        layout(location = 1) out vec4 normal;
+
+        void main() {
+            // the pixel nearest the texel's center; an actual surface, where
+            // averaging would make one up across edges
+            ivec2 size = textureSize(gNormal, 0);
+            ivec2 pixel = min(ivec2(gl_FragCoord.xy) * divisor + divisor / 2, size - 1);
+            vec2 uv = (vec2(pixel) + 0.5) / vec2(size);
+
+            depth = readPosition(uv).z;
+            normal = vec4(readNormal(uv) * 0.5 + 0.5, 1.0);
+        }
+    )";
+
+    downsampleProgram = ShaderUtils::compile(QUAD_VERTEX_SHADER, downsampleShader);
+    ShaderUtils::bindUniformBlock(downsampleProgram, "Frame", FrameUniforms::BINDING);
+
+    std::string bilateralBlurShader = R"(
+        #version 330
+
+        uniform sampler2D ambientOcclusion;
+        uniform sampler2D reducedDepth;
+
+        // one texel along x or y
+        uniform ivec2 direction;
+
+        const int RADIUS = 4;
+        const float SIGMA = 2.0;
+        // depth difference, relative to the depth, at which a tap's weight
+        // drops by 1/e
+        const float DEPTH_TOLERANCE = 0.05;
+
+        out float fragColor;
+
+        void main() {
+            ivec2 texel = ivec2(gl_FragCoord.xy);
+            ivec2 last = textureSize(ambientOcclusion, 0) - 1;
+
+            float depth = texelFetch(reducedDepth, texel, 0).r;
+            float tolerance = max(abs(depth), 0.001) * DEPTH_TOLERANCE;
+
+            float sum = 0.0;
+            float weights = 0.0;
+            for (int i = -RADIUS; i <= RADIUS; i++) {
+                ivec2 tap = clamp(texel + direction * i, ivec2(0), last);
+
+                float difference = (texelFetch(reducedDepth, tap, 0).r - depth) / tolerance;
+                float weight = exp(-0.5 * float(i * i) / (SIGMA * SIGMA) - difference * difference);
+
+                sum += texelFetch(ambientOcclusion, tap, 0).r * weight;
+                weights += weight;
+            }
+
+            // the center tap weighs 1
+            fragColor = sum / weights;
+        }
+    )";
+
+    bilateralBlurProgram = ShaderUtils::compile(QUAD_VERTEX_SHADER, bilateralBlurShader);
+
+    std::string upsampleShader = R"(
+        #version 330
+
+    )" + std::string(ShaderUtils::FRAME_BLOCK) + std::string(ShaderUtils::OCTAHEDRAL_DECODE) + std::string(ShaderUtils::GBUFFER_DECODE) + R"(
+
+        uniform sampler2D ambientOcclusion;
+        uniform sampler2D reducedDepth;
+        uniform sampler2D reducedNormal;
+
+        // as in the blur
+        const float DEPTH_TOLERANCE = 0.05;
+        const float NORMAL_POWER = 8.0;
+        // keeps bilinear filtering where no tap matches the surface
+        const float MIN_WEIGHT = 0.001;
+
+        in vec2 vUv;
+
+        out float fragColor;
+
+        void main() {
+            ivec2 size = textureSize(ambientOcclusion, 0);
+
+            // the 2x2 reduced texels bilinear filtering would blend
+            vec2 coordinate = vUv * vec2(size) - 0.5;
+            ivec2 base = ivec2(floor(coordinate));
+            vec2 f = coordinate - floor(coordinate);
+
+            float depth = readPosition(vUv).z;
+            vec3 normal = readNormal(vUv);
+            float tolerance = max(abs(depth), 0.001) * DEPTH_TOLERANCE;
+
+            float sum = 0.0;
+            float weights = 0.0;
+            for (int y = 0; y < 2; y++) {
+                for (int x = 0; x < 2; x++) {
+                    ivec2 tap = clamp(base + ivec2(x, y), ivec2(0), size - 1);
+
+                    vec2 bilinear = mix(1.0 - f, f, vec2(x, y));
+
+                    float difference = (texelFetch(reducedDepth, tap, 0).r - depth) / tolerance;
+                    vec3 tapNormal = texelFetch(reducedNormal, tap, 0).xyz * 2.0 - 1.0;
+                    float similarity = exp(-difference * difference) * pow(max(dot(normal, tapNormal), 0.0), NORMAL_POWER);
+
+                    float weight = bilinear.x * bilinear.y * max(similarity, MIN_WEIGHT);
+
+                    sum += texelFetch(ambientOcclusion, tap, 0).r * weight;
+                    weights += weight;
+                }
+            }
+
+            fragColor = sum / weights;
+        }
+    )";
+
+    upsampleProgram = ShaderUtils::compile(QUAD_VERTEX_SHADER, upsampleShader);
+    ShaderUtils::bindUniformBlock(upsampleProgram, "Frame", FrameUniforms::BINDING);
+
+    // units as in the occlusion programs, the occlusion being filtered on 6
+    glUseProgram(downsampleProgram);
+    assignSampler(downsampleProgram, "gPosition", 0);
+    assignSampler(downsampleProgram, "gNormal", 1);
+    assignSampler(downsampleProgram, "gDepth", 3);
+
+    glUseProgram(bilateralBlurProgram);
+    assignSampler(bilateralBlurProgram, "reducedDepth", 4);
+    assignSampler(bilateralBlurProgram, "ambientOcclusion", 6);
+
+    glUseProgram(upsampleProgram);
+    assignSampler(upsampleProgram, "gPosition", 0);
+    assignSampler(upsampleProgram, "gNormal", 1);
+    assignSampler(upsampleProgram, "gDepth", 3);
+    assignSampler(upsampleProgram, "reducedDepth", 4);
+    assignSampler(upsampleProgram, "reducedNormal", 5);
+    assignSampler(upsampleProgram, "ambientOcclusion", 6);
+
     glUseProgram(0);
 }
 
@@ -238,14 +630,35 @@ void SSAOEffect::createDebugProgram() {
     debugProgram = ShaderUtils::compile(vertexShader, fragmentShader);
 }
 
-void SSAOEffect::setProjectionMatrix(const glm::mat4& projectionMatrix) const {
-    glUseProgram(program);
-    auto viewMatrixLocation = glGetUniformLocation(program, "projectionMatrix");
-    glUniformMatrix4fv(viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
-    glUseProgram(0);
+void SSAOEffect::render(GLuint vao, GLuint gPosition, GLuint gNormal, GLuint gDepth, GLuint motion) const {
+    timer.begin();
+
+    bindGBuffer(gPosition, gNormal, gDepth);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, kernelNoiseTexture);
+
+    glBindVertexArray(vao);
+
+    if (resolution == SSAOResolution::full) {
+        renderFull(vao);
+    } else {
+        renderReduced();
+    }
+
+    if (temporalEnabled) {
+        history.resolve(vao, getDenoisedTexture(), motion);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    timer.end();
+
+    // Now getAmbientOcculsionTexture() holds the denoised, full resolution
+    // ambient occlusion and is ready for the lighting pass
 }
 
-void SSAOEffect::render(GLuint vao, GLuint gPosition, GLuint gNormal) const {
+void SSAOEffect::renderFull(GLuint vao) const {
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
     glClearColor(0.0, 0.0, 0.0, 0.0);
@@ -253,33 +666,57 @@ void SSAOEffect::render(GLuint vao, GLuint gPosition, GLuint gNormal) const {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     glUseProgram(program);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glUseProgram(0);
 
-    // bind the position texture to texture slot 0
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glUniform1i(glGetUniformLocation(program, "gPosition"), 0);
+    // blur the ambientOcclusionTexture
+    blurEffect.render(vao, ambientOcclusionTexture);
+}
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glUniform1i(glGetUniformLocation(program, "gNormal"), 1);
+// Every pass covers its whole target, so none is cleared
+void SSAOEffect::renderReduced() const {
+    glViewport(0, 0, reduced.width, reduced.height);
 
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, kernelNoiseTexture);
-    glUniform1i(glGetUniformLocation(program, "noise"), 2);
+    // 1. depth and normal at the reduced resolution
+    glBindFramebuffer(GL_FRAMEBUFFER, reduced.fbo);
+    glUseProgram(downsampleProgram);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    glBindVertexArray(vao);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, reduced.depthTexture);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, reduced.normalTexture);
+
+    // 2. occlusion from them
+    glBindFramebuffer(GL_FRAMEBUFFER, reduced.occlusionFbo);
+    glUseProgram(reducedProgram);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    glUseProgram(0);
+    // 3. the separable blur, horizontally into the blur target and
+    // vertically back
+    auto directionLocation = glGetUniformLocation(bilateralBlurProgram, "direction");
+    glUseProgram(bilateralBlurProgram);
+    glActiveTexture(GL_TEXTURE6);
 
-    // blur the ambientOcclusionTexture
-    blurEffect.render(vao, ambientOcclusionTexture);
+    glBindFramebuffer(GL_FRAMEBUFFER, reduced.blurFbo);
+    glBindTexture(GL_TEXTURE_2D, reduced.occlusionTexture);
+    glUniform2i(directionLocation, 1, 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, reduced.occlusionFbo);
+    glBindTexture(GL_TEXTURE_2D, reduced.blurTexture);
+    glUniform2i(directionLocation, 0, 1);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    // 4. back to full resolution, guided by the G-buffer
+    glViewport(0, 0, width, height);
 
-    // Now ambientOcclusionTexture contains the ambient occlusion,
-    // and blurEffect's result contains the blurred texture
-    // and is ready for the lighting pass
+    glBindFramebuffer(GL_FRAMEBUFFER, upsampleFbo);
+    glBindTexture(GL_TEXTURE_2D, reduced.occlusionTexture);
+    glUseProgram(upsampleProgram);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glUseProgram(0);
 }
 
 // render the ambient occlusion texture to the screen
@@ -291,7 +728,7 @@ void SSAOEffect::renderDebug(GLuint vao) const {
     glUseProgram(debugProgram);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, blurEffect.getResult());
+    glBindTexture(GL_TEXTURE_2D, getAmbientOcculsionTexture());
     glUniform1i(glGetUniformLocation(debugProgram, "ambientOcclusion"), 0);
 
     glBindVertexArray(vao);
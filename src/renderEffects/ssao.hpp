@@ -1,64 +1,154 @@
 #pragma once
 
 #include "blur.hpp"
+#include "gl/gpuTimer.hpp"
+#include "temporalHistory.hpp"
 
 #include <array>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <vector>
 
+/**
+ * Size of the buffer the ambient occlusion is computed at.
+ *
+ * full: from the G-buffer, box blurred (BlurEffect)
+ * half, quarter: from a point sampled copy of the G-buffer's eye space
+ *   depth and normal, denoised with a separable blur weighted by depth
+ *   differences, then brought back to full resolution with a joint
+ *   bilateral upsample (bilinear weights times depth and normal similarity
+ *   to the full resolution pixel), so occlusion does not bleed over edges
+ **/
+enum class SSAOResolution {
+    full,
+    half,
+    quarter
+};
+
 class SSAOEffect {
     public:
         SSAOEffect(int width, int height);
 
-        SSAOEffect(SSAOEffect&& other) = default;
-        SSAOEffect& operator=(SSAOEffect&& other) = default;
+        SSAOEffect(SSAOEffect&& other) = delete;
+        SSAOEffect& operator=(SSAOEffect&& other) = delete;
 
-        SSAOEffect(const SSAOEffect& other) = default;
-        SSAOEffect& operator=(const SSAOEffect& other) = default;
+        SSAOEffect(const SSAOEffect& other) = delete;
+        SSAOEffect& operator=(const SSAOEffect& other) = delete;
 
         ~SSAOEffect();
 
         void initialize();
 
-        void render(GLuint vao, GLuint gPosition, GLuint gNormal) const;
+        // Reads the G-buffer through ShaderUtils::GBUFFER_DECODE, so gPosition
+        // may be 0 with the compact layout. motion (see MotionVectorsEffect)
+        // is only read while temporal. Sets the viewport to the full size
+        void render(GLuint vao, GLuint gPosition, GLuint gNormal, GLuint gDepth, GLuint motion) const;
 
         void renderDebug(GLuint vao) const;
 
-        void setProjectionMatrix(
-            const glm::mat4& projectionMatrix
-        ) const;
+        void setResolution(SSAOResolution resolution);
+
+        // Rotates the kernel and moves through its samples every frame and
+        // accumulates the denoised result in a TemporalHistory, so a few
+        // samples per frame add up to the whole kernel
+        void toggleTemporal(bool value);
+
+        SSAOResolution getResolution() const {
+            return resolution;
+        }
+
+        // Kernel samples per pixel, clamped to 1..64; fewer samples still
+        // span the whole kernel radius
+        void setSampleCount(int count);
+
+        int getSampleCount() const {
+            return sampleCount;
+        }
+
+        // GPU time of render, a couple of frames behind
+        float getMilliseconds() const {
+            return timer.getMilliseconds();
+        }
 
         GLuint getFramebuffer() const {
             return fbo;
         }
 
+        // At the current resolution; before the blur at full resolution,
+        // reduced resolutions are blurred in place
         GLuint getRawAmbientOcculsionTexture() const {
-            return ambientOcclusionTexture;
+            return resolution == SSAOResolution::full ? ambientOcclusionTexture : reduced.occlusionTexture;
         }
 
+        // Always full resolution
         GLuint getAmbientOcculsionTexture() const {
-            return blurEffect.getResult();
+            return temporalEnabled ? history.getResult() : getDenoisedTexture();
         }
     private:
         int width;
         int height;
 
+        SSAOResolution resolution = SSAOResolution::full;
+        int sampleCount = 0;
+        bool temporalEnabled = false;
+
         GLuint fbo = 0;
         GLuint ambientOcclusionTexture = 0;
 
         BlurEffect blurEffect;
 
+        // only while the resolution is reduced
+        struct {
+            int width = 0;
+            int height = 0;
+
+            // G-buffer copy: eye space z (R32F), normal * 0.5 + 0.5 (RGB10_A2)
+            GLuint fbo = 0;
+            GLuint depthTexture = 0;
+            GLuint normalTexture = 0;
+
+            // occlusion, and the vertical blur pass writes back into it
+            GLuint occlusionFbo = 0;
+            GLuint occlusionTexture = 0;
+
+            // after the horizontal blur pass
+            GLuint blurFbo = 0;
+            GLuint blurTexture = 0;
+        } reduced;
+
+        GLuint upsampleFbo = 0;
+        GLuint upsampledTexture = 0;
+
+        TemporalHistory history;
+
         std::vector<glm::vec3> kernel = {};
 
         GLuint kernelNoiseTexture = 0;
 
         GLuint program = 0;
+        GLuint reducedProgram = 0;
+        GLuint downsampleProgram = 0;
+        GLuint bilateralBlurProgram = 0;
+        GLuint upsampleProgram = 0;
         GLuint debugProgram = 0;
 
+        GPUTimer timer;
+
         void createGLObjects();
         void constructKernel();
         void constructKernelNoise();
         void createProgram();
+        void createReducedPrograms();
         void createDebugProgram();
+
+        void createReducedTargets();
+        void releaseReducedTargets();
+
+        // Full resolution, before the history
+        GLuint getDenoisedTexture() const {
+            return resolution == SSAOResolution::full ? blurEffect.getResult() : upsampledTexture;
+        }
+
+        void renderFull(GLuint vao) const;
+        void renderReduced() const;
 };
@@ -0,0 +1,149 @@
+#include "temporalHistory.hpp"
+
+#include "gl/shaderUtils.hpp"
+
+#include <iostream>
+#include <string>
+
+TemporalHistory::TemporalHistory(int w, int h, GLenum format, float f) :
+    width(w),
+    height(h),
+    internalFormat(format),
+    feedback(f)
+{}
+
+TemporalHistory::~TemporalHistory() {
+    glDeleteFramebuffers(static_cast<GLsizei>(fbos.size()), fbos.data());
+    glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+
+    glDeleteProgram(program);
+}
+
+// Must call this AFTER GL/SDL have been initialized
+void TemporalHistory::initialize() {
+    createGLObjects();
+    createProgram();
+}
+
+void TemporalHistory::createGLObjects() {
+    glGenFramebuffers(static_cast<GLsizei>(fbos.size()), fbos.data());
+    glGenTextures(static_cast<GLsizei>(textures.size()), textures.data());
+
+    for (std::size_t i = 0; i < textures.size(); i++) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        // the format and type only matter for the (absent) initial data
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+        // reprojected coordinates fall between texels
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Error creating temporal history: Error creating framebuffer\n";
+            break;
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void TemporalHistory::createProgram() {
+    std::string vertexShader = R"(
+        #version 330
+        layout(location = 0) in vec2 position;
+        layout(location = 1) in vec2 uv;
+
+        out vec2 vUv;
+
+        void main() {
+            vUv = uv;
+            gl_Position = vec4(position, 0.0, 1.0);
+        }
+    )";
+
+    std::string fragmentShader = R"(
+        #version 330
+
+        uniform sampler2D current;
+        uniform sampler2D history;
+        uniform sampler2D motion;
+
+        // weight of the history, 0 while there is none
+        uniform float feedback;
+
+        in vec2 vUv;
+
+        out vec4 fragColor;
+
+        void main() {
+            ivec2 texel = ivec2(gl_FragCoord.xy);
+            ivec2 last = textureSize(current, 0) - 1;
+
+            vec4 value = texelFetch(current, texel, 0);
+
+            vec4 minimum = value;
+            vec4 maximum = value;
+            for (int y = -1; y <= 1; y++) {
+                for (int x = -1; x <= 1; x++) {
+                    vec4 neighbor = texelFetch(current, clamp(texel + ivec2(x, y), ivec2(0), last), 0);
+                    minimum = min(minimum, neighbor);
+                    maximum = max(maximum, neighbor);
+                }
+            }
+
+            vec2 previousUv = vUv + texture(motion, vUv).xy;
+            bool onScreen = all(greaterThanEqual(previousUv, vec2(0.0))) && all(lessThanEqual(previousUv, vec2(1.0)));
+
+            if (!onScreen || feedback == 0.0) {
+                fragColor = value;
+                return;
+            }
+
+            vec4 previous = clamp(texture(history, previousUv), minimum, maximum);
+            fragColor = mix(value, previous, feedback);
+        }
+    )";
+
+    program = ShaderUtils::compile(vertexShader, fragmentShader);
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "current"), 0);
+    glUniform1i(glGetUniformLocation(program, "history"), 1);
+    glUniform1i(glGetUniformLocation(program, "motion"), 2);
+    glUseProgram(0);
+
+    feedbackLocation = glGetUniformLocation(program, "feedback");
+}
+
+void TemporalHistory::resolve(GLuint vao, GLuint current, GLuint motion) const {
+    std::size_t next = (index + 1) % textures.size();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[next]);
+
+    glUseProgram(program);
+    glUniform1f(feedbackLocation, valid ? feedback : 0.0f);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, current);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textures[index]);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, motion);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glUseProgram(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    index = next;
+    valid = true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstddef>
+
+/**
+ * Accumulates a noisy screen-space effect over frames: each resolve blends
+ * the effect's current result with the previous resolve reprojected through
+ * MotionVectorsEffect, so an effect that varies its sampling per frame
+ * converges to many frames' worth of samples.
+ *
+ * The history is clamped to the min/max of the current result's 3x3
+ * neighborhood first, which rejects what no longer matches (disocclusions,
+ * surfaces that changed) instead of ghosting it; history reprojected from
+ * off screen is dropped.
+ *
+ * Keeps two textures of the given format and alternates between them.
+ **/
+class TemporalHistory {
+    public:
+        // feedback is the weight of the history in each resolve
+        TemporalHistory(int width, int height, GLenum internalFormat, float feedback = 0.9f);
+
+        TemporalHistory(TemporalHistory&& other) = delete;
+        TemporalHistory& operator=(TemporalHistory&& other) = delete;
+
+        TemporalHistory(const TemporalHistory& other) = delete;
+        TemporalHistory& operator=(const TemporalHistory& other) = delete;
+
+        ~TemporalHistory();
+
+        void initialize();
+
+        // Blends current (of the history's size) with the history into the
+        // other texture, which becomes the result
+        void resolve(GLuint vao, GLuint current, GLuint motion) const;
+
+        // Drops the history, the next resolve only takes the current result
+        void reset() const {
+            valid = false;
+        }
+
+        GLuint getResult() const {
+            return textures[index];
+        }
+    private:
+        int width;
+        int height;
+        GLenum internalFormat;
+        float feedback;
+
+        std::array<GLuint, 2> fbos = {};
+        std::array<GLuint, 2> textures = {};
+        mutable std::size_t index = 0;
+        mutable bool valid = false;
+
+        GLuint program = 0;
+        // set on every resolve
+        GLint feedbackLocation = -1;
+
+        void createGLObjects();
+        void createProgram();
+};
@@ -0,0 +1,192 @@
+#include "renderQueue.hpp"
+
+#include "gl/glStats.hpp"
+#include "material/material.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+    const unsigned PROGRAM_BITS = 12;
+    const unsigned MATERIAL_BITS = 14;
+    const unsigned VERTEX_ARRAY_BITS = 14;
+    const unsigned DEPTH_BITS = 24;
+
+    static_assert(PROGRAM_BITS + MATERIAL_BITS + VERTEX_ARRAY_BITS + DEPTH_BITS == 64, "sort key must fill 64 bits");
+
+    uint64_t bits(uint64_t value, unsigned count) {
+        return value & ((uint64_t(1) << count) - 1);
+    }
+
+    // Positive floats compare like their bit patterns, so the top bits of
+    // the pattern are a monotonic quantization of the depth
+    uint64_t quantizeDepth(float depth) {
+        depth = std::max(depth, 0.0f);
+
+        uint32_t pattern = 0;
+        std::memcpy(&pattern, &depth, sizeof(pattern));
+
+        return pattern >> (32 - DEPTH_BITS);
+    }
+
+    const unsigned RADIX_BITS = 8;
+    const std::size_t RADIX = std::size_t(1) << RADIX_BITS;
+    const unsigned PASSES = 64 / RADIX_BITS;
+}
+
+void MultiDraw::clear() {
+    counts.clear();
+    offsets.clear();
+    indexCount = 0;
+}
+
+void MultiDraw::add(std::size_t offset, GLsizei count, std::size_t indexSize) {
+    if (!counts.empty()) {
+        auto end = reinterpret_cast<std::size_t>(offsets.back()) + static_cast<std::size_t>(counts.back()) * indexSize;
+        if (end == offset) {
+            counts.back() += count;
+            indexCount += count;
+            return;
+        }
+    }
+
+    counts.push_back(count);
+    offsets.push_back(reinterpret_cast<const void*>(offset));
+    indexCount += count;
+}
+
+void RenderQueue::clear() {
+    packets.clear();
+    entries.clear();
+}
+
+uint64_t RenderQueue::makeKey(const DrawPacket& packet, float depth) {
+    // materials are heap allocated, the low bits are alignment
+    auto material = reinterpret_cast<uintptr_t>(packet.material) >> 4;
+
+    uint64_t key = bits(packet.program, PROGRAM_BITS);
+    key = (key << MATERIAL_BITS) | bits(material, MATERIAL_BITS);
+    key = (key << VERTEX_ARRAY_BITS) | bits(packet.vertexArray, VERTEX_ARRAY_BITS);
+    key = (key << DEPTH_BITS) | quantizeDepth(depth);
+
+    return key;
+}
+
+void RenderQueue::push(const DrawPacket& packet, float depth) {
+    entries.push_back({ makeKey(packet, depth), static_cast<uint32_t>(packets.size()) });
+    packets.push_back(packet);
+}
+
+void RenderQueue::sort() {
+    if (entries.size() < 2) {
+        return;
+    }
+
+    // LSD radix sort, one byte per pass. All histograms are built in a
+    // single sweep; passes where every key has the same byte are skipped
+    std::array<std::array<uint32_t, RADIX>, PASSES> histograms = {};
+
+    for (const auto& entry : entries) {
+        for (unsigned pass = 0; pass < PASSES; pass++) {
+            histograms[pass][(entry.key >> (pass * RADIX_BITS)) & (RADIX - 1)]++;
+        }
+    }
+
+    scratch.resize(entries.size());
+
+    for (unsigned pass = 0; pass < PASSES; pass++) {
+        auto& histogram = histograms[pass];
+        auto shift = pass * RADIX_BITS;
+
+        if (histogram[(entries.front().key >> shift) & (RADIX - 1)] == entries.size()) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto& count : histogram) {
+            auto next = offset + count;
+            count = offset;
+            offset = next;
+        }
+
+        for (const auto& entry : entries) {
+            scratch[histogram[(entry.key >> shift) & (RADIX - 1)]++] = entry;
+        }
+
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::submit() const {
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    GLenum cullFace = GL_BACK;
+    bool first = true;
+
+    GLStats::Counters& stats = GLStats::frame();
+
+    for (const auto& entry : entries) {
+        const DrawPacket& packet = packets[entry.packet];
+
+        if (first || packet.program != program) {
+            program = packet.program;
+            glUseProgram(program);
+            stats.programBinds++;
+        }
+
+        // programs are shared, so these only upload if another material used it last
+        if (packet.instanceCount > 0) {
+            packet.material->setInstancedUniforms();
+        } else {
+            packet.material->setUniforms();
+        }
+
+        if (packet.cullFace != cullFace) {
+            cullFace = packet.cullFace;
+            glCullFace(cullFace);
+            stats.cullFaceChanges++;
+        }
+
+        if (first || packet.vertexArray != vertexArray) {
+            vertexArray = packet.vertexArray;
+            glBindVertexArray(vertexArray);
+            stats.vertexArrayBinds++;
+        }
+
+        auto indices = reinterpret_cast<const void*>(packet.indexOffset);
+
+        if (packet.multiDraw != nullptr) {
+            baseVertices.assign(packet.multiDraw->counts.size(), packet.baseVertex);
+
+            glMultiDrawElementsBaseVertex(
+                GL_TRIANGLES,
+                packet.multiDraw->counts.data(),
+                packet.indexType,
+                packet.multiDraw->offsets.data(),
+                static_cast<GLsizei>(packet.multiDraw->counts.size()),
+                baseVertices.data()
+            );
+        } else if (packet.instanceCount > 0) {
+            glDrawElementsInstancedBaseVertex(
+                GL_TRIANGLES,
+                packet.indexCount,
+                packet.indexType,
+                indices,
+                packet.instanceCount,
+                packet.baseVertex
+            );
+        } else {
+            glDrawElementsBaseVertex(GL_TRIANGLES, packet.indexCount, packet.indexType, indices, packet.baseVertex);
+        }
+        stats.drawCalls++;
+        stats.triangles += static_cast<std::size_t>(packet.indexCount / 3) * static_cast<std::size_t>(std::max(packet.instanceCount, 1));
+
+        first = false;
+    }
+
+    if (cullFace != GL_BACK) {
+        glCullFace(GL_BACK);
+        stats.cullFaceChanges++;
+    }
+}
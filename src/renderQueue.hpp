@@ -0,0 +1,101 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Material;
+
+/**
+ * Ranges of an index buffer drawn with one glMultiDrawElements, e.g. the
+ * clusters of a mesh that survived culling.
+ **/
+struct MultiDraw {
+    std::vector<GLsizei> counts;
+    // in bytes, from the start of the index buffer (see Mesh::getLodOffset)
+    std::vector<const void*> offsets;
+    // sum of counts
+    GLsizei indexCount = 0;
+
+    void clear();
+
+    bool empty() const {
+        return counts.empty();
+    }
+
+    // Adds count indices from offset (in bytes), extending the last range
+    // if it ends there
+    void add(std::size_t offset, GLsizei count, std::size_t indexSize);
+};
+
+/**
+ * Everything needed to issue one draw call, without touching the model.
+ **/
+struct DrawPacket {
+    const Material* material = nullptr;
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    GLsizei indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    // in bytes, selects the mesh's level of detail
+    std::size_t indexOffset = 0;
+    // the mesh's vertices in the shared vertex buffer, see GeometryArena
+    GLint baseVertex = 0;
+    // 0 draws without instancing (and uploads the material's regular uniforms)
+    GLsizei instanceCount = 0;
+    // if set, replaces indexOffset (and sums up to indexCount); not instanced
+    const MultiDraw* multiDraw = nullptr;
+    GLenum cullFace = GL_BACK;
+};
+
+/**
+ * Collects the draw packets of a pass, sorts them by state and submits them
+ * without redundant binds.
+ *
+ * Sort key, most significant first:
+ *   program (12 bits) | material (14) | vertex array (14) | depth (24)
+ * Ids are truncated, so packets with different state may share a key; that
+ * only costs a rebind, since submit() compares the real state. Depth sorts
+ * front to back within the same state to help early z.
+ **/
+class RenderQueue {
+    public:
+        RenderQueue() = default;
+        ~RenderQueue() = default;
+
+        RenderQueue(RenderQueue&& other) = default;
+        RenderQueue(const RenderQueue& other) = default;
+
+        RenderQueue& operator=(const RenderQueue& other) = default;
+        RenderQueue& operator=(RenderQueue&& other) = default;
+
+        void clear();
+
+        // depth is the eye space distance, negative values are clamped to 0
+        void push(const DrawPacket& packet, float depth);
+
+        void sort();
+
+        // Expects GL_CULL_FACE to be GL_BACK and leaves it that way
+        void submit() const;
+
+        std::size_t size() const {
+            return packets.size();
+        }
+
+        static uint64_t makeKey(const DrawPacket& packet, float depth);
+    private:
+        struct Entry {
+            uint64_t key;
+            uint32_t packet;
+        };
+
+        std::vector<DrawPacket> packets;
+        std::vector<Entry> entries;
+        // radix sort ping-pong buffer
+        std::vector<Entry> scratch;
+        // one base vertex per range of a multi-draw
+        mutable std::vector<GLint> baseVertices;
+};
@@ -1,21 +1,34 @@
 #include "renderer.hpp"
 
 #include "camera.hpp"
+#include "geometry/meshSimplification.hpp"
+#include "gl/glStats.hpp"
 #include "gl/shaderUtils.hpp"
 #include "light/light.hpp"
 #include "material/material.hpp"
 #include "material/skybox.hpp"
 #include "material/skyboxDeferred.hpp"
+#include "mesh.hpp"
 #include "model.hpp"
 #include "renderTarget.hpp"
+#include "resourceCache.hpp"
+#include "util/matrixBatch.hpp"
+#include "util/threadPool.hpp"
 
 #include <GL/glew.h>
 
+#include <algorithm>
 #include <iostream>
 
 const GLuint GL_MAJOR = 3;
 const GLuint GL_MINOR = 3;
 
+namespace {
+    // meshlets culled per thread pool job, so single dense meshes spread
+    // over the threads too
+    const uint32_t MESHLETS_PER_JOB = 256;
+}
+
 Renderer::Renderer(int width, int height, std::unique_ptr<Camera>&& camera) :
     width(width),
     height(height),
@@ -24,7 +37,9 @@ Renderer::Renderer(int width, int height, std::unique_ptr<Camera>&& camera) :
     deferredShadingEffect(width, height),
     deferredPBREffect(width, height),
     ssaoEffect(width, height),
-    fxaaEffect(width, height)
+    motionVectors(width, height),
+    fxaaEffect(width, height),
+    hiZEffect(width, height)
 {
     std::cout << "Initializing SDL...\n";
     if (!initializeSDL()) {
@@ -40,13 +55,21 @@ Renderer::Renderer(int width, int height, std::unique_ptr<Camera>&& camera) :
 
     initializeScreenObject();
 
+    frameUniforms.initialize();
+    lightBuffer.initialize();
+    clusteredLights.initialize();
+    lightVolumes.initialize();
+    lightingTimer.initialize();
+
     sceneTarget = std::make_unique<RenderTarget>(width, height);
 
     deferredShadingEffect.initialize();
     deferredPBREffect.initialize();
     ssaoEffect.initialize();
+    motionVectors.initialize();
     bloomEffect.initialize();
     fxaaEffect.initialize();
+    hiZEffect.initialize();
 
     // composits bloom, hdr, and gammaCorrection
     // Final step before passing to fxaa
@@ -108,6 +131,10 @@ bool Renderer::initializeGL() {
         return false;
     }
 
+#ifdef COUNT_GL_CALLS
+    GLStats::countAllCalls();
+#endif
+
     if (SDL_GL_SetSwapInterval(1) < 0) {
         std::cout << "Unable to set VSync\n";
         return false;
@@ -293,17 +320,298 @@ void Renderer::initializeBaseProgram() {
 
 
 void Renderer::addModel(std::shared_ptr<Model> model) {
-    model->setProjectionAndViewMatrices(camera->getProjectionMatrix(), camera->getViewMatrix());
-    model->setLights(lights);
     models.push_back(model);
+    // item order follows the batches, which this may change
+    bvhOutdated = true;
+
+    for (auto& batch : batches) {
+        if (batch->accepts(*model)) {
+            batch->add(model);
+            return;
+        }
+    }
+
+    batches.push_back(std::make_unique<InstancedBatch>(model));
 }
 
 void Renderer::addLight(std::shared_ptr<Light> light) {
     lights.push_back(light);
+    lightBuffer.invalidate();
+}
+
+void Renderer::removeLight(const std::shared_ptr<Light>& light) {
+    lights.erase(std::remove(lights.begin(), lights.end(), light), lights.end());
+    lightBuffer.invalidate();
+}
+
+void Renderer::updateModelViewMatrices(bool cameraChanged) const {
+    changedModels.clear();
+    modelMatrices.clear();
+    movedItems.clear();
+
+    uint32_t item = 0;
+
+    for (auto& batch : batches) {
+        if (batch->isInstanced()) {
+            // world space instance data, independent of the camera
+            batch->update();
+            for (auto index : batch->getChanged()) {
+                movedItems.push_back(item + static_cast<uint32_t>(index));
+            }
+            item += static_cast<uint32_t>(batch->getModels().size());
+            continue;
+        }
+
+        for (auto& model : batch->getModels()) {
+            // always call applyModelMatrix, so the transform is picked up even
+            // if the camera moved as well
+            bool modelChanged = model->applyModelMatrix();
+            if (modelChanged) {
+                movedItems.push_back(item);
+            }
+            if (modelChanged || cameraChanged) {
+                changedModels.push_back(model.get());
+                modelMatrices.push_back(model->getModelMatrix());
+            }
+            item++;
+        }
+    }
+
+    if (changedModels.empty()) {
+        return;
+    }
+
+    modelViewMatrices.resize(changedModels.size());
+    normalMatrices.resize(changedModels.size());
+
+    MatrixBatch::computeModelView(
+        frameUniforms.getViewMatrix(),
+        modelMatrices.data(),
+        modelViewMatrices.data(),
+        normalMatrices.data(),
+        changedModels.size()
+    );
+
+    for (std::size_t i = 0; i < changedModels.size(); i++) {
+        changedModels[i]->setModelViewMatrices(modelViewMatrices[i], normalMatrices[i]);
+    }
+}
+
+void Renderer::cullModels() const {
+    if (bvhOutdated || bvh.needsRebuild()) {
+        cullItems.clear();
+        cullBoxes.clear();
+        cullSpheres.clear();
+
+        for (auto& batch : batches) {
+            for (auto& model : batch->getModels()) {
+                const auto& bounds = model->getWorldBounds();
+                cullItems.push_back(model);
+                cullBoxes.push_back(bounds.box);
+                cullSpheres.push_back(glm::vec4(bounds.sphere.center, bounds.sphere.radius));
+            }
+        }
+
+        bvh.build(cullBoxes, cullSpheres);
+        bvhOutdated = false;
+        multiDrawBatch.setModels(cullItems);
+    } else if (!movedItems.empty()) {
+        for (auto item : movedItems) {
+            const auto& bounds = cullItems[item]->getWorldBounds();
+            cullBoxes[item] = bounds.box;
+            cullSpheres[item] = glm::vec4(bounds.sphere.center, bounds.sphere.radius);
+        }
+
+        bvh.refit(cullBoxes, cullSpheres, movedItems);
+    }
+
+    visibility.assign(cullItems.size(), 0);
+    bvh.cull(frameUniforms.getFrustum(), visibility.data());
+
+    GLStats::frame().culledModels += std::count(visibility.begin(), visibility.end(), uint8_t(0));
+}
+
+void Renderer::selectLods() const {
+    const glm::mat4& viewMatrix = frameUniforms.getViewMatrix();
+    // pixels covered by a unit of size at unit distance
+    float pixelScale = 0.5f * static_cast<float>(height) * frameUniforms.getProjectionMatrix()[1][1];
+
+    for (std::size_t i = 0; i < cullItems.size(); i++) {
+        auto& model = *cullItems[i];
+        const auto& mesh = *model.getMesh();
+
+        if (!visibility[i] || mesh.getLodCount() < 2) {
+            continue;
+        }
+
+        const auto& sphere = cullSpheres[i];
+        float distance = -(viewMatrix * glm::vec4(glm::vec3(sphere), 1.0f)).z;
+
+        // full detail from inside the bounding sphere
+        std::size_t level = 0;
+
+        if (distance > sphere.w) {
+            level = MeshSimplification::selectLod(mesh.getLods(), model.getLodLevel(), sphere.w * pixelScale / distance);
+        }
+
+        model.setLodLevel(level);
+    }
+}
+
+void Renderer::cullClusters(MaterialType type) const {
+    clusterDraws.resize(cullItems.size());
+    clusterJobs.clear();
+
+    uint32_t item = 0;
+    for (auto& batch : batches) {
+        for (auto& model : batch->getModels()) {
+            clusterDraws[item].clear();
+
+            auto meshletCount = static_cast<uint32_t>(model->getMesh()->getMeshlets().size());
+            bool clustered =
+                !batch->isInstanced() &&
+                visibility[item] &&
+                model->getLodLevel() == 0 &&
+                model->getMaterial(type) != nullptr;
+
+            for (uint32_t first = 0; clustered && first < meshletCount; first += MESHLETS_PER_JOB) {
+                clusterJobs.push_back({ item, first, std::min(MESHLETS_PER_JOB, meshletCount - first) });
+            }
+
+            item++;
+        }
+    }
+
+    if (clusterJobs.empty()) {
+        return;
+    }
+
+    if (clusterJobDraws.size() < clusterJobs.size()) {
+        clusterJobDraws.resize(clusterJobs.size());
+    }
+    clusterJobCulled.assign(clusterJobs.size(), 0);
+
+    const Frustum& frustum = frameUniforms.getFrustum();
+    glm::vec3 viewPosition = frameUniforms.getViewPosition();
+
+    ThreadPool::shared().parallelFor(clusterJobs.size(), [&](std::size_t j) {
+        const auto& job = clusterJobs[j];
+        const auto& model = *cullItems[job.item];
+        const auto& mesh = *model.getMesh();
+
+        // in object space, where the meshlet bounds are
+        const glm::mat4& modelMatrix = model.getModelMatrix();
+        Frustum localFrustum = frustum.transform(modelMatrix);
+        glm::vec3 localView = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(viewPosition, 1.0f));
+
+        // back faces are drawn for the other sides
+        bool cullBackFaces = model.getMaterial(type)->getSide() == Side::FRONT;
+        std::size_t indexSize = mesh.getIndexSize();
+        std::size_t indexOffset = mesh.getLodOffset(0);
+
+        auto& draw = clusterJobDraws[j];
+        draw.clear();
+
+        const Meshlet* meshlets = mesh.getMeshlets().data() + job.firstMeshlet;
+
+        for (uint32_t m = 0; m < job.meshletCount; m++) {
+            if (Meshlets::isVisible(meshlets[m], localFrustum, localView, cullBackFaces)) {
+                draw.add(indexOffset + meshlets[m].firstIndex * indexSize, static_cast<GLsizei>(meshlets[m].indexCount), indexSize);
+            } else {
+                clusterJobCulled[j]++;
+            }
+        }
+    });
+
+    // an item's jobs are consecutive and in meshlet order, so ranges that
+    // continue across jobs merge too
+    std::size_t culled = 0;
+
+    for (std::size_t j = 0; j < clusterJobs.size(); j++) {
+        auto& draw = clusterDraws[clusterJobs[j].item];
+        const auto& part = clusterJobDraws[j];
+        std::size_t indexSize = cullItems[clusterJobs[j].item]->getMesh()->getIndexSize();
+
+        for (std::size_t r = 0; r < part.counts.size(); r++) {
+            draw.add(reinterpret_cast<std::size_t>(part.offsets[r]), part.counts[r], indexSize);
+        }
+
+        culled += clusterJobCulled[j];
+    }
+
+    for (const auto& job : clusterJobs) {
+        if (clusterDraws[job.item].empty()) {
+            visibility[job.item] = 0;
+        }
+    }
+
+    GLStats::frame().culledClusters += culled;
+}
+
+std::shared_ptr<Model> Renderer::pick(int x, int y) const {
+    // window to normalized device coordinates, y points up
+    glm::vec2 ndc(
+        2.0f * (static_cast<float>(x) + 0.5f) / static_cast<float>(width) - 1.0f,
+        1.0f - 2.0f * (static_cast<float>(y) + 0.5f) / static_cast<float>(height)
+    );
+
+    glm::mat4 inverse = glm::inverse(frameUniforms.getProjectionMatrix() * frameUniforms.getViewMatrix());
+
+    glm::vec4 near = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+    glm::vec4 far = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+
+    glm::vec3 origin = glm::vec3(near) / near.w;
+    glm::vec3 end = glm::vec3(far) / far.w;
+
+    auto hit = bvh.raycast(origin, end - origin);
+
+    if (hit.item == BVH::INVALID) {
+        return nullptr;
+    }
+
+    return cullItems[hit.item];
+}
+
+void Renderer::occludeModels() const {
+    hiZEffect.collect();
+
+    // every model is tested, so the ones drawn last frame can drop out too
+    std::size_t occluded = 0;
+
+    for (std::size_t i = 0; i < visibility.size(); i++) {
+        if (visibility[i] && hiZEffect.isOccluded(cullBoxes[i])) {
+            visibility[i] = 0;
+            occluded++;
+        }
+    }
+
+    GLStats::frame().occludedModels += occluded;
+}
+
+void Renderer::buildOcclusionDepth(GLuint framebuffer, GLuint depth) const {
+    glm::mat4 viewProjection = frameUniforms.getProjectionMatrix() * frameUniforms.getViewMatrix();
+    hiZEffect.build(screenObject.vertexArray, depth, viewProjection);
 
-    for (auto& model : models) {
-        model->setLights(lights);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void Renderer::drawModels(MaterialType type, const uint8_t* visible) const {
+    renderQueue.clear();
+
+    if (multiDrawEnabled && type != MaterialType::standard) {
+        queuedVisibility.assign(visible, visible + cullItems.size());
+        multiDrawBatch.draw(type, queuedVisibility.data(), clusterDraws.data());
+        visible = queuedVisibility.data();
+    }
+
+    std::size_t offset = 0;
+    for (auto& batch : batches) {
+        batch->enqueue(type, renderQueue, frameUniforms.getViewMatrix(), visible + offset, clusterDraws.data() + offset);
+        offset += batch->getModels().size();
     }
+
+    renderQueue.sort();
+    renderQueue.submit();
 }
 
 void Renderer::updateCameraRotation(glm::vec3 r) {
@@ -337,6 +645,66 @@ void Renderer::toggleIBL() {
     deferredPBREffect.toggleIBL(iblEnabled);
 }
 
+void Renderer::toggleOcclusionCulling() {
+    occlusionCullingEnabled = !occlusionCullingEnabled;
+    // the depths read back are only kept up to date while culling
+    hiZEffect.clear();
+}
+
+void Renderer::toggleMultiDraw() {
+    multiDrawEnabled = !multiDrawEnabled;
+}
+
+void Renderer::toggleCompactGBuffer() {
+    bool compact = deferredPBREffect.getLayout() == GBufferLayout::compact;
+    deferredPBREffect.setLayout(compact ? GBufferLayout::full : GBufferLayout::compact);
+}
+
+void Renderer::toggleClusteredLighting() {
+    clusteredLightingEnabled = !clusteredLightingEnabled;
+    deferredPBREffect.toggleClusteredLighting(clusteredLightingEnabled);
+}
+
+void Renderer::toggleLightVolumes() {
+    lightVolumesEnabled = !lightVolumesEnabled;
+    deferredShadingEffect.toggleLightVolumes(lightVolumesEnabled);
+    deferredPBREffect.toggleLightVolumes(lightVolumesEnabled);
+}
+
+void Renderer::cycleSSAOResolution() {
+    switch (ssaoEffect.getResolution()) {
+        case SSAOResolution::full:
+            ssaoEffect.setResolution(SSAOResolution::half);
+            break;
+        case SSAOResolution::half:
+            ssaoEffect.setResolution(SSAOResolution::quarter);
+            break;
+        case SSAOResolution::quarter:
+            ssaoEffect.setResolution(SSAOResolution::full);
+            break;
+    }
+}
+
+void Renderer::toggleTemporalSSAO() {
+    temporalSSAOEnabled = !temporalSSAOEnabled;
+    ssaoEffect.toggleTemporal(temporalSSAOEnabled);
+}
+
+void Renderer::setSSAOSampleCount(int count) {
+    ssaoEffect.setSampleCount(count);
+}
+
+float Renderer::getSSAOMilliseconds() const {
+    return ssaoEffect.getMilliseconds();
+}
+
+ClusteredLights::Statistics Renderer::getLightingStatistics() const {
+    auto statistics = clusteredLights.getStatistics();
+    statistics.lightingMilliseconds = lightingTimer.getMilliseconds();
+
+    return statistics;
+}
+
 void Renderer::toggleMSAA() {
     if (MSAAEnabled) {
         glDisable(GL_MULTISAMPLE);
@@ -379,8 +747,8 @@ void Renderer::setEnvironmentMap(std::string file) {
 
     ibl.initialize(environmentMap.getCubemap(), screenObject.vertexArray);
 
-    std::shared_ptr<Mesh> skyboxMesh = std::make_shared<Mesh>();
-    skyboxMesh->fromOBJ("assets/unit_cube.obj");
+    // same cube the HDRI and IBL passes already loaded
+    std::shared_ptr<Mesh> skyboxMesh = ResourceCache::shared().getMesh("assets/unit_cube.obj");
 
     std::unique_ptr<Material> skyboxMaterial = std::make_unique<SkyboxMaterial>(environmentMap.getCubemap());
 
@@ -411,21 +779,14 @@ void Renderer::render() const {
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if (camera->isDirty()) {
-        for (auto& model : models) {
-            model->setProjectionAndViewMatrices(camera->getProjectionMatrix(), camera->getViewMatrix());
-        }
-        camera->setDirty(false);
-    }
-    // TODO(mfirmin): Check if lights are dirty
-    for (auto& model : models) {
-        model->setLights(lights);
-    }
+    bool cameraChanged = frameUniforms.update(*camera, width, height, static_cast<float>(SDL_GetTicks()) / 1000.0f);
+    lightBuffer.update(lights);
+    updateModelViewMatrices(cameraChanged);
+    cullModels();
+    selectLods();
+    cullClusters(MaterialType::standard);
 
-    for (auto& model : models) {
-        model->applyModelMatrix();
-        model->draw(MaterialType::standard);
-    }
+    drawModels(MaterialType::standard, visibility.data());
 
     glUseProgram(0);
 
@@ -477,37 +838,32 @@ void Renderer::renderDeferred() const {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if (camera->isDirty()) {
-        for (auto& model : models) {
-            model->setProjectionAndViewMatrices(camera->getProjectionMatrix(), camera->getViewMatrix());
-        }
+    // only the PBR G-buffer has a compact layout
+    frameUniforms.setCompactGBuffer(pbrEnabled && deferredPBREffect.getLayout() == GBufferLayout::compact);
 
-        if (skybox != nullptr) {
-            skybox->setProjectionAndViewMatrices(camera->getProjectionMatrix(), camera->getViewMatrix());
-        }
+    // one buffer update covers every program, however many models there are
+    bool cameraChanged = frameUniforms.update(*camera, width, height, static_cast<float>(SDL_GetTicks()) / 1000.0f);
+    lightBuffer.update(lights);
+    updateModelViewMatrices(cameraChanged);
+    cullModels();
+    selectLods();
 
-        deferredPBREffect.setViewMatrix(camera->getViewMatrix());
-        deferredShadingEffect.setViewMatrix(camera->getViewMatrix());
+    // ensure models have deferred material applied
+    // TODO: support multiple materials per model
+    MaterialType deferredType = pbrEnabled ? MaterialType::deferred_pbr : MaterialType::deferred;
 
-        ssaoEffect.setProjectionMatrix(camera->getProjectionMatrix());
-        camera->setDirty(false);
-    }
-    // TODO(mfirmin): Check if lights are dirty
-    for (auto& model : models) {
-        model->setLights(lights);
-    }
+    cullClusters(deferredType);
 
-    if (pbrEnabled) {
-        deferredPBREffect.setLights(lights);
-    } else {
-        deferredShadingEffect.setLights(lights);
+    if (occlusionCullingEnabled) {
+        occludeModels();
     }
 
-    // ensure models have deferred material applied
-    // TODO: support multiple materials per model
-    for (auto& model : models) {
-        model->applyModelMatrix();
-        model->draw(pbrEnabled ? MaterialType::deferred_pbr : MaterialType::deferred);
+    drawModels(deferredType, visibility.data());
+
+    // the occluders of the next frames
+    if (occlusionCullingEnabled) {
+        GLuint depth = pbrEnabled ? deferredPBREffect.getDepth() : deferredShadingEffect.getDepth();
+        buildOcclusionDepth(deferredBuffer, depth);
     }
 
     if (skybox != nullptr) {
@@ -518,21 +874,59 @@ void Renderer::renderDeferred() const {
     // render the ambient occlusion term
 
     if (pbrEnabled) {
-        ssaoEffect.render(screenObject.vertexArray, deferredPBREffect.getPosition(), deferredPBREffect.getNormal());
+        if (temporalSSAOEnabled) {
+            motionVectors.render(screenObject.vertexArray, deferredPBREffect.getPosition(), deferredPBREffect.getDepth());
+        }
+
+        ssaoEffect.render(
+            screenObject.vertexArray,
+            deferredPBREffect.getPosition(),
+            deferredPBREffect.getNormal(),
+            deferredPBREffect.getDepth(),
+            motionVectors.getTexture()
+        );
         bloomEffect.render(screenObject.vertexArray, deferredPBREffect.getOutputTexture());
+
+        if (clusteredLightingEnabled && !lightVolumesEnabled) {
+            clusteredLights.update(lights, frameUniforms.getViewMatrix(), frameUniforms.getProjectionMatrix());
+        }
+
+        lightingTimer.begin();
+
         // do the deferred lighting step
         deferredPBREffect.render(
             screenObject.vertexArray,
             ssaoEffect.getAmbientOcculsionTexture(),
             ibl.getDiffuseIrradiance(),
             ibl.getPrefilteredMap(),
-            ibl.getIntegratedBRDFMap()
+            ibl.getIntegratedBRDFMap(),
+            clusteredLights
         );
+
+        if (lightVolumesEnabled) {
+            deferredPBREffect.renderLightVolumes(lightVolumes, lights, frameUniforms.getViewMatrix());
+        }
+
+        lightingTimer.end();
     } else {
-        ssaoEffect.render(screenObject.vertexArray, deferredShadingEffect.getPosition(), deferredShadingEffect.getNormal());
+        if (temporalSSAOEnabled) {
+            motionVectors.render(screenObject.vertexArray, deferredShadingEffect.getPosition(), deferredShadingEffect.getDepth());
+        }
+
+        ssaoEffect.render(
+            screenObject.vertexArray,
+            deferredShadingEffect.getPosition(),
+            deferredShadingEffect.getNormal(),
+            deferredShadingEffect.getDepth(),
+            motionVectors.getTexture()
+        );
         bloomEffect.render(screenObject.vertexArray, deferredShadingEffect.getOutputTexture());
         // do the deferred lighting step
         deferredShadingEffect.render(screenObject.vertexArray, ssaoEffect.getAmbientOcculsionTexture());
+
+        if (lightVolumesEnabled) {
+            deferredShadingEffect.renderLightVolumes(lightVolumes, lights, frameUniforms.getViewMatrix());
+        }
     }
 
     // Render the compositing pass
@@ -3,10 +3,22 @@
 #include "compute/hdri.hpp"
 #include "compute/ibl.hpp"
 
+#include "frameUniforms.hpp"
+#include "geometry/bvh.hpp"
+#include "gl/gpuTimer.hpp"
+#include "instancedBatch.hpp"
+#include "light/clusteredLights.hpp"
+#include "light/lightBuffer.hpp"
+#include "multiDrawBatch.hpp"
+#include "renderQueue.hpp"
+
 #include "renderEffects/bloom.hpp"
 #include "renderEffects/deferredShading.hpp"
 #include "renderEffects/deferredPBR.hpp"
 #include "renderEffects/fxaa.hpp"
+#include "renderEffects/hiZ.hpp"
+#include "renderEffects/lightVolumes.hpp"
+#include "renderEffects/motionVectors.hpp"
 #include "renderEffects/ssao.hpp"
 
 #include <memory>
@@ -37,8 +49,13 @@ class Renderer {
 
         void addModel(std::shared_ptr<Model> model);
         void addLight(std::shared_ptr<Light> light);
+        void removeLight(const std::shared_ptr<Light>& light);
 
         void render() const;
+
+        // Model whose world box is hit first by the ray through the given
+        // window coordinates (as of the last rendered frame), or nullptr
+        std::shared_ptr<Model> pick(int x, int y) const;
         void renderDeferred() const;
         void renderIBLTest(const HDRI& environmentMap) const;
 
@@ -51,10 +68,25 @@ class Renderer {
         void toggleSSAO();
         void togglePBR();
         void toggleIBL();
+        void toggleOcclusionCulling();
+        void toggleMultiDraw();
+        void toggleCompactGBuffer();
+        void toggleClusteredLighting();
+        void toggleLightVolumes();
+        // full, half, quarter
+        void cycleSSAOResolution();
+        void toggleTemporalSSAO();
         void updateCameraRotation(glm::vec3 r);
 
         void setExposure(float value);
         void setEnvironmentMap(std::string file);
+        void setSSAOSampleCount(int count);
+
+        // Light binning of the last PBR frame, and the GPU time of its
+        // lighting pass (a couple of frames behind)
+        ClusteredLights::Statistics getLightingStatistics() const;
+        // GPU time of the ambient occlusion passes, likewise behind
+        float getSSAOMilliseconds() const;
 
     private:
         SDL_Window* window = nullptr;
@@ -64,10 +96,63 @@ class Renderer {
         int height;
 
         std::unique_ptr<Camera> camera;
+        FrameUniforms frameUniforms;
 
         std::vector<std::shared_ptr<Model>> models;
+        // every model, grouped by mesh and programs; drawn instanced where possible
+        std::vector<std::unique_ptr<InstancedBatch>> batches;
+        // rebuilt for every pass
+        mutable RenderQueue renderQueue;
+        // draws the G-buffer pass with a few multi-draw calls when enabled;
+        // holds the culling items
+        mutable MultiDrawBatch multiDrawBatch;
+        // the visible items multiDrawBatch leaves to the render queue
+        mutable std::vector<uint8_t> queuedVisibility;
+
+        // scratch space for updateModelViewMatrices, kept to avoid per-frame allocations
+        mutable std::vector<Model*> changedModels;
+        mutable std::vector<glm::mat4> modelMatrices;
+        mutable std::vector<glm::mat4> modelViewMatrices;
+        mutable std::vector<glm::mat3> normalMatrices;
+
+        // Culling items are all models in batch order. The BVH is rebuilt when
+        // models are added (or refitting degraded it) and refit for models
+        // that moved
+        mutable BVH bvh;
+        mutable bool bvhOutdated = true;
+        mutable std::vector<std::shared_ptr<Model>> cullItems;
+        mutable std::vector<AABB> cullBoxes;
+        mutable std::vector<glm::vec4> cullSpheres;
+        mutable std::vector<uint32_t> movedItems;
+        // whether each item is in the view frustum (and not occluded)
+        mutable std::vector<uint8_t> visibility;
+
+        // Per culling item, what is left of a lone full detail model's
+        // meshlets after cluster culling; empty for the other items
+        mutable std::vector<MultiDraw> clusterDraws;
+
+        // a range of one item's meshlets, culled on one thread
+        struct ClusterJob {
+            uint32_t item;
+            uint32_t firstMeshlet;
+            uint32_t meshletCount;
+        };
+
+        // scratch space for cullClusters: the jobs, and per job the ranges
+        // left and the number of meshlets culled
+        mutable std::vector<ClusterJob> clusterJobs;
+        mutable std::vector<MultiDraw> clusterJobDraws;
+        mutable std::vector<std::size_t> clusterJobCulled;
 
         std::vector<std::shared_ptr<Light>> lights;
+        LightBuffer lightBuffer;
+        // per-cluster light lists for the PBR lighting pass
+        ClusteredLights clusteredLights;
+        // point and spot lights drawn as spheres, for both lighting passes
+        LightVolumes lightVolumes;
+
+        // around the PBR lighting pass
+        GPUTimer lightingTimer;
 
         std::unique_ptr<RenderTarget> sceneTarget;
 
@@ -95,7 +180,10 @@ class Renderer {
         DeferredShadingEffect deferredShadingEffect;
         DeferredPBREffect deferredPBREffect;
         SSAOEffect ssaoEffect;
+        // only rendered while an effect reprojects its history
+        MotionVectorsEffect motionVectors;
         FXAAEffect fxaaEffect;
+        HiZEffect hiZEffect;
 
         bool FXAAEnabled = true;
         bool MSAAEnabled = false;
@@ -104,8 +192,14 @@ class Renderer {
         bool gammaCorrectionEnabled = true;
         bool bloomEnabled = false;
         bool ssaoEnabled = true;
+        bool temporalSSAOEnabled = false;
         bool pbrEnabled = true;
         bool iblEnabled = true;
+        bool occlusionCullingEnabled = true;
+        bool multiDrawEnabled = true;
+        bool clusteredLightingEnabled = true;
+        // takes precedence over clustered lighting
+        bool lightVolumesEnabled = false;
 
         bool initializeSDL();
         bool initializeGL();
@@ -113,4 +207,39 @@ class Renderer {
         void initializeScreenObject();
         void initializeCompositingPass();
         void initializeBaseProgram();
+
+        // Computes model-view and normal matrices, in one batch, for every
+        // model whose transform changed (or all of them if the camera did).
+        // Instanced batches only refresh their instance data
+        // Also records the culling items that moved
+        void updateModelViewMatrices(bool cameraChanged) const;
+
+        // Culls the models against the camera frustum through the BVH.
+        // Expects the model matrices to be up to date
+        void cullModels() const;
+
+        // Picks the mesh level of detail of every visible model from its
+        // size on screen, with hysteresis against popping
+        void selectLods() const;
+
+        // Culls the meshlets of visible lone models drawn at full detail
+        // against the frustum and, where the material of type only shows
+        // front faces, by facing. Models with no meshlet left are hidden.
+        // Runs on the shared thread pool
+        void cullClusters(MaterialType type) const;
+
+        // Hides the models behind the latest Hi-Z pyramid read back, built
+        // from an earlier frame's depth. Expects the models to be frustum
+        // culled
+        void occludeModels() const;
+
+        // Builds the Hi-Z pyramid from the G-buffer depth just drawn and
+        // starts reading it back, for the next frames' occludeModels.
+        // Rebinds framebuffer afterwards
+        void buildOcclusionDepth(GLuint framebuffer, GLuint depth) const;
+
+        // Draws every model marked in visible (one entry per culling item)
+        // through the render queue, sorted by state. The G-buffer material
+        // types go through multiDrawBatch first, if enabled
+        void drawModels(MaterialType type, const uint8_t* visible) const;
 };
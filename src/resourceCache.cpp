@@ -0,0 +1,109 @@
+#include "resourceCache.hpp"
+
+#include "gl/shaderProgram.hpp"
+#include "gl/shaderUtils.hpp"
+#include "mesh.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    bool readFile(const std::string& path, std::string& contents) {
+        std::ifstream ifs(path);
+        if (ifs.fail()) {
+            return false;
+        }
+
+        std::ostringstream buffer;
+        buffer << ifs.rdbuf();
+        contents = buffer.str();
+
+        return true;
+    }
+}
+
+ResourceCache& ResourceCache::shared() {
+    static ResourceCache cache;
+    return cache;
+}
+
+std::shared_ptr<Mesh> ResourceCache::getMesh(const std::string& path, VertexLayout layout) {
+    std::ostringstream key;
+    key << path << "|"
+        << static_cast<int>(layout.position)
+        << static_cast<int>(layout.normal)
+        << static_cast<int>(layout.uv);
+
+    auto entry = meshes.find(key.str());
+    if (entry != meshes.end()) {
+        if (auto mesh = entry->second.lock()) {
+            return mesh;
+        }
+    }
+
+    // a miss loads a file anyway, sweeping the maps costs nothing next to it
+    evictUnused();
+
+    auto mesh = std::make_shared<Mesh>();
+    mesh->fromOBJ(path, layout);
+    meshes[key.str()] = mesh;
+
+    return mesh;
+}
+
+std::shared_ptr<ShaderProgram> ResourceCache::getProgram(const std::string& vertexShader, const std::string& fragmentShader) {
+    // the sources themselves are the key, so there are no false hits
+    std::string key = vertexShader;
+    key.push_back('\0');
+    key += fragmentShader;
+
+    auto entry = programs.find(key);
+    if (entry != programs.end()) {
+        if (auto program = entry->second.lock()) {
+            return program;
+        }
+    }
+
+    evictUnused();
+
+    GLuint id = ShaderUtils::compile(vertexShader, fragmentShader);
+    if (id == 0) {
+        return nullptr;
+    }
+
+    auto program = std::make_shared<ShaderProgram>(id);
+    programs[key] = program;
+
+    return program;
+}
+
+std::shared_ptr<ShaderProgram> ResourceCache::getProgramFromFiles(
+    const std::string& vertexShaderPath,
+    const std::string& fragmentShaderPath
+) {
+    std::string vertexShader;
+    std::string fragmentShader;
+
+    if (!readFile(vertexShaderPath, vertexShader)) {
+        std::cout << "Could not open shader file " << vertexShaderPath << "\n";
+        return nullptr;
+    }
+
+    if (!readFile(fragmentShaderPath, fragmentShader)) {
+        std::cout << "Could not open shader file " << fragmentShaderPath << "\n";
+        return nullptr;
+    }
+
+    return getProgram(vertexShader, fragmentShader);
+}
+
+void ResourceCache::evictUnused() {
+    for (auto it = meshes.begin(); it != meshes.end();) {
+        it = it->second.expired() ? meshes.erase(it) : std::next(it);
+    }
+
+    for (auto it = programs.begin(); it != programs.end();) {
+        it = it->second.expired() ? programs.erase(it) : std::next(it);
+    }
+}
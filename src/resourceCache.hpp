@@ -0,0 +1,58 @@
+#pragma once
+
+#include "gl/vertexLayout.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class Mesh;
+class ShaderProgram;
+
+/**
+ * Process-wide cache of meshes and GL programs.
+ *
+ * Meshes are keyed by path + vertex layout, programs by their source.
+ * The cache only holds weak references: a resource is destroyed as soon as
+ * its last user releases it, and the next request loads it again. Every
+ * miss first drops the entries of released resources, so the maps don't
+ * grow past the resources in use plus those released since the last miss.
+ * Must only be used from the GL thread.
+ **/
+class ResourceCache {
+    public:
+        ResourceCache() = default;
+
+        ResourceCache(ResourceCache&& other) = delete;
+        ResourceCache& operator=(ResourceCache&& other) = delete;
+
+        ResourceCache(const ResourceCache& other) = delete;
+        ResourceCache& operator=(const ResourceCache& other) = delete;
+
+        ~ResourceCache() = default;
+
+        static ResourceCache& shared();
+
+        std::shared_ptr<Mesh> getMesh(const std::string& path, VertexLayout layout = VertexLayout());
+
+        // Returns nullptr if the program fails to compile
+        std::shared_ptr<ShaderProgram> getProgram(const std::string& vertexShader, const std::string& fragmentShader);
+
+        // Loads the shader sources from disk
+        std::shared_ptr<ShaderProgram> getProgramFromFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+
+        // Drops entries whose resource has been released; also done on every miss
+        void evictUnused();
+
+        std::size_t getMeshCount() const {
+            return meshes.size();
+        }
+
+        std::size_t getProgramCount() const {
+            return programs.size();
+        }
+    private:
+        std::unordered_map<std::string, std::weak_ptr<Mesh>> meshes;
+        std::unordered_map<std::string, std::weak_ptr<ShaderProgram>> programs;
+};
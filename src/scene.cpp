@@ -1,6 +1,8 @@
 #include "scene.hpp"
 
 #include "camera.hpp"
+#include "gl/geometryArena.hpp"
+#include "gl/glStats.hpp"
 
 #include "lamp.hpp"
 #include "light/directionalLight.hpp"
@@ -13,9 +15,12 @@
 #include "model.hpp"
 
 #include "renderer.hpp"
+#include "resourceCache.hpp"
 
 #include <chrono>
+#include <iostream>
 #include <memory>
+#include <random>
 
 Scene::Scene(int width, int height) : width(width), height(height) {}
 
@@ -57,8 +62,8 @@ void Scene::initialize() {
     };
 
     // Note that lamps are combined light + model, so we need to pass in a mesh for these
-    std::shared_ptr<Mesh> sphereMesh = std::make_shared<Mesh>();
-    sphereMesh->fromOBJ("assets/sphere.obj");
+    // lamps are tiny, half precision positions are plenty
+    std::shared_ptr<Mesh> sphereMesh = ResourceCache::shared().getMesh("assets/sphere.obj", VertexLayout::compact());
 
     createLamp(sphereMesh, glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0.8f, 0.6f, 0.4f), static_cast<float>(lamp1Intensity), 0.1f);
 
@@ -69,8 +74,7 @@ void Scene::initialize() {
     createLamp(sphereMesh, glm::vec3(-1.0f, 1.5f, 1.5f), glm::vec3(0.9f, 0.2f, 0.1f), 4.0f, 0.05f);
 
     // 3. Create the central model
-    std::shared_ptr<Mesh> bunnyMesh = std::make_shared<Mesh>();
-    bunnyMesh->fromOBJ("assets/bunny.obj");
+    std::shared_ptr<Mesh> bunnyMesh = ResourceCache::shared().getMesh("assets/bunny.obj");
 
     std::unique_ptr<Material> material = std::make_unique<Material>(
         glm::vec3(0.75164, 0.60648, 0.22648),
@@ -119,6 +123,36 @@ void Scene::createLamp(
     lamps.push_back(lamp);
 }
 
+void Scene::createBenchmarkLights(std::size_t count) {
+    for (const auto& light : benchmarkLights) {
+        renderer->removeLight(light);
+    }
+
+    benchmarkLights.clear();
+
+    // the same lights for the same count, so runs are comparable
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> horizontal(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> vertical(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+
+    for (std::size_t i = 0; i < count; i++) {
+        // strong attenuation keeps each light's reach under a unit (see Light::getRadius)
+        auto light = std::make_shared<PointLight>(
+            glm::vec3(horizontal(generator), vertical(generator), horizontal(generator)),
+            glm::vec3(channel(generator), channel(generator), channel(generator)),
+            1.0f,
+            0.0f,
+            200.0f
+        );
+
+        renderer->addLight(light);
+        benchmarkLights.push_back(light);
+    }
+
+    std::cout << "Benchmark lights: " << count << "\n";
+}
+
 void Scene::go() {
     bool quit = false;
     bool mouseDown = false;
@@ -148,6 +182,14 @@ void Scene::go() {
                 ) {
                     quit = true;
                     break;
+                } else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_RIGHT) {
+                    auto picked = renderer->pick(e.button.x, e.button.y);
+                    if (picked != nullptr) {
+                        auto position = glm::vec3(picked->getModelMatrix()[3]);
+                        std::cout << "Picked model at (" << position.x << ", " << position.y << ", " << position.z << ")\n";
+                    } else {
+                        std::cout << "Picked nothing\n";
+                    }
                 } else if (e.type == SDL_MOUSEBUTTONDOWN) {
                     mouseDown = true;
                 } else if (e.type == SDL_MOUSEMOTION) {
@@ -220,6 +262,28 @@ void Scene::go() {
                         }
                     } else if (key == "Z") {
                         renderer->toggleIBL();
+                    } else if (key == "U") {
+                        renderer->toggleOcclusionCulling();
+                    } else if (key == "D") {
+                        renderer->toggleMultiDraw();
+                    } else if (key == "K") {
+                        renderer->toggleCompactGBuffer();
+                    } else if (key == "X") {
+                        renderer->toggleClusteredLighting();
+                    } else if (key == "V") {
+                        renderer->toggleLightVolumes();
+                    } else if (key == "N") {
+                        benchmarkLightCount = (benchmarkLightCount + 1) % BENCHMARK_LIGHT_COUNTS.size();
+                        createBenchmarkLights(BENCHMARK_LIGHT_COUNTS.at(benchmarkLightCount));
+                    } else if (key == "R") {
+                        renderer->cycleSSAOResolution();
+                    } else if (key == "T") {
+                        renderer->toggleTemporalSSAO();
+                    } else if (key == "Q") {
+                        ssaoSampleCount = (ssaoSampleCount + 1) % SSAO_SAMPLE_COUNTS.size();
+                        renderer->setSSAOSampleCount(SSAO_SAMPLE_COUNTS.at(ssaoSampleCount));
+                    } else if (key == "C") {
+                        statsEnabled = !statsEnabled;
                     }
                 }
             }
@@ -232,6 +296,14 @@ void Scene::go() {
             // renderer.render();
             renderer->renderDeferred();
             last = now;
+
+            GLStats::endFrame();
+            if (statsEnabled && ++statsFrame % static_cast<unsigned int>(FPS) == 0) {
+                std::cout << "Frame: " << GLStats::last() << "\n";
+                std::cout << "Geometry: " << GeometryArena::shared().getStatistics() << "\n";
+                std::cout << "Lighting: " << renderer->getLightingStatistics() << "\n";
+                std::cout << "SSAO: " << renderer->getSSAOMilliseconds() << " ms\n";
+            }
         }
 
     }
@@ -247,5 +319,19 @@ const std::vector<float> Scene::EXPOSURE_VALUES = {
     10.0f
 };
 
+const std::vector<std::size_t> Scene::BENCHMARK_LIGHT_COUNTS = {
+    0,
+    256,
+    1024,
+    4096
+};
+
+const std::vector<int> Scene::SSAO_SAMPLE_COUNTS = {
+    64,
+    32,
+    16,
+    8
+};
+
 const float Scene::ONE_SECOND = 1000.0f;
 const float Scene::FPS = 60.0f;
@@ -5,6 +5,7 @@
 #include "lamp.hpp"
 
 class DirectionalLight;
+class PointLight;
 
 // Scene initializes all scene elements (camera, renderer, etc)
 // And begins the render/event loop
@@ -33,6 +34,9 @@ class Scene {
         };
 
         static const std::vector<float> EXPOSURE_VALUES;
+        // extra point lights cycled through to benchmark the lighting pass
+        static const std::vector<std::size_t> BENCHMARK_LIGHT_COUNTS;
+        static const std::vector<int> SSAO_SAMPLE_COUNTS;
         static const float ONE_SECOND;
         static const float FPS;
 
@@ -42,13 +46,20 @@ class Scene {
         std::unique_ptr<Renderer> renderer = nullptr;
         std::vector<Lamp> lamps;
         std::vector<std::shared_ptr<DirectionalLight>> directionalLights;
+        std::vector<std::shared_ptr<PointLight>> benchmarkLights;
         std::shared_ptr<Model> model;
 
         unsigned int exposure = 3;
         int lamp1Intensity = 2;
+        unsigned int benchmarkLightCount = 0;
+        unsigned int ssaoSampleCount = 0;
 
         PBRPreset pbrMaterialType = PBRPreset::metallic;
 
+        // print GL call counts once per second
+        bool statsEnabled = false;
+        unsigned int statsFrame = 0;
+
         void createLamp(
             std::shared_ptr<Mesh> mesh,
             glm::vec3 position,
@@ -56,4 +67,8 @@ class Scene {
             float intensity,
             float scale
         );
+
+        // Replaces the benchmark lights with count small random point lights
+        // around the model
+        void createBenchmarkLights(std::size_t count);
 };
@@ -0,0 +1,92 @@
+#include "matrixBatch.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MATRIX_BATCH_SSE 1
+#endif
+
+namespace {
+#ifdef MATRIX_BATCH_SSE
+    inline __m128 cross(__m128 a, __m128 b) {
+        // a.yzx * b.zxy - a.zxy * b.yzx
+        __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 c = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+        return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+    }
+
+    inline float dot3(__m128 a, __m128 b) {
+        float p[4];
+        _mm_storeu_ps(p, _mm_mul_ps(a, b));
+        return p[0] + p[1] + p[2];
+    }
+
+    inline void storeVec3(__m128 v, glm::vec3& out) {
+        float p[4];
+        _mm_storeu_ps(p, v);
+        out = glm::vec3(p[0], p[1], p[2]);
+    }
+#endif
+}
+
+void MatrixBatch::computeModelView(
+    const glm::mat4& view,
+    const glm::mat4* models,
+    glm::mat4* modelViews,
+    glm::mat3* normals,
+    std::size_t count
+) {
+#ifdef MATRIX_BATCH_SSE
+    // glm matrices are 16 contiguous column-major floats
+    const float* v = &view[0][0];
+    const __m128 v0 = _mm_loadu_ps(v + 0);
+    const __m128 v1 = _mm_loadu_ps(v + 4);
+    const __m128 v2 = _mm_loadu_ps(v + 8);
+    const __m128 v3 = _mm_loadu_ps(v + 12);
+
+    for (std::size_t i = 0; i < count; i++) {
+        const float* m = &models[i][0][0];
+        float* mv = &modelViews[i][0][0];
+
+        __m128 columns[4];
+        for (int c = 0; c < 4; c++) {
+            // column c of view * model is view * model[c]
+            __m128 r = _mm_mul_ps(v0, _mm_set1_ps(m[c * 4 + 0]));
+            r = _mm_add_ps(r, _mm_mul_ps(v1, _mm_set1_ps(m[c * 4 + 1])));
+            r = _mm_add_ps(r, _mm_mul_ps(v2, _mm_set1_ps(m[c * 4 + 2])));
+            r = _mm_add_ps(r, _mm_mul_ps(v3, _mm_set1_ps(m[c * 4 + 3])));
+            columns[c] = r;
+            _mm_storeu_ps(mv + c * 4, r);
+        }
+
+        // The inverse transpose of the upper 3x3 has the columns
+        // cross(c1, c2), cross(c2, c0), cross(c0, c1), divided by the determinant
+        __m128 n0 = cross(columns[1], columns[2]);
+        __m128 n1 = cross(columns[2], columns[0]);
+        __m128 n2 = cross(columns[0], columns[1]);
+
+        float det = dot3(columns[0], n0);
+        // degenerate (zero scale) matrices keep the unscaled cofactors; the
+        // shaders normalize anyway
+        __m128 invDet = _mm_set1_ps(det != 0.0f ? 1.0f / det : 1.0f);
+
+        storeVec3(_mm_mul_ps(n0, invDet), normals[i][0]);
+        storeVec3(_mm_mul_ps(n1, invDet), normals[i][1]);
+        storeVec3(_mm_mul_ps(n2, invDet), normals[i][2]);
+    }
+#else
+    for (std::size_t i = 0; i < count; i++) {
+        modelViews[i] = view * models[i];
+
+        glm::vec3 c0(modelViews[i][0]);
+        glm::vec3 c1(modelViews[i][1]);
+        glm::vec3 c2(modelViews[i][2]);
+
+        glm::vec3 n0 = glm::cross(c1, c2);
+        float det = glm::dot(c0, n0);
+        float invDet = det != 0.0f ? 1.0f / det : 1.0f;
+
+        normals[i] = glm::mat3(n0 * invDet, glm::cross(c2, c0) * invDet, glm::cross(c0, c1) * invDet);
+    }
+#endif
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+/**
+ * Batched per-object matrix math, run once per frame over every model.
+ * Uses SSE when available (4 floats per column) and plain glm otherwise.
+ **/
+namespace MatrixBatch {
+    // modelViews[i] = view * models[i]
+    // normals[i] = transpose(inverse(mat3(modelViews[i])))
+    void computeModelView(
+        const glm::mat4& view,
+        const glm::mat4* models,
+        glm::mat4* modelViews,
+        glm::mat3* normals,
+        std::size_t count
+    );
+} /* MatrixBatch */
@@ -0,0 +1,97 @@
+#include "rangeAllocator.hpp"
+
+#include <iterator>
+#include <limits>
+
+const std::size_t RangeAllocator::INVALID = std::numeric_limits<std::size_t>::max();
+
+RangeAllocator::RangeAllocator(std::size_t c) {
+    grow(c);
+}
+
+std::size_t RangeAllocator::allocate(std::size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+
+    auto fit = bySize.lower_bound(std::make_pair(size, std::size_t(0)));
+    if (fit == bySize.end()) {
+        return INVALID;
+    }
+
+    std::size_t offset = fit->second;
+    std::size_t blockSize = fit->first;
+
+    eraseBlock(byOffset.find(offset));
+
+    if (blockSize > size) {
+        insertBlock(offset + size, blockSize - size);
+    }
+
+    used += size;
+
+    return offset;
+}
+
+void RangeAllocator::free(std::size_t offset, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    used -= size;
+
+    // merge with the free blocks right after and right before
+    auto next = byOffset.lower_bound(offset);
+
+    if (next != byOffset.end() && next->first == offset + size) {
+        size += next->second;
+        next = std::next(next);
+        eraseBlock(std::prev(next));
+    }
+
+    if (next != byOffset.begin()) {
+        auto previous = std::prev(next);
+
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            eraseBlock(previous);
+        }
+    }
+
+    insertBlock(offset, size);
+}
+
+void RangeAllocator::grow(std::size_t c) {
+    if (c <= capacity) {
+        return;
+    }
+
+    std::size_t added = c - capacity;
+    std::size_t offset = capacity;
+
+    capacity = c;
+    used += added;
+
+    // free() merges it with a free block at the end
+    free(offset, added);
+}
+
+float RangeAllocator::getFragmentation() const {
+    std::size_t freeSpace = getFree();
+    if (freeSpace == 0) {
+        return 0.0f;
+    }
+
+    return 1.0f - static_cast<float>(getLargestFreeBlock()) / static_cast<float>(freeSpace);
+}
+
+void RangeAllocator::insertBlock(std::size_t offset, std::size_t size) {
+    byOffset.emplace(offset, size);
+    bySize.emplace(size, offset);
+}
+
+void RangeAllocator::eraseBlock(std::map<std::size_t, std::size_t>::iterator block) {
+    bySize.erase(std::make_pair(block->second, block->first));
+    byOffset.erase(block);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+
+/**
+ * Hands out ranges of [0, capacity) in whatever unit the caller uses
+ * (vertices, 4 byte words, ...) from a free list.
+ *
+ * Allocations take the smallest free block they fit in (the lowest one among
+ * equals), and freed ranges merge with the free blocks around them, so the
+ * free list only ever holds the holes between live ranges.
+ **/
+class RangeAllocator {
+    public:
+        static const std::size_t INVALID;
+
+        explicit RangeAllocator(std::size_t capacity = 0);
+        ~RangeAllocator() = default;
+
+        RangeAllocator(RangeAllocator&& other) = default;
+        RangeAllocator(const RangeAllocator& other) = default;
+
+        RangeAllocator& operator=(const RangeAllocator& other) = default;
+        RangeAllocator& operator=(RangeAllocator&& other) = default;
+
+        // Offset of size free units, or INVALID if no free block is large
+        // enough. Empty ranges are at 0 and take no space
+        std::size_t allocate(std::size_t size);
+
+        // Returns a range given out by allocate()
+        void free(std::size_t offset, std::size_t size);
+
+        // Adds free space at the end; capacity can only grow
+        void grow(std::size_t capacity);
+
+        std::size_t getCapacity() const {
+            return capacity;
+        }
+
+        std::size_t getUsed() const {
+            return used;
+        }
+
+        std::size_t getFree() const {
+            return capacity - used;
+        }
+
+        std::size_t getLargestFreeBlock() const {
+            return bySize.empty() ? 0 : bySize.rbegin()->first;
+        }
+
+        std::size_t getFreeBlockCount() const {
+            return byOffset.size();
+        }
+
+        // 1 - largest free block / free space: 0 while the free space is
+        // one block, close to 1 when it is scattered in small holes
+        float getFragmentation() const;
+    private:
+        std::size_t capacity = 0;
+        std::size_t used = 0;
+
+        // free blocks, offset -> size
+        std::map<std::size_t, std::size_t> byOffset;
+        // the same blocks as (size, offset), for best fit
+        std::set<std::pair<std::size_t, std::size_t>> bySize;
+
+        void insertBlock(std::size_t offset, std::size_t size);
+        void eraseBlock(std::map<std::size_t, std::size_t>::iterator block);
+};
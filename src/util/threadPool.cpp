@@ -0,0 +1,106 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+    // MODEL_VIEWER_THREADS overrides the size of the shared pool, e.g. to
+    // compare import times at different thread counts; 0 or unset = all cores
+    std::size_t getSharedThreadCount() {
+        const char* threads = std::getenv("MODEL_VIEWER_THREADS");
+        if (threads == nullptr) {
+            return 0;
+        }
+
+        long count = std::strtol(threads, nullptr, 10);
+        return count > 0 ? static_cast<std::size_t>(count) : 0;
+    }
+}
+
+ThreadPool::ThreadPool(std::size_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // the calling thread is the last worker
+    for (std::size_t i = 1; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(getSharedThreadCount());
+    return pool;
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+
+    if (count == 1 || workers.empty()) {
+        for (std::size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    job = &fn;
+    jobCount = count;
+    nextIndex = 0;
+    remaining = count;
+    generation++;
+
+    wake.notify_all();
+
+    runJob(lock);
+
+    done.wait(lock, [this]() { return remaining == 0; });
+
+    job = nullptr;
+}
+
+void ThreadPool::runJob(std::unique_lock<std::mutex>& lock) {
+    while (job != nullptr && nextIndex < jobCount) {
+        auto index = nextIndex++;
+        auto fn = job;
+
+        lock.unlock();
+        (*fn)(index);
+        lock.lock();
+
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop() {
+    std::size_t seenGeneration = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+
+        if (stopping) {
+            return;
+        }
+
+        seenGeneration = generation;
+        runJob(lock);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads for data-parallel CPU work
+ * (mesh import, culling, light binning, ...).
+ * parallelFor blocks until every index has been processed; the calling
+ * thread takes part in the work. parallelFor must not be called from
+ * inside a job.
+ **/
+class ThreadPool {
+    public:
+        // 0 = one thread per hardware core
+        explicit ThreadPool(std::size_t numThreads = 0);
+        ~ThreadPool();
+
+        ThreadPool(ThreadPool&& other) = delete;
+        ThreadPool& operator=(ThreadPool&& other) = delete;
+
+        ThreadPool(const ThreadPool& other) = delete;
+        ThreadPool& operator=(const ThreadPool& other) = delete;
+
+        // Calls fn(i) for every i in [0, count)
+        void parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+        // Number of threads that work on a parallelFor, including the caller
+        std::size_t getConcurrency() const {
+            return workers.size() + 1;
+        }
+
+        // Process-wide pool shared by all subsystems; the environment
+        // variable MODEL_VIEWER_THREADS sets its size
+        static ThreadPool& shared();
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+
+        const std::function<void(std::size_t)>* job = nullptr;
+        std::size_t jobCount = 0;
+        std::size_t nextIndex = 0;
+        std::size_t remaining = 0;
+        std::size_t generation = 0;
+
+        bool stopping = false;
+
+        void workerLoop();
+        // Pulls indices of the current job until there are none left
+        void runJob(std::unique_lock<std::mutex>& lock);
+};